@@ -101,6 +101,7 @@ bool OldMirror      = false;
 bool OldSwap        = false;
 
 void Render();
+void LogThroughput(); // Logging throughput test
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_opt_ HINSTANCE hPrevInstance,
@@ -114,6 +115,9 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 	// OpenSpoutConsole();
 	// EnableSpoutLog();
 
+	// Time synchronous and asynchronous logging to file
+	// LogThroughput();
+
     // Initialize global strings
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
     LoadStringW(hInstance, IDC_MENU, szWindowClass, MAX_LOADSTRING);
@@ -1012,4 +1016,42 @@ void SetupDialogControls(HWND hDlg)
 		CheckDlgButton(hDlg, IDC_SWAP, BST_UNCHECKED);
 }
 
+// Logging throughput test
+// Write logs to file, first synchronously and then asynchronously,
+// and show the time taken by the calling thread on the console.
+// For asynchronous logging, the time until the log thread has
+// written all logs is also shown. Logs are not shown on the console
+// so that only the file is timed. Each burst is within the 256 logs
+// held for asynchronous logging, so that none are dropped.
+void LogThroughput()
+{
+	const int nLogs[] = { 10, 100, 250 };
+
+	OpenSpoutConsole();
+	EnableSpoutLogFile("WinSpoutDX11_throughput.log");
+	SetSpoutLogLevel(SPOUT_LOG_NOTICE);
+
+	for (int n : nLogs) {
+		// Synchronous
+		LONGLONG start = GetTimingCount();
+		for (int i = 0; i < n; i++)
+			SpoutLogNotice("Synchronous log %d of %d", i + 1, n);
+		const double sync = GetTimingElapsed(start, true);
+
+		// Asynchronous
+		EnableSpoutLogAsync();
+		start = GetTimingCount();
+		for (int i = 0; i < n; i++)
+			SpoutLogNotice("Asynchronous log %d of %d", i + 1, n);
+		const double async = GetTimingElapsed(start, true);
+		CloseSpoutLog(); // Write all queued logs
+		const double written = GetTimingElapsed(start, true);
+
+		printf("%4d logs : synchronous %.2f usec per log, asynchronous %.2f usec per log (%.2f usec until written)\n",
+			n, sync/n, async/n, written/n);
+	}
+
+	DisableSpoutLogFile();
+}
+
 // That's all..
@@ -168,6 +168,45 @@
 //		13.06.25	- GetSenderTexture - return shared testure instead of class texture
 //		23.06.25	- Correct ReceiveTexture() - do not reset update flag.
 //		24.06.25	- ReadTexturePixels - staging texture format of the texture to be copied
+//		17.10.26	- ReceiveSenderData - rate-limited warning for share handle failure
+//					- SendImage, ReceiveImage, ReadPixelData - add timing histograms
+//					- Add trace events for send and receive functions
+//					- Add GetCounters and ResetCounters for performance counters
+//					- Memory buffer binary header with write sequence and timestamp.
+//					  Add MemoryBufferChanged and lock-free buffer metadata.
+//					  WriteMemoryBuffer - check length against the buffer capacity.
+//					- Add BeginMemoryBufferWrite/Read, spoutMemoryBufferView and
+//					  multiple slot buffers that receivers read without locking.
+//					- SendImage/ReceiveImage - use a shared memory frame ring
+//					  in memory share mode (see SpoutFrameRing.cpp)
+//					- GetDX9, GetMemoryShareMode - use the configuration cache
+//					- ReadPixelData - convert R10G10B10A2, R16G16B16A16 and R32G32B32A32
+//					  sender formats with spoutCopy highbit2rgba
+//					- Add SetToneMap/GetToneMap for HDR senders received by ReceiveImage
+//					- Add ReceiveImage pixel format overload for v210, P010 and P210
+//					  and SetYUVMatrix/GetYUVMatrix
+//					- Add SendImage pixel format overload for NV12, YUY2 and UYVY
+//					  converted directly to a staging texture
+//					- Add SetResampleFilter/GetResampleFilter and ResamplePixels
+//					  for bicubic, Mitchell and Lanczos3 ReceiveImage resampling
+//					- Add SetReceiveRotation/GetReceiveRotation. ReadPixelData - rotate
+//					  RGBA textures of the sender size directly to the user buffer
+//					- Add SetFrameHash, GetFrameHash and IsFrameIdentical
+//					- Add ReceiveImage overload with a map of tiles changed since the last frame
+//					- Add ReceiveImageRegion and ReadTexurePixels region overload
+//					  using CopySubresourceRegion to a staging texture of the region size
+//					- Add AddDirtyRects and ClearDirtyRects. SendImage and SendTexture
+//					  update only the rectangles changed and publish them for GetDirtyRects
+//					- SendImage - write pixels to a ring of staging textures outside the
+//					  access lock and copy to the shared texture on the GPU within it
+//					- Memory buffer slots reserve their last byte for the null terminator.
+//					  SPOUT_BUFFER_VERSION 2
+//					- ReadPixelData - swap red and blue of resampled RGBA pixels
+//					- ReceiveImageRegion - return false for a region outside the sender
+//					- SetFrameHash - hash the pixels after conversion instead of the staging texture
+//					- AddDirtyRects - merge overlapping rectangles so that none are copied twice
+//					- Add SetResampleGamma/GetResampleGamma for SPOUT_FILTER_LINEAR
+//					- ReceiveImage - SPOUT_PIXEL_RGBA16 format using spoutCopy highbit2rgba16
 //
 // ====================================================================================
 /*
@@ -253,7 +292,20 @@ spoutDX::~spoutDX()
 	}
 
 	CloseDirectX11();
-	memorybuffer.Close();
+	CloseMemoryBuffer();
+
+	if (m_pConvertBuffer)
+		delete[] m_pConvertBuffer;
+	if (m_pResampleBuffer)
+		delete[] m_pResampleBuffer;
+	if (m_pRotateBuffer)
+		delete[] m_pRotateBuffer;
+	if (m_pPreviousFrame)
+		delete[] m_pPreviousFrame;
+	if (m_pTileChanged)
+		delete[] m_pTileChanged;
+	if (m_pTileSAD)
+		delete[] m_pTileSAD;
 
 }
 
@@ -331,6 +383,15 @@ void spoutDX::CloseDirectX11()
 	m_pStaging[1] = nullptr;
 	m_Index = 0;
 	m_NextIndex = 0;
+
+	for (int i = 0; i < SPOUT_UPLOAD_TEXTURES; i++) {
+		if (m_pUpload[i]) spoutdx.ReleaseDX11Texture(m_pd3dDevice, m_pUpload[i]);
+		m_pUpload[i] = nullptr;
+	}
+	m_UploadIndex = 0;
+
+	if (m_pRegionStaging) spoutdx.ReleaseDX11Texture(m_pd3dDevice, m_pRegionStaging);
+	m_pRegionStaging = nullptr;
 	
 	// Flush now to avoid deferred object destruction
 	if (m_pImmediateContext) m_pImmediateContext->Flush();
@@ -445,13 +506,22 @@ void spoutDX::ReleaseSender()
 	if (m_bSpoutInitialized) 
 		sendernames.ReleaseSenderName(m_SenderName);
 
+	for (int i = 0; i < SPOUT_UPLOAD_TEXTURES; i++) {
+		if (m_pUpload[i])
+			spoutdx.ReleaseDX11Texture(m_pd3dDevice, m_pUpload[i]);
+		m_pUpload[i] = nullptr;
+	}
+	m_UploadIndex = 0;
+
 	m_Width = 0;
 	m_Height = 0;
 	m_SenderName[0] = 0;
 	m_bSpoutInitialized = false;
 
-	// Close shared memory buffer if used
-	memorybuffer.Close();
+	// Close shared memory buffer, frame ring and dirty rectangles if used
+	CloseMemoryBuffer();
+	framering.Close();
+	CloseDirtyRects();
 
 }
 
@@ -509,6 +579,7 @@ bool spoutDX::SendBackBuffer()
 //
 bool spoutDX::SendTexture(ID3D11Texture2D* pTexture)
 {
+	SPOUT_TRACE("spoutDX::SendTexture");
 
 	// Quit if no data
 	if (!pTexture)
@@ -529,14 +600,22 @@ bool spoutDX::SendTexture(ID3D11Texture2D* pTexture)
 	if (!CheckSender(desc.Width, desc.Height, (DWORD)desc.Format))
 		return false;
 
+	// The whole texture or the rectangles changed (see AddDirtyRects)
+	const unsigned int nrects = ClipDirtyRects(desc.Width, desc.Height);
+
 	// Check the sender mutex for access the shared texture
-	if (frame.CheckTextureAccess(m_pSharedTexture)) {
+	if (CheckSharedTextureAccess()) {
 		// Copy the application texture to the sender's shared texture
-		m_pImmediateContext->CopyResource(m_pSharedTexture, pTexture);
+		if (nrects > 0)
+			CopyDirtyRects(pTexture, nrects);
+		else
+			m_pImmediateContext->CopyResource(m_pSharedTexture, pTexture);
 		// Flush the command queue now because the shared texture has been updated on this device
 		m_pImmediateContext->Flush();
+		PublishDirtyRects(nrects);
 		// Signal a new frame while the mutex is locked
 		frame.SetNewFrame();
+		AddCounter(COUNTER_FRAMES_SENT);
 		// Allow access to the shared texture
 		frame.AllowTextureAccess(m_pSharedTexture);
 	}
@@ -551,11 +630,13 @@ bool spoutDX::SendTexture(ID3D11Texture2D* pTexture)
 //
 // The region to be copied must be smaller than the texture
 // The sender must be initialized at the width and height of the region
+// Dirty rectangles (see AddDirtyRects) are relative to the region
 //
 bool spoutDX::SendTexture(ID3D11Texture2D* pTexture,
 	unsigned int xoffset, unsigned int yoffset,
 	unsigned int width, unsigned int height)
 {
+	SPOUT_TRACE("spoutDX::SendTexture region");
 
 	// Quit if no data
 	if (!pTexture)
@@ -591,14 +672,22 @@ bool spoutDX::SendTexture(ID3D11Texture2D* pTexture,
 		return false;
 	}
 
+	// The whole region or the rectangles changed within it
+	const unsigned int nrects = ClipDirtyRects(width, height);
+
 	// Check the sender mutex for access the shared texture
-	if (frame.CheckTextureAccess(m_pSharedTexture)) {
+	if (CheckSharedTextureAccess()) {
 		// Copy the texture region to the sender's shared texture
-		m_pImmediateContext->CopySubresourceRegion(m_pSharedTexture, 0, 0, 0, 0, pTexture, 0, &sourceRegion);
+		if (nrects > 0)
+			CopyDirtyRects(pTexture, nrects, xoffset, yoffset);
+		else
+			m_pImmediateContext->CopySubresourceRegion(m_pSharedTexture, 0, 0, 0, 0, pTexture, 0, &sourceRegion);
 		// Flush the command queue now because the shared texture has been updated on this device
 		m_pImmediateContext->Flush();
+		PublishDirtyRects(nrects);
 		// Signal a new frame while the mutex is locked
 		frame.SetNewFrame();
+		AddCounter(COUNTER_FRAMES_SENT);
 		// Allow access to the shared texture
 		frame.AllowTextureAccess(m_pSharedTexture);
 	}
@@ -610,8 +699,16 @@ bool spoutDX::SendTexture(ID3D11Texture2D* pTexture,
 // Function: SendImage
 // Send pixel image
 // Optional line pitch
+//
+// The pixels are written to the next of a ring of staging textures
+// before the shared texture is locked. The lock is then held only
+// while the GPU copies the staging texture to the shared texture.
+//
 bool spoutDX::SendImage(const unsigned char * pData, unsigned int width, unsigned int height, unsigned int pitch)
 {
+	SPOUT_TIMER("spoutDX::SendImage");
+	SPOUT_TRACE("spoutDX::SendImage");
+
 	// Quit if no data
 	if (!pData)
 		return false;
@@ -625,14 +722,172 @@ bool spoutDX::SendImage(const unsigned char * pData, unsigned int width, unsigne
 	if(pitch > 0)
 		rowpitch = pitch;
 
+	// Memory share mode : also write to a frame ring for CPU receivers
+	if (m_bMemoryShare)
+		SendFrameRing(pData, rowpitch);
+
+	// The whole image or the rectangles changed (see AddDirtyRects)
+	const unsigned int nrects = ClipDirtyRects(width, height);
+
+	// Write the pixels to the next upload texture without locking the shared texture
+	if (!CheckUploadTexture(width, height, m_dwFormat))
+		return false;
+	D3D11_MAPPED_SUBRESOURCE mappedSubResource={};
+	ID3D11Texture2D* pUpload = MapUploadTexture(mappedSubResource);
+	if (!pUpload)
+		return false;
+	{
+		SPOUT_TRACE("Upload");
+		const RECT image = { 0, 0, (LONG)width, (LONG)height };
+		LONG64 nbytes = 0;
+		for (unsigned int i = 0; i < ((nrects > 0) ? nrects : 1); i++) {
+			const RECT& rc = (nrects > 0) ? m_DirtyRects[i] : image;
+			const size_t linebytes = (size_t)(rc.right - rc.left)*4;
+			const unsigned char* src = pData + (size_t)rc.top*rowpitch + (size_t)rc.left*4;
+			unsigned char* dst = static_cast<unsigned char*>(mappedSubResource.pData)
+				+ (size_t)rc.top*mappedSubResource.RowPitch + (size_t)rc.left*4;
+			for (LONG y = rc.top; y < rc.bottom; y++) {
+				memcpy(dst, src, linebytes);
+				src += rowpitch;
+				dst += mappedSubResource.RowPitch;
+			}
+			nbytes += (LONG64)linebytes*(LONG64)(rc.bottom - rc.top);
+		}
+		AddCounter(COUNTER_BYTES_UPLOADED, nbytes);
+	}
+	m_pImmediateContext->Unmap(pUpload, 0);
+
+	// Check the sender mutex for access the shared texture
+	if (CheckSharedTextureAccess()) {
+		// Copy the upload texture to the shared texture
+		if (nrects > 0)
+			CopyDirtyRects(pUpload, nrects);
+		else
+			m_pImmediateContext->CopyResource(m_pSharedTexture, pUpload);
+		// Flush the command queue because the shared texture has been updated on this device
+		m_pImmediateContext->Flush();
+		PublishDirtyRects(nrects);
+		// Signal a new frame while the mutex is locked
+		frame.SetNewFrame();
+		AddCounter(COUNTER_FRAMES_SENT);
+		// Allow access to the shared texture
+		frame.AllowTextureAccess(m_pSharedTexture);
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: SendImage
+// Send pixel image of a given format
+//
+//   SPOUT_PIXEL_RGBA, _BGRA        - converted to the sender format if necessary
+//   SPOUT_PIXEL_NV12, _YUY2, _UYVY - limited range using the matrix set by SetYUVMatrix
+//
+// Pixels are converted directly to the next SendImage staging texture
+// which is copied to the sender's shared texture.
+// The sender format must be RGBA or BGRA (see SetSenderFormat).
+// Optional line pitch. For NV12 this is the pitch of both planes.
+// With dirty rectangles (see AddDirtyRects), only those parts of RGBA and BGRA
+// images are converted. Y'CbCr images and memory share mode convert the whole image.
+//
+bool spoutDX::SendImage(const unsigned char * pData, unsigned int width, unsigned int height,
+	SpoutPixelFormat format, unsigned int pitch)
+{
+	SPOUT_TIMER("spoutDX::SendImage");
+	SPOUT_TRACE("spoutDX::SendImage format");
+
+	// Quit if no data
+	if (!pData)
+		return false;
+
+	const bool bYUV = (format == SPOUT_PIXEL_NV12 || format == SPOUT_PIXEL_YUY2 || format == SPOUT_PIXEL_UYVY);
+	if (!bYUV && format != SPOUT_PIXEL_RGBA && format != SPOUT_PIXEL_BGRA) {
+		SpoutLogWarning("spoutDX::SendImage - pixel format %d not supported", (int)format);
+		return false;
+	}
+
+	// Create or update the sender
+	if (!CheckSender(width, height, m_dwFormat))
+		return false;
+
+	// 8 bit RGBA or BGRA sender
+	// DXGI_FORMAT_B8G8R8A8_UNORM (87), B8G8R8X8_UNORM (88), R8G8B8A8_UNORM (28)
+	const bool bBGRA = (m_dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM || m_dwFormat == DXGI_FORMAT_B8G8R8X8_UNORM);
+	if (!bBGRA && m_dwFormat != DXGI_FORMAT_R8G8B8A8_UNORM) {
+		SpoutLogWarning("spoutDX::SendImage - sender format %d not supported for conversion", m_dwFormat);
+		return false;
+	}
+
+	if (!CheckUploadTexture(width, height, m_dwFormat))
+		return false;
+
+	// The whole image or the rectangles changed
+	const unsigned int nrects = ClipDirtyRects(width, height);
+
+	// Convert to the next upload texture
+	D3D11_MAPPED_SUBRESOURCE mappedSubResource={};
+	ID3D11Texture2D* pUpload = MapUploadTexture(mappedSubResource);
+	if (!pUpload)
+		return false;
+	{
+		SPOUT_TRACE("spoutCopy");
+		if (bYUV) {
+			spoutcopy.yuv2rgba(pData, mappedSubResource.pData, width, height, pitch,
+				mappedSubResource.RowPitch, (int)format, m_YUVMatrix, bBGRA, false);
+		}
+		else if (nrects > 0 && !m_bMemoryShare) {
+			// Only the rectangles copied to the shared texture.
+			// The staging texture retains an earlier frame elsewhere.
+			const unsigned int rowpitch = (pitch > 0) ? pitch : width*4;
+			const DWORD dwSource = (format == SPOUT_PIXEL_BGRA) ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+			for (unsigned int i = 0; i < nrects; i++) {
+				const RECT& rc = m_DirtyRects[i];
+				unsigned char* dest = static_cast<unsigned char*>(mappedSubResource.pData)
+					+ (size_t)rc.top*mappedSubResource.RowPitch + (size_t)rc.left*4;
+				spoutcopy.region2rgba(pData, dest, (unsigned int)rc.left, (unsigned int)rc.top,
+					(unsigned int)(rc.right-rc.left), (unsigned int)(rc.bottom-rc.top),
+					rowpitch, mappedSubResource.RowPitch, dwSource, bBGRA ? GL_BGRA_EXT : GL_RGBA, false);
+			}
+		}
+		else {
+			const unsigned int rowpitch = (pitch > 0) ? pitch : width*4;
+			if (bBGRA != (format == SPOUT_PIXEL_BGRA))
+				spoutcopy.rgba2bgra(pData, mappedSubResource.pData, width, height,
+					rowpitch, mappedSubResource.RowPitch, false);
+			else
+				spoutcopy.rgba2rgba(pData, mappedSubResource.pData, width, height,
+					rowpitch, mappedSubResource.RowPitch, false);
+		}
+		AddCounter(COUNTER_CONVERSIONS);
+	}
+
+	// Memory share mode : also write to a frame ring for CPU receivers
+	if (m_bMemoryShare)
+		SendFrameRing(static_cast<const unsigned char*>(mappedSubResource.pData), mappedSubResource.RowPitch);
+
+	m_pImmediateContext->Unmap(pUpload, 0);
+
 	// Check the sender mutex for access the shared texture
-	if (frame.CheckTextureAccess(m_pSharedTexture)) {
-		// Update the shared texture resource with the pixel buffer
-		m_pImmediateContext->UpdateSubresource(m_pSharedTexture, 0, NULL, pData, rowpitch, 0);
+	if (CheckSharedTextureAccess()) {
+		// Copy the upload texture to the shared texture
+		if (nrects > 0) {
+			CopyDirtyRects(pUpload, nrects);
+			for (unsigned int i = 0; i < nrects; i++) {
+				const RECT& rc = m_DirtyRects[i];
+				AddCounter(COUNTER_BYTES_UPLOADED, (LONG64)(rc.right-rc.left)*4*(LONG64)(rc.bottom-rc.top));
+			}
+		}
+		else {
+			m_pImmediateContext->CopyResource(m_pSharedTexture, pUpload);
+			AddCounter(COUNTER_BYTES_UPLOADED, (LONG64)mappedSubResource.RowPitch*(LONG64)height);
+		}
 		// Flush the command queue because the shared texture has been updated on this device
 		m_pImmediateContext->Flush();
+		PublishDirtyRects(nrects);
 		// Signal a new frame while the mutex is locked
 		frame.SetNewFrame();
+		AddCounter(COUNTER_FRAMES_SENT);
 		// Allow access to the shared texture
 		frame.AllowTextureAccess(m_pSharedTexture);
 	}
@@ -640,6 +895,39 @@ bool spoutDX::SendImage(const unsigned char * pData, unsigned int width, unsigne
 	return true;
 }
 
+//---------------------------------------------------------
+// Function: AddDirtyRects
+// Add rectangles changed since the last frame sent
+//
+//    The next SendImage or SendTexture updates only these parts
+//    of the shared texture and publishes them with the frame
+//    for receivers (see GetDirtyRects). Rectangles are merged if they
+//    overlap, if one covering both is no larger, or if there are more
+//    than SPOUT_DIRTY_RECTS.
+//    They are cleared when the frame is sent. The whole frame is sent
+//    if there are none, if they cover most of it, or if the sender
+//    has been created or changed size. For SendTexture with a region,
+//    the rectangles are relative to the region.
+//
+bool spoutDX::AddDirtyRects(const RECT* rects, int count)
+{
+	if (!rects || count <= 0)
+		return false;
+
+	for (int i = 0; i < count; i++)
+		CoalesceDirtyRect(rects[i]);
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: ClearDirtyRects
+// Send the whole of the next frame
+void spoutDX::ClearDirtyRects()
+{
+	m_DirtyRectCount = 0;
+}
+
 //---------------------------------------------------------
 // Function: IsInitialized
 // Initialization status
@@ -761,6 +1049,8 @@ void spoutDX::ReleaseReceiver()
 	m_pStaging[1] = nullptr;
 	m_Index = 0;
 	m_NextIndex = 0;
+	if (m_pRegionStaging) spoutdx.ReleaseDX11Texture(m_pd3dDevice, m_pRegionStaging);
+	m_pRegionStaging = nullptr;
 
 	// Flush now to avoid deferred object destruction
 	if (m_pImmediateContext) m_pImmediateContext->Flush();
@@ -769,8 +1059,10 @@ void spoutDX::ReleaseReceiver()
 	frame.CloseAccessMutex();
 	frame.CleanupFrameCount();
 
-	// Close shared memory buffer if used
-	memorybuffer.Close();
+	// Close shared memory buffer, frame ring and dirty rectangles if used
+	CloseMemoryBuffer();
+	framering.Close();
+	CloseDirtyRects();
 
 	// Zero width and height so that they are reset when a sender is found
 	m_Width = 0;
@@ -788,6 +1080,8 @@ void spoutDX::ReleaseReceiver()
 //
 bool spoutDX::ReceiveTexture()
 {
+	SPOUT_TRACE("spoutDX::ReceiveTexture");
+
 	// Return if flagged for update
 	// The update flag is reset to false when
 	// the receiving application calls IsUpdated()
@@ -827,11 +1121,13 @@ bool spoutDX::ReceiveTexture()
 		//
 		// Found a sender
 		//
-		if (frame.CheckTextureAccess(m_pSharedTexture)) {
+		if (CheckSharedTextureAccess()) {
 			// Check if the sender has produced a new frame.
 			if (frame.GetNewFrame()) {
 				// Copy from the sender's shared texture to the receiving class texture.
 				m_pImmediateContext->CopyResource(m_pTexture, m_pSharedTexture);
+				AddCounter(COUNTER_FRAMES_RECEIVED);
+				ReceiveDirtyRects(false);
 				// Testing has shown that Flush is needed here for the texture
 				// to be immediately available for subsequent copy.
 				// May be removed if the texture is not immediately copied.
@@ -863,6 +1159,8 @@ bool spoutDX::ReceiveTexture()
 //
 bool spoutDX::ReceiveTexture(ID3D11Texture2D** ppTexture)
 {
+	SPOUT_TRACE("spoutDX::ReceiveTexture");
+
 	// No texture
 	if (!ppTexture)
 		return false;
@@ -899,11 +1197,13 @@ bool spoutDX::ReceiveTexture(ID3D11Texture2D** ppTexture)
 		//
 		// Found a sender
 		//
-		if (frame.CheckTextureAccess(m_pSharedTexture)) {
+		if (CheckSharedTextureAccess()) {
 			// Check if the sender has produced a new frame.
 			if (frame.GetNewFrame()) {
 				// Copy from the sender's shared texture to the receiving texture.
 				m_pImmediateContext->CopyResource(pTexture, m_pSharedTexture);
+				AddCounter(COUNTER_FRAMES_RECEIVED);
+				ReceiveDirtyRects(false);
 				// Testing has shown that Flush is needed here for the texture
 				// to be immediately available for subsequent copy.
 				// May be removed if the texture is not immediately copied.
@@ -935,6 +1235,9 @@ bool spoutDX::ReceiveTexture(ID3D11Texture2D** ppTexture)
 bool spoutDX::ReceiveImage(unsigned char * pixels,
 	unsigned int width, unsigned int height, bool bRGB, bool bInvert)
 {
+	SPOUT_TIMER("spoutDX::ReceiveImage");
+	SPOUT_TRACE("spoutDX::ReceiveImage");
+
 	// Return if flagged for update
 	// The update flag is reset when the receiving application calls IsUpdated()
 	if (m_bUpdated)
@@ -959,6 +1262,15 @@ bool spoutDX::ReceiveImage(unsigned char * pixels,
 		if (!pixels)
 			return false;
 
+		// Memory share mode : read from the sender's frame ring if it has one
+		// The frame ring has RGBA or RGB pixels only and is not rotated
+		if (m_bMemoryShare && m_ReceiveFormat < 0 && m_Rotation == 0 && !m_bRegion && ReceiveFrameRing(pixels, width, height, bRGB, bInvert)) {
+			// Dirty rectangles are not recorded for frame ring frames
+			m_ReceivedRectCount = 0;
+			m_bConnected = true;
+			return true;
+		}
+
 		// No staging textures - no copy
 		if (!m_pStaging[0] || !m_pStaging[1])
 			return false;
@@ -967,23 +1279,49 @@ bool spoutDX::ReceiveImage(unsigned char * pixels,
 		// Found a sender
 		//
 		// Access the sender shared texture
-		if (frame.CheckTextureAccess(m_pSharedTexture)) {
+		bool bRegionRead = true;
+		if (CheckSharedTextureAccess()) {
 			// Check if the sender has produced a new frame.
 			if (frame.GetNewFrame()) {
-				// Read from the sender GPU texture to CPU pixels via two staging textures
-				// One texture - approx 7 - 12 msec at 1920x1080
-				// Two textures - approx 2.5 - 3.5 msec at 1920x1080
-				m_Index = (m_Index + 1) % 2;
-				m_NextIndex = (m_Index + 1) % 2;
-				// Copy from the sender's shared texture to the first staging texture
-				m_pImmediateContext->CopyResource(m_pStaging[m_Index], m_pSharedTexture);
-				// Map and read from the second while the first is occupied
-				ReadPixelData(m_pStaging[m_NextIndex], pixels, width, height, bRGB, bInvert, m_bSwapRB);
+				SPOUT_TRACE_COUNTER("spoutDX::SenderFrame", frame.GetSenderFrame());
+				AddCounter(COUNTER_FRAMES_RECEIVED);
+				// The pixels read from staging are from the frame before
+				ReceiveDirtyRects(!m_bRegion);
+				if (m_bRegion) {
+					// Copy and read only the region requested by ReceiveImageRegion
+					bRegionRead = ReadRegionPixels(m_pSharedTexture, m_RegionBox, pixels, bRGB, bInvert, m_Rotation);
+					if (bRegionRead)
+						UpdateTileMap(pixels, width, height, bRGB ? 3 : 4);
+				}
+				else {
+					// Read from the sender GPU texture to CPU pixels via two staging textures
+					// One texture - approx 7 - 12 msec at 1920x1080
+					// Two textures - approx 2.5 - 3.5 msec at 1920x1080
+					m_Index = (m_Index + 1) % 2;
+					m_NextIndex = (m_Index + 1) % 2;
+					// Copy from the sender's shared texture to the first staging texture
+					{
+						SPOUT_TRACE("CopyResource");
+						m_pImmediateContext->CopyResource(m_pStaging[m_Index], m_pSharedTexture);
+					}
+					// Map and read from the second while the first is occupied
+					if (ReadPixelData(m_pStaging[m_NextIndex], pixels, width, height, bRGB, bInvert, m_bSwapRB, m_Rotation))
+						UpdateTileMap(pixels, width, height, bRGB ? 3 : 4);
+				}
+			}
+			else {
+				// No new frame, so the pixels are unchanged
+				if (m_bFrameHash)
+					m_bFrameIdentical = true;
+				UpdateTileMap(nullptr, width, height, bRGB ? 3 : 4);
 			}
 			// Allow access to the shared texture
 			frame.AllowTextureAccess(m_pSharedTexture);
 		}
 		m_bConnected = true;
+		// The pixels are not changed if a region could not be read
+		if (!bRegionRead)
+			return false;
 	} // sender exists
 	else {
 		// There is no sender or the connected sender closed.
@@ -997,6 +1335,239 @@ bool spoutDX::ReceiveImage(unsigned char * pixels,
 
 }
 
+//---------------------------------------------------------
+// Function: ReceiveImage
+// Receive from a sender to a pixel buffer of the given format
+//
+//   SPOUT_PIXEL_RGBA, _BGRA - 4 bytes per pixel
+//   SPOUT_PIXEL_RGB, _BGR   - 3 bytes per pixel
+//   SPOUT_PIXEL_V210        - 10 bit 4:2:2 packed, 128 byte aligned lines
+//   SPOUT_PIXEL_P010        - 10 bit 4:2:0 planar Y and interleaved CbCr
+//   SPOUT_PIXEL_P210        - 10 bit 4:2:2 planar Y and interleaved CbCr
+//   SPOUT_PIXEL_RGBA16      - 16 bit unsigned RGBA, 8 bytes per pixel
+//
+// Use spoutCopy::GetPixelBufferSize to allocate the buffer.
+// Y'CbCr formats are limited range using the matrix set by SetYUVMatrix.
+// RGBA16 retains the precision of high bit depth senders unless the
+// image is resampled. Y'CbCr and RGBA16 images are not rotated.
+//
+bool spoutDX::ReceiveImage(unsigned char * pixels,
+	unsigned int width, unsigned int height, SpoutPixelFormat format, bool bInvert)
+{
+	m_ReceiveFormat = (int)format;
+	const bool bRGB = (format == SPOUT_PIXEL_RGB || format == SPOUT_PIXEL_BGR);
+	const bool bRet = ReceiveImage(pixels, width, height, bRGB, bInvert);
+	m_ReceiveFormat = -1;
+	return bRet;
+}
+
+//---------------------------------------------------------
+// Function: ReceiveImage
+// Receive an image and the tiles changed since the last frame
+//
+// Set tiles->tileSize before the call, 64 pixels by default.
+// The received pixels are compared with a copy of the previous frame
+// kept by the class. All tiles are changed for the first frame or
+// if the size or format changes. No tiles are changed if the sender
+// has not produced a new frame.
+//
+// Recording and network relay receivers can use the changed tiles
+// to encode or send only the differences.
+//
+bool spoutDX::ReceiveImage(unsigned char * pixels,
+	unsigned int width, unsigned int height, bool bRGB, bool bInvert, SpoutTileMap* tiles)
+{
+	if (tiles)
+		tiles->changedTiles = 0;
+	m_pTileMap = tiles;
+	const bool bRet = ReceiveImage(pixels, width, height, bRGB, bInvert);
+	m_pTileMap = nullptr;
+	return bRet;
+}
+
+//---------------------------------------------------------
+// Function: ReceiveImageRegion
+// Receive a region of the sender image
+//
+//   x, y          - region position in the sender texture
+//   width, height - region size. Also the size of the pixel buffer,
+//                   or height x width for a rotation of 90 or 270 degrees.
+//
+// Only the region is copied to a staging texture of the region size
+// and converted, so the cost depends on the region rather than the sender.
+// The region can change every frame. The staging texture is re-used
+// unless a larger region is requested. The region must be within the sender.
+// Returns false if it is not, or if the region could not be read.
+//
+bool spoutDX::ReceiveImageRegion(unsigned char * pixels, unsigned int x, unsigned int y,
+	unsigned int width, unsigned int height, bool bRGB, bool bInvert)
+{
+	// The sender size is known after the first update
+	if (width == 0 || height == 0 || (m_Width > 0 && m_Height > 0
+		&& (x >= m_Width || y >= m_Height || width > m_Width - x || height > m_Height - y))) {
+		SpoutLogWarning("spoutDX::ReceiveImageRegion - region %u, %u, %u, %u is outside the %ux%u sender",
+			x, y, width, height, m_Width, m_Height);
+		return false;
+	}
+
+	m_RegionBox = { x, y, 0, x + width, y + height, 1 };
+	m_bRegion = true;
+	const bool bRotated = (m_Rotation == 90 || m_Rotation == 270);
+	const bool bRet = ReceiveImage(pixels, bRotated ? height : width, bRotated ? width : height, bRGB, bInvert);
+	m_bRegion = false;
+	return bRet;
+}
+
+//---------------------------------------------------------
+// Function: SetYUVMatrix
+// Set the Y'CbCr matrix for ReceiveImage
+//   SPOUT_YUV_BT601, SPOUT_YUV_BT709 (default) or SPOUT_YUV_BT2020
+void spoutDX::SetYUVMatrix(int matrix)
+{
+	m_YUVMatrix = matrix;
+}
+
+//---------------------------------------------------------
+// Function: GetYUVMatrix
+// Return the Y'CbCr matrix for ReceiveImage
+int spoutDX::GetYUVMatrix()
+{
+	return m_YUVMatrix;
+}
+
+//---------------------------------------------------------
+// Function: SetResampleFilter
+// Set the filter for ReceiveImage if the size is different from the sender
+//
+//   SPOUT_FILTER_NEAREST  - nearest neighbour (default)
+//   SPOUT_FILTER_LINEAR   - bilinear for enlarging, area average for reducing
+//   SPOUT_FILTER_BICUBIC  - Catmull-Rom bicubic
+//   SPOUT_FILTER_MITCHELL - Mitchell-Netravali, softer than bicubic
+//   SPOUT_FILTER_LANCZOS3 - sharpest
+//
+void spoutDX::SetResampleFilter(int filter)
+{
+	m_ResampleFilter = filter;
+}
+
+//---------------------------------------------------------
+// Function: GetResampleFilter
+// Return the filter for ReceiveImage resampling
+int spoutDX::GetResampleFilter()
+{
+	return m_ResampleFilter;
+}
+
+//---------------------------------------------------------
+// Function: SetResampleGamma
+// Resample in linear light for SPOUT_FILTER_LINEAR
+//
+//   Averaging sRGB values darkens fine detail and edges when reducing.
+//   Converting to linear light first is more accurate but slower.
+//   Default false.
+//
+void spoutDX::SetResampleGamma(bool bGammaCorrect)
+{
+	m_bResampleGamma = bGammaCorrect;
+}
+
+//---------------------------------------------------------
+// Function: GetResampleGamma
+// Return whether SPOUT_FILTER_LINEAR resamples in linear light
+bool spoutDX::GetResampleGamma()
+{
+	return m_bResampleGamma;
+}
+
+//---------------------------------------------------------
+// Function: SetReceiveRotation
+// Set clockwise rotation of ReceiveImage pixels
+//
+//   0, 90, 180 or 270 degrees. Negative values rotate anti-clockwise.
+//   90 and 270 exchange the width and height of the received image,
+//   so the pixel buffer is sender height x sender width.
+//   Applies to RGBA, BGRA, RGB and BGR pixels.
+//
+void spoutDX::SetReceiveRotation(int degrees)
+{
+	const int rotation = ((degrees % 360) + 360) % 360;
+	if (rotation % 90 != 0) {
+		SpoutLogWarning("spoutDX::SetReceiveRotation - %d degrees not supported", degrees);
+		m_Rotation = 0;
+		return;
+	}
+	m_Rotation = rotation;
+}
+
+//---------------------------------------------------------
+// Function: GetReceiveRotation
+// Return clockwise rotation of ReceiveImage pixels
+int spoutDX::GetReceiveRotation()
+{
+	return m_Rotation;
+}
+
+//---------------------------------------------------------
+// Function: SetFrameHash
+// Hash the pixels of each frame received by ReceiveImage
+//
+// Senders can re-send the same frame, for example a paused video.
+// After ReceiveImage, IsFrameIdentical shows whether the content
+// is the same as the last frame so that processing can be skipped.
+// The pixels returned are hashed after conversion, so the hash
+// depends on the receiving format and size as well as the content.
+// The hash is an extra pass over the pixels just written,
+// approximately 0.5 msec at 1920x1080, rather than a second read
+// of the mapped staging texture.
+//
+void spoutDX::SetFrameHash(bool bHash)
+{
+	m_bFrameHash = bHash;
+	m_FrameHash = 0;
+	m_bFrameIdentical = false;
+}
+
+//---------------------------------------------------------
+// Function: GetFrameHash
+// Return the hash of the last frame received.
+// 0 if SetFrameHash is not enabled or no frame has been received.
+uint64_t spoutDX::GetFrameHash()
+{
+	return m_FrameHash;
+}
+
+//---------------------------------------------------------
+// Function: IsFrameIdentical
+// Return whether the last frame received is the same as the one before
+bool spoutDX::IsFrameIdentical()
+{
+	return m_bFrameIdentical;
+}
+
+//---------------------------------------------------------
+// Function: GetDirtyRects
+// Rectangles changed in the last frame received
+//
+//    Returns the number of rectangles or 0 if the whole frame is to be
+//    treated as changed. This is the case for the first frame, if frames were
+//    missed, or if the sender does not use dirty rectangles (see AddDirtyRects).
+//    For ReceiveImage, they are the changes of the pixels returned from
+//    the previous pixels. Check IsFrameNew first. Up to maxcount
+//    rectangles are copied. Allow for SPOUT_DIRTY_RECTS.
+//
+//    Rectangles are in sender coordinates. For ReceiveImageRegion they
+//    are not clipped to the region or offset to the region origin,
+//    and the region rotation is not applied.
+//
+int spoutDX::GetDirtyRects(RECT* rects, int maxcount)
+{
+	if (rects && maxcount > 0) {
+		const unsigned int n = ((unsigned int)maxcount < m_ReceivedRectCount) ? (unsigned int)maxcount : m_ReceivedRectCount;
+		memcpy(rects, m_ReceivedRects, n*sizeof(RECT));
+	}
+	return (int)m_ReceivedRectCount;
+}
+
 //---------------------------------------------------------
 // Function: ReadTexurePixels
 // Read pixels from texture
@@ -1037,6 +1608,23 @@ bool spoutDX::ReadTexurePixels(ID3D11Texture2D* pTexture, unsigned char* pixels)
 
 }
 
+//---------------------------------------------------------
+// Function: ReadTexurePixels
+// Read pixels from a region of a texture
+//
+// The pixel buffer is width x height rgba.
+// Only the region is copied to staging and converted.
+//
+bool spoutDX::ReadTexurePixels(ID3D11Texture2D* pTexture, unsigned char* pixels,
+	unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+	if (!pTexture || !pixels || !m_pImmediateContext)
+		return false;
+
+	const D3D11_BOX box = { x, y, 0, x + width, y + height, 1 };
+	return ReadRegionPixels(pTexture, box, pixels, false, false, 0);
+}
+
 //---------------------------------------------------------
 // Function: SelectSender
 // Open sender selection dialog
@@ -1741,40 +2329,26 @@ bool spoutDX::WriteMemoryBuffer(const char *name, const char* data, int length)
 
 	// Create a shared memory map for the buffer if it does not exist yet
 	if (memorybuffer.Size() == 0) {
-		// Create a name for the map from the sender name
-		std::string namestring = name;
-		namestring += "_map";
-		// The first 16 bytes are reserved for the memory map size. Make the map larger to compensate. 
-		if (!memorybuffer.Create(namestring.c_str(), length + 16)) {
-			SpoutLogError("SpoutSharedMemory::WriteMemoryBuffer - could not create shared memory");
-			return false;
-		}
-		char* pBuffer = memorybuffer.Lock();
-		if (!pBuffer) {
-			SpoutLogError("SpoutSharedMemory::WriteMemoryBuffer - no buffer lock");
+		if (!CreateMemoryBuffer(name, length))
 			return false;
-		}
-		// Convert the map size to decimal digit chars directly to shared memory
-		_itoa_s(length, reinterpret_cast<char *>(pBuffer), 16, 10);
-		memorybuffer.Unlock();
-		SpoutLogNotice("SpoutSharedMemory::WriteMemoryBuffer - created memory buffer %d bytes", length);
 	}
 
-	char* pBuffer = memorybuffer.Lock();
-	if (!pBuffer) {
-		SpoutLogError("SpoutSharedMemory::WriteMemoryBuffer - no buffer lock");
+	if (!m_pBufferHeader || length < 0 || length > MemoryBufferSlotLength()) {
+		SpoutLogError("SpoutSharedMemory::WriteMemoryBuffer - data length %d exceeds the buffer size", length);
 		return false;
 	}
 
-	// Write user data to shared memory (skip the map size)
-	memcpy(reinterpret_cast<void *>(pBuffer + 16), reinterpret_cast<const void *>(data), length);
+	int size = 0;
+	char* pData = BeginMemoryBufferWrite(&size);
+	if (!pData) {
+		SpoutLogError("SpoutSharedMemory::WriteMemoryBuffer - no buffer lock");
+		return false;
+	}
 
-	// Terminate the shared memory data with a null.
-	// The map is created larger in advance to allow for it.
-	if (memorybuffer.Size() > (16 + length))
-		*(pBuffer + 16 + length) = 0;
+	// Write user data to shared memory
+	memcpy(reinterpret_cast<void *>(pData), reinterpret_cast<const void *>(data), length);
 
-	memorybuffer.Unlock();
+	EndMemoryBufferWrite(length);
 
 	return true;
 }
@@ -1801,30 +2375,11 @@ int spoutDX::ReadMemoryBuffer(const char* name, char* data, int maxlength)
 		return 0;
 	}
 
-	// Open a shared memory map for the buffer if it not already
-	if (!memorybuffer.Name()) {
-		// Create a name for the map from the sender name
-		std::string namestring = name;
-		namestring += "_map";
-		// Open the shared memory. This also creates a mutex
-		// for the reader to lock and unlock the map for reads.
-		if (!memorybuffer.Open(namestring.c_str())) {
-			return 0;
-		}
-		SpoutLogNotice("SpoutSharedMemory::ReadMemoryBuffer - opened sender memory map [%s]", memorybuffer.Name());
-	}
-
-	char* pBuffer = memorybuffer.Lock();
-	if (!pBuffer) {
-		SpoutLogError("SpoutSharedMemory::ReadMemoryBuffer - no buffer lock");
+	// Number of bytes written by the sender
+	int nbytes = 0;
+	const char* pData = BeginMemoryBufferRead(name, &nbytes);
+	if (!pData)
 		return 0;
-	}
-
-	// The memory map includes it's size, saved as the first 16 bytes
-	*(pBuffer + 15) = 0; // End for atoi
-
-	// Number of bytes available for data transfer
-	int nbytes = atoi(reinterpret_cast<char *>(pBuffer));
 
 	// Reduce if the user buffer max length is less
 	if (maxlength < nbytes)
@@ -1832,10 +2387,10 @@ int spoutDX::ReadMemoryBuffer(const char* name, char* data, int maxlength)
 
 	// Copy bytes from shared memory to the user buffer
 	if (nbytes > 0)
-		memcpy(reinterpret_cast<void *>(data), reinterpret_cast<const void *>(pBuffer + 16), nbytes);
+		memcpy(reinterpret_cast<void *>(data), reinterpret_cast<const void *>(pData), nbytes);
 
 	// Done with the shared memory buffer pointer
-	memorybuffer.Unlock();
+	EndMemoryBufferRead();
 
 	return nbytes;
 
@@ -1850,6 +2405,21 @@ int spoutDX::ReadMemoryBuffer(const char* name, char* data, int maxlength)
 //    if the length of the data to send will vary.
 //    The map is closed when the sender is released.
 bool spoutDX::CreateMemoryBuffer(const char *name, int length)
+{
+	return CreateMemoryBuffer(name, length, 1);
+}
+
+//---------------------------------------------------------
+// Function: CreateMemoryBuffer
+// Create a sender shared memory buffer with a number of slots.
+//
+//    With SPOUT_BUFFER_SLOTS, each write goes to a slot that
+//    no receiver is reading and is then published, so that readers
+//    never block the writer and the mutex is not used.
+//    Each slot has "length" bytes available for data transfer.
+//
+//    Receivers using an earlier SDK version read all slots as one buffer.
+bool spoutDX::CreateMemoryBuffer(const char *name, int length, int slots)
 {
 	// Quit if 2.006 memoryshare mode
 	if (m_bMemoryShare)
@@ -1860,6 +2430,11 @@ bool spoutDX::CreateMemoryBuffer(const char *name, int length)
 		return false;
 	}
 
+	if (length <= 0 || (slots != 1 && slots != SPOUT_BUFFER_SLOTS)) {
+		SpoutLogError("spoutDX::CreateMemoryBuffer - invalid length %d or slots %d", length, slots);
+		return false;
+	}
+
 	if (memorybuffer.Size() > 0) {
 		SpoutLogError("spoutDX::CreateMemoryBuffer - shared memory already exists");
 		return false;
@@ -1869,14 +2444,21 @@ bool spoutDX::CreateMemoryBuffer(const char *name, int length)
 	std::string namestring = name;
 	namestring += "_map";
 
+	// Slots after the first are aligned to 16 bytes.
+	// The last byte of each slot is reserved for a null terminator.
+	const int slotsize = (slots > 1) ? ((length + 1 + 15) & ~15) : length;
+	const int capacity = slotsize*slots;
+
 	// The first 16 bytes are reserved to record the number of bytes available
 	// for data transfer. Make the map 16 bytes larger to compensate. 
 	// Add another 16 bytes to allow for a null terminator.
-	// (Use multiples of 16 for alignment to allow for SSE copy : TODO).
-	if (!memorybuffer.Create(namestring.c_str(), length + 32)) {
+	// The binary header follows, aligned to 16 bytes.
+	const int offset = (capacity + 32 + 15) & ~15;
+	if (!memorybuffer.Create(namestring.c_str(), offset + (int)sizeof(SpoutMemoryBufferHeader))) {
 		SpoutLogError("spoutGL::CreateMemoryBuffer - could not create shared memory");
 		return false;
 	}
+	AddCounter(COUNTER_SHARED_MEMORY);
 
 	// The length requested is the number of bytes to be
 	// available for data transfer (map data size).
@@ -1888,11 +2470,20 @@ bool spoutDX::CreateMemoryBuffer(const char *name, int length)
 
 	// Convert the map data size to decimal digit chars
 	// directly to the first 16 bytes of the shared memory.
-	_itoa_s(length, reinterpret_cast<char *>(pBuffer), 16, 10);
+	_itoa_s(capacity, reinterpret_cast<char *>(pBuffer), 16, 10);
+
+	// Binary header
+	m_pBufferHeader = reinterpret_cast<SpoutMemoryBufferHeader*>(pBuffer + offset);
+	ZeroMemory(m_pBufferHeader, sizeof(SpoutMemoryBufferHeader));
+	m_pBufferHeader->magic = SPOUT_BUFFER_MAGIC;
+	m_pBufferHeader->version = SPOUT_BUFFER_VERSION;
+	m_pBufferHeader->capacity = (DWORD)capacity;
+	m_pBufferHeader->slots = (DWORD)slots;
+	m_pBufferHeader->slotSize = (DWORD)slotsize;
 
 	memorybuffer.Unlock();
 
-	SpoutLogNotice("spoutDXL::CreateMemoryBuffer - created memory buffer %d bytes", length);
+	SpoutLogNotice("spoutDXL::CreateMemoryBuffer - created memory buffer %d bytes, %d slots", length, slots);
 
 	return true;
 }
@@ -1914,7 +2505,7 @@ bool spoutDX::DeleteMemoryBuffer()
 		return false;
 	}
 
-	memorybuffer.Close();
+	CloseMemoryBuffer();
 
 	return true;
 
@@ -1931,25 +2522,15 @@ int spoutDX::GetMemoryBufferSize(const char *name)
 		return 0;
 
 	// A writer has created the map and recorded the data length in the first 16 bytes.
-	// Another 16 bytes is added to allow for a terminating NULL. (See CreateMemoryBuffer)
-	// The remaining length is the number of bytes available for data transfer.
-	if (memorybuffer.Size() > 32) {
-		return memorybuffer.Size() - 32;
+	// The binary header also records the number of bytes available for data transfer.
+	if (memorybuffer.Size() > 0 && m_pBufferHeader) {
+		return MemoryBufferSlotLength();
 	}
 
 	// A reader must read the map to get the size
 	// Open a shared memory map for the buffer if it not already
-	if (!memorybuffer.Name()) {
-		// Create a name for the map
-		std::string namestring = name;
-		namestring += "_map";
-		// Open the shared memory map.
-		// This also creates a mutex for the receiver to lock and unlock the map for reads.
-		if (!memorybuffer.Open(namestring.c_str())) {
-			return 0;
-		}
-		SpoutLogNotice("spoutDX::GetMemoryBufferSize - opened sender memory map [%s]", memorybuffer.Name());
-	}
+	if (!OpenMemoryBuffer(name))
+		return 0;
 
 	char* pBuffer = memorybuffer.Lock();
 	if (!pBuffer) {
@@ -1962,26 +2543,328 @@ int spoutDX::GetMemoryBufferSize(const char *name)
 	*(pBuffer + 15) = 0; // End for atoi
 	int nbytes = atoi(reinterpret_cast<char *>(pBuffer));
 
+	// The header records the size of each slot
+	if (!m_pBufferHeader)
+		m_pBufferHeader = FindMemoryBufferHeader(pBuffer, nbytes);
+	if (m_pBufferHeader)
+		nbytes = MemoryBufferSlotLength();
+
 	memorybuffer.Unlock();
 
 	return nbytes;
 
 }
 
-//
-// Options used for SpoutCam
-//
-
 //---------------------------------------------------------
-// Function: SetMirror
-// Set mirror image option
-void spoutDX::SetMirror(bool bMirror)
+// Function: MemoryBufferChanged
+// Has the sender written to the buffer since the last read.
+//
+//    The write sequence in the buffer header is checked without
+//    locking so that a receiver can skip ReadMemoryBuffer if unchanged.
+//    Always true for a sender map without a header.
+bool spoutDX::MemoryBufferChanged(const char* name)
 {
-	m_bMirror = bMirror;
+	SpoutMemoryBufferHeader* header = OpenMemoryBufferHeader(name);
+	if (!header)
+		return memorybuffer.Name() != nullptr;
+
+	const LONG64 sequence = InterlockedCompareExchange64(&header->sequence, 0, 0);
+	return (sequence != m_BufferSequence);
 }
 
 //---------------------------------------------------------
-// Function: SetSwap
+// Function: WriteMemoryBufferMetadata
+// Write per-frame metadata to the buffer header without locking.
+//
+//    For small data such as tracking information that is updated
+//    every frame. The buffer must be created first.
+//    Up to SPOUT_BUFFER_METADATA bytes.
+bool spoutDX::WriteMemoryBufferMetadata(const char* data, int length)
+{
+	if (!data || length < 0 || length > SPOUT_BUFFER_METADATA) {
+		SpoutLogError("spoutDX::WriteMemoryBufferMetadata - invalid data length %d", length);
+		return false;
+	}
+
+	if (memorybuffer.Size() == 0 || !m_pBufferHeader) {
+		SpoutLogError("spoutDX::WriteMemoryBufferMetadata - no memory buffer");
+		return false;
+	}
+
+	// Sequence lock : odd while the metadata is written
+	InterlockedIncrement64(&m_pBufferHeader->metadataSequence);
+	memcpy(m_pBufferHeader->metadata, data, length);
+	m_pBufferHeader->metadataLength = (DWORD)length;
+	InterlockedIncrement64(&m_pBufferHeader->metadataSequence);
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: ReadMemoryBufferMetadata
+// Read per-frame metadata from the buffer header without locking.
+//
+//    The copy is repeated if the sender writes at the same time.
+//    Returns the number of bytes read or 0 if none are available.
+int spoutDX::ReadMemoryBufferMetadata(const char* name, char* data, int maxlength)
+{
+	if (!data || maxlength <= 0)
+		return 0;
+
+	SpoutMemoryBufferHeader* header = OpenMemoryBufferHeader(name);
+	if (!header)
+		return 0;
+
+	for (int i = 0; i < 100; i++) {
+		const LONG64 sequence = InterlockedCompareExchange64(&header->metadataSequence, 0, 0);
+		if (sequence & 1) {
+			// Sender is writing
+			YieldProcessor();
+			continue;
+		}
+		int nbytes = (int)header->metadataLength;
+		if (nbytes > SPOUT_BUFFER_METADATA) nbytes = SPOUT_BUFFER_METADATA;
+		if (nbytes > maxlength) nbytes = maxlength;
+		memcpy(data, header->metadata, nbytes);
+		// The copy is complete if the sequence is unchanged
+		if (InterlockedCompareExchange64(&header->metadataSequence, 0, 0) == sequence)
+			return nbytes;
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------
+// Function: BeginMemoryBufferWrite
+// Begin writing directly to the sender memory buffer.
+//
+//    Returns a pointer to the data and the bytes available.
+//    The buffer must be created first (see CreateMemoryBuffer).
+//    A single slot buffer remains locked until EndMemoryBufferWrite.
+//    With multiple slots, a slot that no receiver is reading is used
+//    without locking. Returns null if none is free.
+//    See also spoutMemoryBufferView.
+char* spoutDX::BeginMemoryBufferWrite(int* size)
+{
+	if (!size || memorybuffer.Size() == 0 || !m_pBufferHeader || m_BufferWriteSlot >= 0)
+		return nullptr;
+
+	*size = 0;
+	SpoutMemoryBufferHeader* header = m_pBufferHeader;
+
+	if (header->slots <= 1) {
+		if (!memorybuffer.Lock())
+			return nullptr;
+		// The sequence is odd while the data is written
+		InterlockedIncrement64(&header->sequence);
+		m_BufferWriteSlot = 0;
+	}
+	else {
+		// Any slot except the last published one that has no readers
+		const LONG published = InterlockedCompareExchange(&header->published, 0, 0);
+		for (LONG i = 0; i < (LONG)header->slots; i++) {
+			if (i != published && InterlockedCompareExchange(&header->readers[i], 0, 0) == 0) {
+				m_BufferWriteSlot = (int)i;
+				break;
+			}
+		}
+		if (m_BufferWriteSlot < 0) {
+			SPOUTLOG_WARNING_LIMIT(1, "spoutDX::BeginMemoryBufferWrite - no free slot");
+			return nullptr;
+		}
+	}
+
+	*size = MemoryBufferSlotLength();
+	return MemoryBufferData(m_BufferWriteSlot);
+}
+
+//---------------------------------------------------------
+// Function: EndMemoryBufferWrite
+// Publish data written after BeginMemoryBufferWrite.
+//
+//    The length is the number of bytes written.
+void spoutDX::EndMemoryBufferWrite(int length)
+{
+	if (!m_pBufferHeader || m_BufferWriteSlot < 0)
+		return;
+
+	SpoutMemoryBufferHeader* header = m_pBufferHeader;
+	if (length < 0) length = 0;
+	if (length > MemoryBufferSlotLength()) length = MemoryBufferSlotLength();
+
+	// Terminate the shared memory data with a null.
+	// The map is created larger in advance to allow for it
+	// and slots reserve their last byte.
+	*(MemoryBufferData(m_BufferWriteSlot) + length) = 0;
+
+	header->slotLength[m_BufferWriteSlot] = (DWORD)length;
+	header->length = (DWORD)length;
+	header->timestamp = GetTimingCount();
+
+	if (header->slots <= 1) {
+		InterlockedIncrement64(&header->sequence);
+		memorybuffer.Unlock();
+	}
+	else {
+		// Publish the slot. The interlocked exchange orders the writes before it.
+		InterlockedExchange(&header->published, (LONG)m_BufferWriteSlot);
+		InterlockedExchangeAdd64(&header->sequence, 2);
+	}
+
+	m_BufferWriteSlot = -1;
+}
+
+//---------------------------------------------------------
+// Function: BeginMemoryBufferRead
+// Begin reading directly from a sender memory buffer.
+//
+//    Returns a pointer to the data and the number of bytes written.
+//    A single slot buffer remains locked until EndMemoryBufferRead.
+//    With multiple slots, the last published slot is read without
+//    locking and the sender writes to another.
+//    See also spoutMemoryBufferView.
+const char* spoutDX::BeginMemoryBufferRead(const char* name, int* length)
+{
+	if (!length || m_BufferReadSlot >= 0 || m_bBufferReadLocked)
+		return nullptr;
+
+	*length = 0;
+	if (!OpenMemoryBuffer(name))
+		return nullptr;
+
+	SpoutMemoryBufferHeader* header = OpenMemoryBufferHeader(name);
+
+	if (!header || header->slots <= 1) {
+		char* pBuffer = memorybuffer.Lock();
+		if (!pBuffer) {
+			SpoutLogError("spoutDX::BeginMemoryBufferRead - no buffer lock");
+			return nullptr;
+		}
+		m_bBufferReadLocked = true;
+		if (!header) {
+			// A sender map without a header includes its size, saved as the first 16 bytes
+			*(pBuffer + 15) = 0; // End for atoi
+			*length = atoi(reinterpret_cast<char *>(pBuffer));
+			return pBuffer + 16;
+		}
+		*length = (int)header->length;
+		m_BufferSequence = header->sequence;
+		return MemoryBufferData(0);
+	}
+
+	// Hold the last published slot. If the sender publishes
+	// another before the hold is registered, try again.
+	for (int i = 0; i < 100; i++) {
+		const LONG slot = InterlockedCompareExchange(&header->published, 0, 0);
+		if (slot < 0 || slot >= (LONG)header->slots)
+			return nullptr;
+		InterlockedIncrement(&header->readers[slot]);
+		if (InterlockedCompareExchange(&header->published, 0, 0) == slot) {
+			m_BufferReadSlot = (int)slot;
+			m_BufferSequence = InterlockedCompareExchange64(&header->sequence, 0, 0);
+			*length = (int)header->slotLength[slot];
+			return MemoryBufferData(m_BufferReadSlot);
+		}
+		InterlockedDecrement(&header->readers[slot]);
+	}
+
+	return nullptr;
+}
+
+//---------------------------------------------------------
+// Function: EndMemoryBufferRead
+// Release the data after BeginMemoryBufferRead
+void spoutDX::EndMemoryBufferRead()
+{
+	if (m_bBufferReadLocked) {
+		memorybuffer.Unlock();
+		m_bBufferReadLocked = false;
+	}
+	else if (m_BufferReadSlot >= 0 && m_pBufferHeader) {
+		InterlockedDecrement(&m_pBufferHeader->readers[m_BufferReadSlot]);
+	}
+	m_BufferReadSlot = -1;
+}
+
+//---------------------------------------------------------
+// Class: spoutMemoryBufferView
+// Scoped view of a sender memory buffer.
+//
+//    Data is written or read in place without a copy
+//    and released when the view goes out of scope.
+//
+//    Sender
+//        spoutMemoryBufferView view(&sender);
+//        if (view.Data()) {
+//            // write up to view.Size() bytes to view.Data()
+//            view.SetLength(nbytes);
+//        }
+//
+//    Receiver
+//        spoutMemoryBufferView view(&receiver, sendername);
+//        if (view.Data()) {
+//            // read view.Size() bytes from view.Data()
+//        }
+//
+spoutMemoryBufferView::spoutMemoryBufferView(spoutDX* spout)
+{
+	m_pSpout = spout;
+	m_bWrite = true;
+	m_pData = spout ? spout->BeginMemoryBufferWrite(&m_Size) : nullptr;
+	m_Length = m_pData ? m_Size : 0;
+}
+
+spoutMemoryBufferView::spoutMemoryBufferView(spoutDX* spout, const char* name)
+{
+	m_pSpout = spout;
+	m_bWrite = false;
+	m_pData = spout ? const_cast<char*>(spout->BeginMemoryBufferRead(name, &m_Size)) : nullptr;
+	m_Length = m_pData ? m_Size : 0;
+}
+
+spoutMemoryBufferView::~spoutMemoryBufferView()
+{
+	if (!m_pData)
+		return;
+	if (m_bWrite)
+		m_pSpout->EndMemoryBufferWrite(m_Length);
+	else
+		m_pSpout->EndMemoryBufferRead();
+}
+
+// Pointer to the data. Null if the view is not available.
+char* spoutMemoryBufferView::Data() const
+{
+	return m_pData;
+}
+
+// Bytes available to write or bytes written by the sender
+int spoutMemoryBufferView::Size() const
+{
+	return m_Size;
+}
+
+// Number of bytes written. The default is the full size.
+void spoutMemoryBufferView::SetLength(int length)
+{
+	if (m_bWrite)
+		m_Length = (length < 0) ? 0 : ((length > m_Size) ? m_Size : length);
+}
+
+//
+// Options used for SpoutCam
+//
+
+//---------------------------------------------------------
+// Function: SetMirror
+// Set mirror image option
+void spoutDX::SetMirror(bool bMirror)
+{
+	m_bMirror = bMirror;
+}
+
+//---------------------------------------------------------
+// Function: SetSwap
 // Set swap red/blue option : RGB <> BGR
 void spoutDX::SetSwap(bool bSwap)
 {
@@ -2004,6 +2887,86 @@ bool spoutDX::GetSwap()
 	return m_bSwapRB;
 }
 
+//
+// Tone mapping
+//
+
+//---------------------------------------------------------
+// Function: SetToneMap
+// Tone map high dynamic range senders for ReceiveImage
+//
+//   toneMap  - SPOUT_TONEMAP_NONE, _REINHARD, _ACES or _BT2390
+//   exposure - scene value multiplier
+//   peakNits - sender peak luminance for Reinhard and BT.2390
+//   bPQ      - R10G10B10A2 and 16 bit unorm senders are PQ encoded BT.2020
+//
+void spoutDX::SetToneMap(int toneMap, float exposure, float peakNits, bool bPQ)
+{
+	m_ToneMap = toneMap;
+	m_ToneMapExposure = exposure;
+	m_ToneMapPeak = peakNits;
+	m_bToneMapPQ = bPQ;
+}
+
+//---------------------------------------------------------
+// Function: GetToneMap
+// Return the tone mapping operator
+int spoutDX::GetToneMap()
+{
+	return m_ToneMap;
+}
+
+//
+// Performance counters
+//
+
+//---------------------------------------------------------
+// Function: GetCounters
+// Get the performance counters for this object.
+// Counters accumulate from object creation or the last reset
+// and can be read from any thread.
+bool spoutDX::GetCounters(SpoutDXcounters* counters)
+{
+	if (!counters)
+		return false;
+
+	LONG64 values[COUNTER_TOTAL]={};
+	for (int i = 0; i < COUNTER_TOTAL; i++)
+		values[i] = InterlockedCompareExchange64(&m_Counters[i], 0, 0);
+
+	// Convert performance counts to milliseconds
+	LARGE_INTEGER frequency={};
+	QueryPerformanceFrequency(&frequency);
+	const double msecs = 1000.0/(double)frequency.QuadPart;
+
+	counters->framesSent           = values[COUNTER_FRAMES_SENT];
+	counters->framesReceived       = values[COUNTER_FRAMES_RECEIVED];
+	counters->bytesUploaded        = values[COUNTER_BYTES_UPLOADED];
+	counters->bytesReadBack        = values[COUNTER_BYTES_READBACK];
+	counters->conversions          = values[COUNTER_CONVERSIONS];
+	counters->resampledConversions = values[COUNTER_RESAMPLED];
+	counters->conversionTime       = (double)values[COUNTER_CONVERSION_TIME]*msecs;
+	counters->stagingMaps          = values[COUNTER_STAGING_MAPS];
+	counters->stagingMapStalls     = values[COUNTER_STAGING_STALLS];
+	counters->stagingMapTime       = (double)values[COUNTER_STAGING_TIME]*msecs;
+	counters->mutexWaits           = values[COUNTER_MUTEX_WAITS];
+	counters->mutexTimeouts        = values[COUNTER_MUTEX_TIMEOUTS];
+	counters->mutexWaitTime        = (double)values[COUNTER_MUTEX_TIME]*msecs;
+	counters->textureCreations     = values[COUNTER_TEXTURES];
+	counters->sharedMemoryOpens    = values[COUNTER_SHARED_MEMORY];
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: ResetCounters
+// Reset all performance counters to zero
+void spoutDX::ResetCounters()
+{
+	for (int i = 0; i < COUNTER_TOTAL; i++)
+		InterlockedExchange64(&m_Counters[i], 0);
+}
+
 
 //
 // Sharing modes
@@ -2019,7 +2982,7 @@ bool spoutDX::GetSwap()
 bool spoutDX::GetDX9()
 {
 	DWORD dwDX9 = 0;
-	ReadDwordFromRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "DX9", &dwDX9);
+	ReadSpoutConfigDword("DX9", &dwDX9);
 	return (dwDX9 == 1);
 }
 
@@ -2030,7 +2993,7 @@ bool spoutDX::GetMemoryShareMode()
 {
 	bool bRet = false;
 	DWORD dwMem = 0;
-	if (ReadDwordFromRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "MemoryShare", &dwMem)) {
+	if (ReadSpoutConfigDword("MemoryShare", &dwMem)) {
 		bRet = (dwMem == 1);
 	}
 	return bRet;
@@ -2215,6 +3178,7 @@ bool spoutDX::CheckSender(unsigned int width, unsigned int height, DWORD dwForma
 			SpoutLogWarning("spoutDX::CheckSender - could not create shared texture");
 			return false;
 		}
+		AddCounter(COUNTER_TEXTURES);
 
 		// Save class width and height and format to test
 		// for sender size changes after initialization
@@ -2222,6 +3186,9 @@ bool spoutDX::CheckSender(unsigned int width, unsigned int height, DWORD dwForma
 		m_Height = height;
 		m_dwFormat = dwFormat;
 
+		// The new texture has no previous frame to update
+		ClearDirtyRects();
+
 		// Create a sender using the DX11 shared texture handle (m_dxShareHandle)
 		// and specifying the same texture format.
 		// If the sender already exists, the name is incremented
@@ -2260,6 +3227,7 @@ bool spoutDX::CheckSender(unsigned int width, unsigned int height, DWORD dwForma
 			SpoutLogWarning("spoutDX::CheckSender - could not re-create shared texture");
 			return false;
 		}
+		AddCounter(COUNTER_TEXTURES);
 
 		// Update the sender information
 		sendernames.UpdateSender(m_SenderName, width, height, m_dxShareHandle, dwFormat);
@@ -2269,6 +3237,9 @@ bool spoutDX::CheckSender(unsigned int width, unsigned int height, DWORD dwForma
 		m_Height = height;
 		m_dwFormat = dwFormat;
 
+		// The whole of the new texture is sent
+		ClearDirtyRects();
+
 	} // end size checks
 
 	return true;
@@ -2408,6 +3379,9 @@ bool spoutDX::ReceiveSenderData()
 			// Release everything and start again
 			ReleaseReceiver();
 
+			// Sender information opened for a new sender
+			AddCounter(COUNTER_SHARED_MEMORY);
+
 			// Update the sender share handle
 			m_dxShareHandle = dxShareHandle;
 
@@ -2415,7 +3389,7 @@ bool spoutDX::ReceiveSenderData()
 			if (!spoutdx.OpenDX11shareHandle(m_pd3dDevice, &m_pSharedTexture, dxShareHandle)) {
 
 				// If this fails, the sender graphics adapter might be different
-				SpoutLogWarning("SpoutReceiver::ReceiveSenderData - could not retrieve sender texture from share handle");
+				SPOUTLOG_WARNING_LIMIT(1, "SpoutReceiver::ReceiveSenderData - could not retrieve sender texture from share handle");
 
 				// If a device has been created within this class, we can re-create it
 				// on the fly using a different graphics adapter if auto adapter switching 
@@ -2441,6 +3415,7 @@ bool spoutDX::ReceiveSenderData()
 				}
 
 			}
+			AddCounter(COUNTER_TEXTURES);
 
 			// Get the texture details to check for zero size
 			D3D11_TEXTURE2D_DESC desc;
@@ -2505,39 +3480,287 @@ void spoutDX::CreateReceiver(const char * SenderName, unsigned int width, unsign
 
 }
 
+//
+// Copy a region of a texture to the region staging texture and read the pixels.
+// The pixel buffer is the region size, rotated if necessary.
+//
+bool spoutDX::ReadRegionPixels(ID3D11Texture2D* pSource, const D3D11_BOX& box,
+	unsigned char* pixels, bool bRGB, bool bInvert, int rotation)
+{
+	if (!pSource || !pixels || !m_pImmediateContext)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc{};
+	pSource->GetDesc(&desc);
+	if (box.left >= box.right || box.top >= box.bottom
+		|| box.right > desc.Width || box.bottom > desc.Height) {
+		SpoutLogWarning("spoutDX::ReadRegionPixels - region %u, %u, %u, %u is outside the %ux%u texture",
+			box.left, box.top, box.right - box.left, box.bottom - box.top, desc.Width, desc.Height);
+		return false;
+	}
+	const unsigned int width = box.right - box.left;
+	const unsigned int height = box.bottom - box.top;
+	if (!CheckRegionStaging(width, height, desc.Format))
+		return false;
+
+	// Copy the region to the top left of the staging texture
+	{
+		SPOUT_TRACE("CopySubresourceRegion");
+		m_pImmediateContext->CopySubresourceRegion(m_pRegionStaging, 0, 0, 0, 0, pSource, 0, &box);
+	}
+
+	// ReadPixelData converts from the class size and format
+	const unsigned int senderWidth = m_Width;
+	const unsigned int senderHeight = m_Height;
+	const DWORD senderFormat = m_dwFormat;
+	m_Width = width;
+	m_Height = height;
+	m_dwFormat = (DWORD)desc.Format;
+	const bool bRotated = (rotation == 90 || rotation == 270);
+	const bool bRet = ReadPixelData(m_pRegionStaging, pixels,
+		bRotated ? height : width, bRotated ? width : height, bRGB, bInvert, m_bSwapRB, rotation);
+	m_Width = senderWidth;
+	m_Height = senderHeight;
+	m_dwFormat = senderFormat;
+
+	return bRet;
+}
+
+//
+// Create the region staging texture or a larger one if necessary.
+// The size is rounded up to 64 pixels so that a region that moves
+// or changes size slightly does not create a new texture.
+//
+bool spoutDX::CheckRegionStaging(unsigned int width, unsigned int height, DXGI_FORMAT format)
+{
+	if (!m_pd3dDevice)
+		return false;
+
+	if (m_pRegionStaging) {
+		D3D11_TEXTURE2D_DESC desc{};
+		m_pRegionStaging->GetDesc(&desc);
+		if (desc.Format == format && desc.Width >= width && desc.Height >= height)
+			return true;
+		if (desc.Format == format) {
+			if (desc.Width > width) width = desc.Width;
+			if (desc.Height > height) height = desc.Height;
+		}
+	}
+
+	width = (width + 63) & ~63u;
+	height = (height + 63) & ~63u;
+	// The SpoutDirectX function releases an existing texture
+	if (!spoutdx.CreateDX11StagingTexture(m_pd3dDevice, width, height, format, &m_pRegionStaging))
+		return false;
+	AddCounter(COUNTER_TEXTURES);
+	return true;
+}
+
 //
 // COPY FROM A DX11 STAGING TEXTURE TO A USER RGBA/RGB/BGR PIXEL BUFFER OF GIVEN SIZE
 //
 // A class device and context must have been created using OpenDirectX11()
 //
-// bRGB    - pixel data is RGB instead of RGBA
-// bInvert - flip the image
-// bSwap   - swap red/blue (BGRA/RGBA or BGR/RGB). Not available for re-sample
+// bRGB     - pixel data is RGB instead of RGBA
+// bInvert  - flip the image
+// bSwap    - swap red/blue (BGRA/RGBA or BGR/RGB)
+// rotation - clockwise 0, 90, 180 or 270 degrees. Width and height are the rotated size.
 //
 bool spoutDX::ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* destpixels,
-	unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwap)
+	unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwap, int rotation)
 {
+	SPOUT_TIMER("spoutDX::ReadPixelData");
+	SPOUT_TRACE("spoutDX::ReadPixelData");
+
 	if (!m_pImmediateContext || !pStagingSource || !destpixels)
 		return false;
 
 	// Map the staging texture resource so we can access the pixels
 	D3D11_MAPPED_SUBRESOURCE mappedSubResource={};
+	const LONGLONG mapStart = GetTimingCount();
 	// Make sure all commands are done before mapping the staging texture
-	spoutdx.FlushWait(m_pd3dDevice, m_pImmediateContext);
+	{
+		SPOUT_TRACE("spoutDirectX::FlushWait");
+		spoutdx.FlushWait(m_pd3dDevice, m_pImmediateContext);
+	}
 	// Map waits for GPU access
-	const HRESULT hr = m_pImmediateContext->Map(pStagingSource, 0, D3D11_MAP_READ, 0, &mappedSubResource);
+	HRESULT hr = E_FAIL;
+	{
+		SPOUT_TRACE("Map");
+		hr = m_pImmediateContext->Map(pStagingSource, 0, D3D11_MAP_READ, 0, &mappedSubResource);
+	}
+	const double mapTime = GetTimingElapsed(mapStart); // milliseconds
+	const LONGLONG mapEnd = GetTimingCount();
+	AddCounter(COUNTER_STAGING_MAPS);
+	AddCounter(COUNTER_STAGING_TIME, mapEnd - mapStart);
+	if (mapTime > 1.0)
+		AddCounter(COUNTER_STAGING_STALLS);
+
 	if (SUCCEEDED(hr)) {
 
+		// Time the pixel conversion
+		SPOUT_TRACE("spoutCopy");
+		AddCounter(COUNTER_BYTES_READBACK, (LONG64)mappedSubResource.RowPitch*(LONG64)m_Height);
+		AddCounter(COUNTER_CONVERSIONS);
+
+		// Pixels are converted at the size before rotation.
+		// Y'CbCr and 16 bit formats are not rotated.
+		const bool bRotate = (rotation != 0 && m_ReceiveFormat < SPOUT_PIXEL_V210);
+		if (bRotate && rotation != 180)
+			std::swap(width, height);
+
+		if (width != m_Width || height != m_Height)
+			AddCounter(COUNTER_RESAMPLED);
+
+		// Pixel format requested by ReceiveImage overrides the rgb and swap flags.
+		// Swap is relative to the texture for RGBA pixels.
+		// High bit depth textures are converted as RGBA.
+		if (m_ReceiveFormat >= 0 && m_ReceiveFormat < SPOUT_PIXEL_V210) {
+			bRGB = (m_ReceiveFormat == SPOUT_PIXEL_RGB || m_ReceiveFormat == SPOUT_PIXEL_BGR);
+			if (bRGB) {
+				bSwap = (m_ReceiveFormat == SPOUT_PIXEL_RGB);
+			}
+			else {
+				const bool bBGRA = !spoutcopy.IsHighBitFormat(m_dwFormat)
+					&& (m_dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM || m_dwFormat == DXGI_FORMAT_B8G8R8X8_UNORM);
+				bSwap = ((m_ReceiveFormat == SPOUT_PIXEL_BGRA) != bBGRA);
+			}
+		}
+
+		// RGBA textures of the sender size are rotated directly to the user buffer.
+		// Otherwise convert to a buffer and rotate that.
+		const bool bRotateDirect = bRotate && !bRGB && width == m_Width && height == m_Height
+			&& !spoutcopy.IsHighBitFormat(m_dwFormat);
+		unsigned char* rotatepixels = nullptr;
+		bool bRotateInvert = false;
+		if (bRotate && !bRotateDirect) {
+			unsigned char* buffer = CheckPixelBuffer(m_pRotateBuffer, m_RotateSize, width*height*(bRGB ? 3 : 4));
+			if (!buffer) {
+				m_pImmediateContext->Unmap(pStagingSource, 0);
+				return false;
+			}
+			rotatepixels = destpixels;
+			destpixels = buffer;
+			bRotateInvert = bInvert;
+			bInvert = false;
+		}
+
 		// Copy the staging texture pixels to the user buffer
-		if (!bRGB) {
+		if (m_ReceiveFormat == SPOUT_PIXEL_RGBA16) {
+			//
+			// 16 bit RGBA pixel buffer
+			//
+			if (width != m_Width || height != m_Height) {
+				// Convert to 8 bit rgba at the sender size if necessary,
+				// resample and expand to 16 bits
+				const bool bHighBit = spoutcopy.IsHighBitFormat(m_dwFormat);
+				const unsigned int senderSize = bHighBit ? m_Width*m_Height*4 : 0;
+				unsigned char* buffer = CheckConvertBuffer(senderSize + width*height*4);
+				if (buffer) {
+					const void* source = mappedSubResource.pData;
+					unsigned int sourcePitch = mappedSubResource.RowPitch;
+					bool bBGRA = (m_dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM || m_dwFormat == DXGI_FORMAT_B8G8R8X8_UNORM);
+					if (bHighBit) {
+						spoutcopy.highbit2rgba(source, buffer, m_Width, m_Height,
+							sourcePitch, 0, m_dwFormat, GL_RGBA, false);
+						source = buffer;
+						sourcePitch = m_Width*4;
+						bBGRA = false;
+					}
+					ResamplePixels(source, sourcePitch, buffer + senderSize, width, height, false, bInvert, bBGRA);
+					spoutcopy.highbit2rgba16(buffer + senderSize, destpixels, width, height,
+						width*4, 0, DXGI_FORMAT_R8G8B8A8_UNORM, false);
+				}
+			}
+			else {
+				// High bit depth textures retain their precision
+				DWORD dwFormat = m_dwFormat;
+				if (dwFormat == DXGI_FORMAT_B8G8R8X8_UNORM)
+					dwFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+				spoutcopy.highbit2rgba16(mappedSubResource.pData, destpixels, width, height,
+					mappedSubResource.RowPitch, 0, dwFormat, bInvert);
+			}
+		}
+		else if (m_ReceiveFormat >= SPOUT_PIXEL_V210) {
+			//
+			// 10 bit Y'CbCr pixel buffer
+			//
+			if (width != m_Width || height != m_Height) {
+				// Convert to 8 bit rgba at the sender size if necessary and resample
+				const unsigned int senderSize = m_Width*m_Height*4;
+				unsigned char* buffer = CheckConvertBuffer(senderSize + width*height*4);
+				if (buffer) {
+					const void* source = mappedSubResource.pData;
+					unsigned int sourcePitch = mappedSubResource.RowPitch;
+					DWORD dwFormat = m_dwFormat;
+					if (spoutcopy.IsHighBitFormat(m_dwFormat)) {
+						spoutcopy.highbit2rgba(source, buffer, m_Width, m_Height,
+							sourcePitch, 0, m_dwFormat, GL_RGBA, false);
+						source = buffer;
+						sourcePitch = m_Width*4;
+						dwFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+					}
+					ResamplePixels(source, sourcePitch, buffer + senderSize, width, height, false, false, false);
+					spoutcopy.rgba2yuv10(buffer + senderSize, destpixels, width, height,
+						width*4, 0, dwFormat, m_ReceiveFormat, m_YUVMatrix, bInvert);
+				}
+			}
+			else {
+				// High bit depth textures retain 10 bit precision
+				spoutcopy.rgba2yuv10(mappedSubResource.pData, destpixels, width, height,
+					mappedSubResource.RowPitch, 0, m_dwFormat, m_ReceiveFormat, m_YUVMatrix, bInvert);
+			}
+		}
+		else if (bRotateDirect) {
+			//
+			// RGBA/BGRA texture to rotated RGBA/BGRA pixels
+			//
+			spoutcopy.rgba2rgbaRotate(mappedSubResource.pData, destpixels, m_Width, m_Height,
+				mappedSubResource.RowPitch, 0, rotation, bSwap, bInvert);
+		}
+		else if (spoutcopy.IsHighBitFormat(m_dwFormat)) {
+			//
+			// High bit depth texture to RGBA/BGRA or BGR/RGB pixels
+			// BGR is default for RGB pixels as for RGBA textures below
+			//
+			GLenum glFormat = bSwap ? GL_BGRA_EXT : GL_RGBA;
+			if (bRGB)
+				glFormat = bSwap ? GL_RGB : GL_BGR_EXT;
+			// Tone mapping for float or PQ senders if selected
+			const bool bToneMap = (m_ToneMap != SPOUT_TONEMAP_NONE)
+				&& (m_dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT || m_dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || m_bToneMapPQ);
+			if (width != m_Width || height != m_Height) {
+				// Convert to rgba at the sender size and resample
+				unsigned char* rgba = CheckConvertBuffer(m_Width*m_Height*4);
+				bool bConverted = false;
+				if (rgba && bToneMap)
+					bConverted = spoutcopy.tonemap2rgba(mappedSubResource.pData, rgba, m_Width, m_Height,
+						mappedSubResource.RowPitch, 0, m_dwFormat, GL_RGBA, m_ToneMap,
+						m_ToneMapExposure, m_ToneMapPeak, m_bToneMapPQ, bInvert);
+				else if (rgba)
+					bConverted = spoutcopy.highbit2rgba(mappedSubResource.pData, rgba, m_Width, m_Height,
+						mappedSubResource.RowPitch, 0, m_dwFormat, GL_RGBA, bInvert);
+				// The rgba2rgb swap flag is reversed for RGBA
+				if (bConverted)
+					ResamplePixels(rgba, m_Width*4, destpixels, width, height, bRGB, false, bRGB ? !bSwap : bSwap);
+			}
+			else if (bToneMap) {
+				spoutcopy.tonemap2rgba(mappedSubResource.pData, destpixels, width, height,
+					mappedSubResource.RowPitch, 0, m_dwFormat, glFormat, m_ToneMap,
+					m_ToneMapExposure, m_ToneMapPeak, m_bToneMapPQ, bInvert);
+			}
+			else {
+				spoutcopy.highbit2rgba(mappedSubResource.pData, destpixels, width, height,
+					mappedSubResource.RowPitch, 0, m_dwFormat, glFormat, bInvert);
+			}
+		}
+		else if (!bRGB) {
 			//
 			// RGBA pixel buffer
 			//
-			// TODO : test rgba-rgba resample
-			// TODO : rgba2bgraResample
 			if (width != m_Width || height != m_Height) {
-				spoutcopy.rgba2rgbaResample(mappedSubResource.pData, destpixels, m_Width, m_Height,
-					mappedSubResource.RowPitch, width, height, bInvert);
+				ResamplePixels(mappedSubResource.pData, mappedSubResource.RowPitch, destpixels,
+					width, height, false, bInvert, bSwap);
 			}
 			else {
 				// Copy rgba to rgba/bgra line by line allowing for source pitch using the fastest method
@@ -2558,8 +3781,8 @@ bool spoutDX::ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* dest
 			//
 			// If the texture format is RGBA it has to be converted to RGB/BGR by the staging texture copy
 			if (width != m_Width || height != m_Height) {
-				spoutcopy.rgba2rgbResample(mappedSubResource.pData, destpixels, m_Width, m_Height, mappedSubResource.RowPitch,
-					width, height, bInvert, m_bMirror, !bSwap);
+				ResamplePixels(mappedSubResource.pData, mappedSubResource.RowPitch, destpixels,
+					width, height, true, bInvert, !bSwap);
 			}
 			else {
 				// Copy RGBA to RGB or BGR allowing for source line pitch using the fastest method
@@ -2576,8 +3799,8 @@ bool spoutDX::ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* dest
 			// if swap BGRA texture > RGB pixels
 			//
 			if (width != m_Width || height != m_Height) {
-				spoutcopy.rgba2rgbResample(mappedSubResource.pData, destpixels, m_Width, m_Height,
-					mappedSubResource.RowPitch, width, height, bInvert, m_bMirror, bSwap);
+				ResamplePixels(mappedSubResource.pData, mappedSubResource.RowPitch, destpixels,
+					width, height, true, bInvert, bSwap);
 			}
 			else {
 				// SSE3 approx 2.5 msec at 1920x1080, 1 msec at 1280x720
@@ -2587,6 +3810,32 @@ bool spoutDX::ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* dest
 			}
 		}
 
+		// Rotate converted pixels to the user buffer
+		if (rotatepixels) {
+			if (bRGB)
+				spoutcopy.rgb2rgbRotate(destpixels, rotatepixels, width, height, 0, 0, rotation, false, bRotateInvert);
+			else
+				spoutcopy.rgba2rgbaRotate(destpixels, rotatepixels, width, height, 0, 0, rotation, false, bRotateInvert);
+		}
+
+		// Hash the pixels returned for IsFrameIdentical.
+		// The conversion has just written them to system memory, so the
+		// mapped staging texture is not read a second time.
+		// Y'CbCr lines are padded, so hash the texture for those.
+		if (m_bFrameHash) {
+			if (m_ReceiveFormat >= SPOUT_PIXEL_V210) {
+				const unsigned int bytes = (m_dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : (m_dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || m_dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) ? 8 : 4;
+				UpdateFrameHash(spoutcopy.FrameHash(mappedSubResource.pData, m_Width*bytes, m_Height,
+					mappedSubResource.RowPitch));
+			}
+			else {
+				const unsigned char* received = rotatepixels ? rotatepixels : destpixels;
+				UpdateFrameHash(spoutcopy.FrameHash(received, width*(bRGB ? 3 : 4), height));
+			}
+		}
+
+		AddCounter(COUNTER_CONVERSION_TIME, GetTimingCount() - mapEnd);
+
 		m_pImmediateContext->Unmap(pStagingSource, 0);
 		return true;
 	} // endif DX11 map OK
@@ -2596,6 +3845,348 @@ bool spoutDX::ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* dest
 } // end ReadPixelData
 
 
+//
+// Record the hash of a new frame and compare with the last
+//
+void spoutDX::UpdateFrameHash(uint64_t hash)
+{
+	m_bFrameIdentical = (m_FrameHash != 0 && hash == m_FrameHash);
+	m_FrameHash = hash;
+}
+
+//
+// Compare received pixels with the previous frame for the ReceiveImage tile map.
+// The previous frame and tile buffers are re-used and only enlarged.
+//
+void spoutDX::UpdateTileMap(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int bytes)
+{
+	SpoutTileMap* tiles = m_pTileMap;
+	if (!tiles || width == 0 || height == 0)
+		return;
+	if (tiles->tileSize == 0)
+		tiles->tileSize = 64;
+
+	const unsigned int size = tiles->tileSize;
+	const unsigned int columns = (width + size - 1)/size;
+	const unsigned int rows = (height + size - 1)/size;
+	const unsigned int count = columns*rows;
+	unsigned char* changed = CheckPixelBuffer(m_pTileChanged, m_TileChangedSize, (count + 7)/8);
+	uint32_t* sad = reinterpret_cast<uint32_t*>(CheckPixelBuffer(m_pTileSAD, m_TileSADSize, count*4));
+	tiles->columns = columns;
+	tiles->rows = rows;
+	tiles->changed = changed;
+	tiles->sad = sad;
+
+	// No new frame
+	if (!pixels) {
+		memset(changed, 0, (count + 7)/8);
+		memset(sad, 0, count*4);
+		tiles->changedTiles = 0;
+		return;
+	}
+
+	// The first frame or a change of size or format is compared with black
+	// and all tiles are marked as changed
+	const bool bFirst = (!m_pPreviousFrame || width != m_PreviousWidth
+		|| height != m_PreviousHeight || bytes != m_PreviousBytes);
+	unsigned char* previous = CheckPixelBuffer(m_pPreviousFrame, m_PreviousSize, width*height*bytes);
+	if (bFirst) {
+		memset(previous, 0, width*height*bytes);
+		m_PreviousWidth = width;
+		m_PreviousHeight = height;
+		m_PreviousBytes = bytes;
+	}
+
+	// Compare and update the previous frame in one pass
+	tiles->changedTiles = spoutcopy.CompareTiles(pixels, previous, width, height, bytes, 0, size, changed, sad, true);
+	if (bFirst) {
+		memset(changed, 0xFF, count/8);
+		if (count%8)
+			changed[count/8] = (unsigned char)((1 << (count%8)) - 1);
+		tiles->changedTiles = count;
+	}
+}
+
+//
+// Add a rectangle to those for the next frame sent.
+// It is merged with another if they overlap, or if one rectangle
+// covering both is no larger than the two separately. If the list
+// is full, it is merged with the one that adds the least area.
+// The merged rectangle is tested again against the others,
+// so the rectangles never overlap and no pixel is copied twice.
+//
+void spoutDX::CoalesceDirtyRect(RECT rc)
+{
+	if (rc.right <= rc.left || rc.bottom <= rc.top)
+		return;
+
+	auto area = [](const RECT& r) { return (int64_t)(r.right - r.left)*(int64_t)(r.bottom - r.top); };
+
+	for (;;) {
+		RECT merged={};
+		unsigned int best = m_DirtyRectCount;
+		int64_t bestcost = 0;
+		bool bOverlap = false;
+		for (unsigned int i = 0; i < m_DirtyRectCount; i++) {
+			const RECT& r = m_DirtyRects[i];
+			// Overlapping rectangles are always merged
+			const bool bIntersect = (rc.left < r.right && r.left < rc.right
+				&& rc.top < r.bottom && r.top < rc.bottom);
+			if (bOverlap && !bIntersect)
+				continue;
+			RECT u={};
+			u.left   = (rc.left < r.left) ? rc.left : r.left;
+			u.top    = (rc.top < r.top) ? rc.top : r.top;
+			u.right  = (rc.right > r.right) ? rc.right : r.right;
+			u.bottom = (rc.bottom > r.bottom) ? rc.bottom : r.bottom;
+			// Pixels added by covering both with one rectangle
+			const int64_t cost = area(u) - area(r) - area(rc);
+			if (best == m_DirtyRectCount || (bIntersect && !bOverlap) || cost < bestcost) {
+				best = i;
+				bestcost = cost;
+				merged = u;
+				bOverlap = bIntersect;
+			}
+		}
+		if (best == m_DirtyRectCount
+			|| (!bOverlap && bestcost > 0 && m_DirtyRectCount < SPOUT_DIRTY_RECTS)) {
+			m_DirtyRects[m_DirtyRectCount++] = rc;
+			return;
+		}
+		m_DirtyRects[best] = m_DirtyRects[--m_DirtyRectCount];
+		rc = merged;
+	}
+}
+
+//
+// Clip the dirty rectangles to the sender size.
+// Returns the number remaining, or 0 to update the whole frame
+// if there are none or they cover most of it.
+//
+unsigned int spoutDX::ClipDirtyRects(unsigned int width, unsigned int height)
+{
+	unsigned int count = 0;
+	uint64_t pixels = 0;
+	for (unsigned int i = 0; i < m_DirtyRectCount; i++) {
+		RECT rc = m_DirtyRects[i];
+		if (rc.left < 0) rc.left = 0;
+		if (rc.top < 0) rc.top = 0;
+		if (rc.right > (LONG)width) rc.right = (LONG)width;
+		if (rc.bottom > (LONG)height) rc.bottom = (LONG)height;
+		if (rc.right <= rc.left || rc.bottom <= rc.top)
+			continue;
+		pixels += (uint64_t)(rc.right - rc.left)*(uint64_t)(rc.bottom - rc.top);
+		m_DirtyRects[count++] = rc;
+	}
+	m_DirtyRectCount = count;
+
+	// Separate copies have no advantage over one for three quarters of the frame
+	if (pixels*4 >= (uint64_t)width*(uint64_t)height*3)
+		return 0;
+
+	return count;
+}
+
+//
+// Copy the dirty rectangles of a texture to the same place in the shared texture.
+// The offset is the position of the sender region in the source texture.
+//
+void spoutDX::CopyDirtyRects(ID3D11Texture2D* pSource, unsigned int count, unsigned int xoffset, unsigned int yoffset)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		const RECT& rc = m_DirtyRects[i];
+		D3D11_BOX box={};
+		box.left   = xoffset + (UINT)rc.left;
+		box.top    = yoffset + (UINT)rc.top;
+		box.right  = xoffset + (UINT)rc.right;
+		box.bottom = yoffset + (UINT)rc.bottom;
+		box.front  = 0;
+		box.back   = 1;
+		m_pImmediateContext->CopySubresourceRegion(m_pSharedTexture, 0, (UINT)rc.left, (UINT)rc.top, 0, pSource, 0, &box);
+	}
+}
+
+//
+// Publish the rectangles updated for a frame and clear them for the next.
+// Called while the shared texture is locked, before the new frame is signalled.
+// The map is created when a sender first sends dirty rectangles and
+// after that every frame is published, with count 0 for the whole frame.
+//
+void spoutDX::PublishDirtyRects(unsigned int count)
+{
+	m_DirtyRectCount = 0;
+
+	if (!m_pDirtyRects) {
+		if (count == 0)
+			return;
+		std::string namestring = m_SenderName;
+		namestring += "_rects";
+		if (!dirtyrects.Create(namestring.c_str(), (int)sizeof(SpoutDirtyRects))) {
+			SpoutLogError("spoutDX::PublishDirtyRects - could not create shared memory");
+			return;
+		}
+		AddCounter(COUNTER_SHARED_MEMORY);
+		char* pBuffer = dirtyrects.Lock();
+		if (!pBuffer) {
+			SpoutLogError("spoutDX::PublishDirtyRects - no buffer lock");
+			dirtyrects.Close();
+			return;
+		}
+		m_pDirtyRects = reinterpret_cast<SpoutDirtyRects*>(pBuffer);
+		ZeroMemory(m_pDirtyRects, sizeof(SpoutDirtyRects));
+		dirtyrects.Unlock();
+		m_DirtyRectFrame = 0;
+	}
+
+	// Sequence lock : odd while the rectangles are written
+	InterlockedIncrement64(&m_pDirtyRects->sequence);
+	m_pDirtyRects->frame = ++m_DirtyRectFrame;
+	m_pDirtyRects->width = (DWORD)m_Width;
+	m_pDirtyRects->height = (DWORD)m_Height;
+	m_pDirtyRects->count = (DWORD)count;
+	if (count > 0)
+		memcpy(m_pDirtyRects->rects, m_DirtyRects, count*sizeof(RECT));
+	InterlockedIncrement64(&m_pDirtyRects->sequence);
+}
+
+//
+// Read the rectangles published with a new frame received.
+// The rectangles are used only if they are for the frame following
+// the last one read. Otherwise the whole frame has changed.
+// For ReceiveImage staging textures, the pixels read are those of the
+// frame before, so the rectangles are held until the next frame.
+//
+void spoutDX::ReceiveDirtyRects(bool bStaging)
+{
+	RECT rects[SPOUT_DIRTY_RECTS];
+	unsigned int count = 0;
+
+	// A sender without dirty rectangles has no map
+	// so look for it again only after some frames
+	if (!m_pDirtyRects) {
+		if (m_DirtyRectRetry > 0) {
+			m_DirtyRectRetry--;
+		}
+		else {
+			std::string namestring = m_SenderName;
+			namestring += "_rects";
+			if (dirtyrects.Open(namestring.c_str())) {
+				AddCounter(COUNTER_SHARED_MEMORY);
+				m_pDirtyRects = reinterpret_cast<SpoutDirtyRects*>(dirtyrects.Lock());
+				dirtyrects.Unlock();
+			}
+			if (!m_pDirtyRects) {
+				dirtyrects.Close();
+				m_DirtyRectRetry = 60;
+			}
+		}
+	}
+
+	if (m_pDirtyRects) {
+		LONG64 framenumber = 0;
+		for (int i = 0; i < 100; i++) {
+			const LONG64 sequence = InterlockedCompareExchange64(&m_pDirtyRects->sequence, 0, 0);
+			if (sequence & 1) {
+				// Sender is writing
+				YieldProcessor();
+				continue;
+			}
+			framenumber = m_pDirtyRects->frame;
+			count = m_pDirtyRects->count;
+			if (count > SPOUT_DIRTY_RECTS || m_pDirtyRects->width != m_Width || m_pDirtyRects->height != m_Height)
+				count = 0;
+			memcpy(rects, m_pDirtyRects->rects, count*sizeof(RECT));
+			// The copy is complete if the sequence is unchanged
+			if (InterlockedCompareExchange64(&m_pDirtyRects->sequence, 0, 0) == sequence)
+				break;
+			framenumber = 0;
+		}
+		if (m_DirtyRectFrame == 0 || framenumber != m_DirtyRectFrame + 1)
+			count = 0;
+		m_DirtyRectFrame = framenumber;
+	}
+
+	if (bStaging) {
+		memcpy(m_ReceivedRects, m_PendingRects, m_PendingRectCount*sizeof(RECT));
+		m_ReceivedRectCount = m_PendingRectCount;
+		memcpy(m_PendingRects, rects, count*sizeof(RECT));
+		m_PendingRectCount = count;
+	}
+	else {
+		memcpy(m_ReceivedRects, rects, count*sizeof(RECT));
+		m_ReceivedRectCount = count;
+	}
+}
+
+//
+// Close the dirty rectangle map of a sender or receiver
+//
+void spoutDX::CloseDirtyRects()
+{
+	dirtyrects.Close();
+	m_pDirtyRects = nullptr;
+	m_DirtyRectCount = 0;
+	m_ReceivedRectCount = 0;
+	m_PendingRectCount = 0;
+	m_DirtyRectFrame = 0;
+	m_DirtyRectRetry = 0;
+}
+
+//
+// Class buffer for pixels converted before resampling
+//
+unsigned char* spoutDX::CheckConvertBuffer(unsigned int size)
+{
+	return CheckPixelBuffer(m_pConvertBuffer, m_ConvertSize, size);
+}
+
+//
+// Create a class pixel buffer or enlarge it if it is smaller than "size"
+//
+unsigned char* spoutDX::CheckPixelBuffer(unsigned char*& buffer, unsigned int& capacity, unsigned int size)
+{
+	if (size > capacity) {
+		if (buffer)
+			delete[] buffer;
+		buffer = new unsigned char[size];
+		capacity = size;
+	}
+	return buffer;
+}
+
+//
+// Resample rgba pixels of the sender size to rgba or rgb pixels
+// using the filter selected by SetResampleFilter.
+// bSwapRB is the rgba2rgb swap flag for rgb pixels
+// and swaps red and blue of rgba pixels.
+//
+void spoutDX::ResamplePixels(const void* source, unsigned int sourcePitch, unsigned char* dest,
+	unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwapRB)
+{
+	if (m_ResampleFilter == SPOUT_FILTER_NEAREST && bRGB) {
+		spoutcopy.rgba2rgbResample(source, dest, m_Width, m_Height, sourcePitch,
+			width, height, bInvert, m_bMirror, bSwapRB);
+		return;
+	}
+
+	if (!bRGB && !bSwapRB) {
+		spoutcopy.rgba2rgbaResampleFilter(source, dest, m_Width, m_Height, sourcePitch,
+			width, height, m_ResampleFilter, bInvert, 0, m_bResampleGamma);
+		return;
+	}
+
+	// Resample to rgba and convert to bgra or rgb
+	CheckPixelBuffer(m_pResampleBuffer, m_ResampleSize, width*height*4);
+	spoutcopy.rgba2rgbaResampleFilter(source, m_pResampleBuffer, m_Width, m_Height, sourcePitch,
+		width, height, m_ResampleFilter, false, 0, m_bResampleGamma);
+	if (!bRGB) {
+		spoutcopy.rgba2bgra(m_pResampleBuffer, dest, width, height, width*4, bInvert);
+		return;
+	}
+
+	spoutcopy.rgba2rgb(m_pResampleBuffer, dest, width, height, width*4, bInvert, m_bMirror, bSwapRB);
+}
+
 // Create new class staging textures if changed size or do not exist yet
 bool spoutDX::CheckStagingTextures(unsigned int width, unsigned int height, DWORD dwFormat)
 {
@@ -2622,6 +4213,7 @@ bool spoutDX::CheckStagingTextures(unsigned int width, unsigned int height, DWOR
 	// The SpoutDirectX function releases an existing texture and checks for zero or DX9 format
 	if(spoutdx.CreateDX11StagingTexture(m_pd3dDevice, width, height, (DXGI_FORMAT)dwFormat, &m_pStaging[0])
 	&& spoutdx.CreateDX11StagingTexture(m_pd3dDevice, width, height, (DXGI_FORMAT)dwFormat, &m_pStaging[1])) {
+		AddCounter(COUNTER_TEXTURES, 2);
 		// Flush now to avoid deferred object destruction
 		if (m_pImmediateContext) m_pImmediateContext->Flush();
 		return true;
@@ -2631,6 +4223,75 @@ bool spoutDX::CheckStagingTextures(unsigned int width, unsigned int height, DWOR
 }
 
 
+// Create new SendImage upload textures if changed size or they do not exist yet
+bool spoutDX::CheckUploadTexture(unsigned int width, unsigned int height, DWORD dwFormat)
+{
+	if (!m_pd3dDevice)
+		return false;
+
+	int i = 0;
+	for (; i < SPOUT_UPLOAD_TEXTURES; i++) {
+		if (!m_pUpload[i])
+			break;
+		D3D11_TEXTURE2D_DESC desc={0};
+		m_pUpload[i]->GetDesc(&desc);
+		if (desc.Width != width || desc.Height != height || desc.Format != (DXGI_FORMAT)dwFormat)
+			break;
+	}
+	if (i == SPOUT_UPLOAD_TEXTURES)
+		return true;
+
+	// The SpoutDirectX function releases an existing texture
+	for (i = 0; i < SPOUT_UPLOAD_TEXTURES; i++) {
+		if (!spoutdx.CreateDX11StagingTexture(m_pd3dDevice, width, height, (DXGI_FORMAT)dwFormat, &m_pUpload[i]))
+			return false;
+		AddCounter(COUNTER_TEXTURES);
+	}
+	m_UploadIndex = 0;
+	if (m_pImmediateContext) m_pImmediateContext->Flush();
+
+	return true;
+}
+
+//
+// Map the next SendImage upload texture for writing.
+// The GPU copied from it some frames before, so the map does not
+// normally wait. If the copy has not finished, another is tried
+// before waiting. The texture must be unmapped after writing.
+//
+ID3D11Texture2D* spoutDX::MapUploadTexture(D3D11_MAPPED_SUBRESOURCE& mapped)
+{
+	if (!m_pImmediateContext || !m_pUpload[0])
+		return nullptr;
+
+	const LONGLONG mapStart = GetTimingCount();
+	HRESULT hr = DXGI_ERROR_WAS_STILL_DRAWING;
+	{
+		SPOUT_TRACE("Map");
+		for (int i = 0; i < SPOUT_UPLOAD_TEXTURES && hr == DXGI_ERROR_WAS_STILL_DRAWING; i++) {
+			m_UploadIndex = (m_UploadIndex + 1) % SPOUT_UPLOAD_TEXTURES;
+			hr = m_pImmediateContext->Map(m_pUpload[m_UploadIndex], 0, D3D11_MAP_WRITE, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+		}
+		// All are still in use, so wait for the next
+		if (hr == DXGI_ERROR_WAS_STILL_DRAWING) {
+			m_UploadIndex = (m_UploadIndex + 1) % SPOUT_UPLOAD_TEXTURES;
+			hr = m_pImmediateContext->Map(m_pUpload[m_UploadIndex], 0, D3D11_MAP_WRITE, 0, &mapped);
+		}
+	}
+	const double mapTime = GetTimingElapsed(mapStart); // milliseconds
+	AddCounter(COUNTER_STAGING_MAPS);
+	AddCounter(COUNTER_STAGING_TIME, GetTimingCount() - mapStart);
+	if (mapTime > 1.0)
+		AddCounter(COUNTER_STAGING_STALLS);
+
+	if (FAILED(hr)) {
+		SpoutLogError("spoutDX::MapUploadTexture - could not map upload texture (0x%X)", (unsigned int)hr);
+		return nullptr;
+	}
+
+	return m_pUpload[m_UploadIndex];
+}
+
 // Create new class texture if changed size or does not exist yet
 bool spoutDX::CheckTexture(unsigned int width, unsigned int height, DWORD dwFormat)
 {
@@ -2651,8 +4312,210 @@ bool spoutDX::CheckTexture(unsigned int width, unsigned int height, DWORD dwForm
 	}
 
 	// The SpoutDirectX function releases an existing texture and checks for zero or DX9 format
-	return spoutdx.CreateDX11Texture(m_pd3dDevice, width, height, (DXGI_FORMAT)dwFormat, &m_pTexture);
+	if (!spoutdx.CreateDX11Texture(m_pd3dDevice, width, height, (DXGI_FORMAT)dwFormat, &m_pTexture))
+		return false;
+	AddCounter(COUNTER_TEXTURES);
+	return true;
+
+}
+
+//
+// Add to a performance counter
+//
+void spoutDX::AddCounter(int counter, LONG64 value)
+{
+	if (counter >= 0 && counter < COUNTER_TOTAL)
+		InterlockedExchangeAdd64(&m_Counters[counter], value);
+}
+
+//
+// Check access to the shared texture.
+// The time waiting for the sender mutex is recorded.
+// An uncontended check takes a few microseconds, so a check
+// taking longer than 0.1 millisecond is counted as a wait.
+//
+bool spoutDX::CheckSharedTextureAccess()
+{
+	const LONGLONG start = GetTimingCount();
+	const bool bAccess = frame.CheckTextureAccess(m_pSharedTexture);
+	const LONGLONG end = GetTimingCount();
+	if (GetTimingElapsed(start) > 0.1) {
+		AddCounter(COUNTER_MUTEX_WAITS);
+		AddCounter(COUNTER_MUTEX_TIME, end - start);
+	}
+	if (!bAccess)
+		AddCounter(COUNTER_MUTEX_TIMEOUTS);
+	return bAccess;
+}
+
+//
+// Open a sender memory buffer map if not already.
+// This also creates a mutex for the receiver to lock and unlock the map for reads.
+//
+bool spoutDX::OpenMemoryBuffer(const char* name)
+{
+	if (memorybuffer.Name())
+		return true;
+
+	if (m_bMemoryShare || !name || !name[0])
+		return false;
+
+	// Create a name for the map from the sender name
+	std::string namestring = name;
+	namestring += "_map";
+	if (!memorybuffer.Open(namestring.c_str()))
+		return false;
+
+	AddCounter(COUNTER_SHARED_MEMORY);
+	SpoutLogNotice("spoutDX::OpenMemoryBuffer - opened sender memory map [%s]", memorybuffer.Name());
+
+	return true;
+}
+
+//
+// Open a sender memory buffer if not already
+// and return the binary header if it has one
+//
+SpoutMemoryBufferHeader* spoutDX::OpenMemoryBufferHeader(const char* name)
+{
+	if (m_pBufferHeader)
+		return m_pBufferHeader;
+
+	if (!OpenMemoryBuffer(name))
+		return nullptr;
+
+	char* pBuffer = memorybuffer.Lock();
+	if (!pBuffer)
+		return nullptr;
+	*(pBuffer + 15) = 0; // End for atoi
+	m_pBufferHeader = FindMemoryBufferHeader(pBuffer, atoi(pBuffer));
+	memorybuffer.Unlock();
 
+	return m_pBufferHeader;
+}
+
+//
+// Find the binary header following the data of a memory buffer.
+// A reader does not know the map size, so check that the
+// mapped view extends far enough before testing for it.
+//
+SpoutMemoryBufferHeader* spoutDX::FindMemoryBufferHeader(char* pBuffer, int capacity)
+{
+	if (!pBuffer || capacity <= 0)
+		return nullptr;
+
+	const SIZE_T offset = (SIZE_T)((capacity + 32 + 15) & ~15);
+	MEMORY_BASIC_INFORMATION mbi={};
+	if (VirtualQuery(pBuffer, &mbi, sizeof(mbi)) == 0)
+		return nullptr;
+	const SIZE_T available = mbi.RegionSize - (SIZE_T)(pBuffer - reinterpret_cast<char*>(mbi.BaseAddress));
+	if (offset + sizeof(SpoutMemoryBufferHeader) > available)
+		return nullptr;
+
+	SpoutMemoryBufferHeader* header = reinterpret_cast<SpoutMemoryBufferHeader*>(pBuffer + offset);
+	if (header->magic != SPOUT_BUFFER_MAGIC || header->capacity != (DWORD)capacity)
+		return nullptr;
+
+	return header;
+}
+
+//
+// Bytes available for data in each slot of a memory buffer.
+// With more than one slot, the last byte of each slot is reserved
+// so that the null terminator does not overwrite the next slot.
+// A single slot has room for the terminator after it.
+//
+int spoutDX::MemoryBufferSlotLength()
+{
+	if (!m_pBufferHeader)
+		return 0;
+	if (m_pBufferHeader->slots > 1)
+		return (int)m_pBufferHeader->slotSize - 1;
+	return (int)m_pBufferHeader->slotSize;
+}
+
+//
+// Pointer to the data of a memory buffer slot
+//
+char* spoutDX::MemoryBufferData(int slot)
+{
+	if (!m_pBufferHeader)
+		return nullptr;
+	// The header follows the data
+	const int offset = ((int)m_pBufferHeader->capacity + 32 + 15) & ~15;
+	char* pBuffer = reinterpret_cast<char*>(m_pBufferHeader) - offset;
+	return pBuffer + 16 + slot*(int)m_pBufferHeader->slotSize;
+}
+
+//
+// Write a frame to the frame ring for memory share mode.
+// The ring is created or re-created for the sender size.
+//
+bool spoutDX::SendFrameRing(const unsigned char* pData, unsigned int pitch)
+{
+	if (!framering.IsOpen() || framering.GetWidth() != m_Width || framering.GetHeight() != m_Height) {
+		if (!framering.Create(m_SenderName, m_Width, m_Height, m_Width*4, m_dwFormat))
+			return false;
+	}
+	return framering.WriteFrame(pData, pitch);
+}
+
+//
+// Read the newest frame from a sender's frame ring for memory share mode.
+// Returns false to use the texture instead if there is no ring
+// or the pixels need conversion.
+//
+bool spoutDX::ReceiveFrameRing(unsigned char* pixels, unsigned int width, unsigned int height, bool bRGB, bool bInvert)
+{
+	if (bRGB || bInvert || m_bSwapRB || width != m_Width || height != m_Height)
+		return false;
+
+	if (!framering.IsOpen()) {
+		if (!framering.Open(m_SenderName))
+			return false;
+	}
+
+	// The sender has changed size or created the ring again.
+	// The ring size is that when it was opened, so is not changed
+	// by the sender while the frame is read.
+	if (framering.IsChanged() || framering.GetWidth() != width || framering.GetHeight() != height) {
+		framering.Close();
+		return false;
+	}
+
+	if (framering.IsNewFrame() && framering.ReadFrame(pixels, width*4)) {
+		AddCounter(COUNTER_FRAMES_RECEIVED);
+		AddCounter(COUNTER_BYTES_READBACK, (LONG64)width*4*(LONG64)height);
+		if (m_bFrameHash)
+			UpdateFrameHash(spoutcopy.FrameHash(pixels, width*4, height));
+		UpdateTileMap(pixels, width, height, 4);
+	}
+	else if (framering.IsChanged()) {
+		// Created again during the read
+		framering.Close();
+		return false;
+	}
+	else {
+		if (m_bFrameHash)
+			m_bFrameIdentical = true;
+		UpdateTileMap(nullptr, width, height, 4);
+	}
+
+	return true;
+}
+
+//
+// Close the memory buffer map and its header
+//
+void spoutDX::CloseMemoryBuffer()
+{
+	// Release any view still open
+	EndMemoryBufferRead();
+	if (m_BufferWriteSlot >= 0)
+		EndMemoryBufferWrite(0);
+	memorybuffer.Close();
+	m_pBufferHeader = nullptr;
+	m_BufferSequence = 0;
 }
 
 
@@ -50,6 +50,7 @@
 #include "SpoutDirectX.h"
 #include "SpoutSenderNames.h"
 #include "SpoutFrameCount.h"
+#include "SpoutFrameRing.h"
 #include "SpoutDirectX.h"
 #include "SpoutCopy.h"
 #include "SpoutUtils.h"
@@ -57,6 +58,7 @@
 #include "..\SpoutSDK\SpoutCommon.h"
 #include "..\SpoutSDK\SpoutSenderNames.h"
 #include "..\SpoutSDK\SpoutFrameCount.h"
+#include "..\SpoutSDK\SpoutFrameRing.h"
 #include "..\SpoutSDK\SpoutDirectX.h"
 #include "..\SpoutSDK\SpoutCopy.h"
 #include "..\SpoutSDK\SpoutUtils.h"
@@ -70,6 +72,79 @@
 #pragma comment(lib, "Psapi.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
+// Binary header of a sender memory buffer (see WriteMemoryBuffer).
+// For compatibility with existing readers, the first 16 bytes of the map
+// still record the capacity as decimal digits and data follows.
+// The header is after the data and its null terminator.
+#define SPOUT_BUFFER_MAGIC    0x46425053 // "SPBF"
+#define SPOUT_BUFFER_VERSION  2 // 2 - the last byte of each slot is reserved
+#define SPOUT_BUFFER_METADATA 256 // Bytes for per-frame metadata
+#define SPOUT_BUFFER_SLOTS    3 // Slots for a buffer that readers do not lock
+struct SpoutMemoryBufferHeader {
+	DWORD magic; // SPOUT_BUFFER_MAGIC
+	DWORD version; // SPOUT_BUFFER_VERSION
+	DWORD capacity; // Bytes available for data in all slots
+	DWORD length; // Bytes of data from the last write
+	volatile LONG64 sequence; // Write count. Odd while a locked write is in progress.
+	LONG64 timestamp; // Performance count of the last write
+	volatile LONG64 metadataSequence; // Metadata write count. Odd while writing.
+	DWORD metadataLength; // Bytes of metadata
+	DWORD slots; // 1, or SPOUT_BUFFER_SLOTS
+	DWORD slotSize; // Bytes from one slot to the next
+	volatile LONG published; // Slot of the last write
+	volatile LONG readers[SPOUT_BUFFER_SLOTS]; // Receivers reading each slot
+	DWORD slotLength[SPOUT_BUFFER_SLOTS]; // Bytes of data in each slot
+	BYTE metadata[SPOUT_BUFFER_METADATA]; // Per-frame metadata read without locks
+};
+
+// Performance counters for a spoutDX object (see GetCounters)
+struct SpoutDXcounters {
+	LONG64 framesSent; // Frames written to the shared texture
+	LONG64 framesReceived; // New frames copied from the shared texture
+	LONG64 bytesUploaded; // Pixel bytes sent by SendImage
+	LONG64 bytesReadBack; // Pixel bytes read from staging textures
+	LONG64 conversions; // Pixel buffer conversions by spoutCopy
+	LONG64 resampledConversions; // Conversions using the slower resample functions
+	double conversionTime; // Total milliseconds for conversions
+	LONG64 stagingMaps; // Staging texture maps
+	LONG64 stagingMapStalls; // Maps waiting more than 1 millisecond
+	double stagingMapTime; // Total milliseconds waiting for maps
+	LONG64 mutexWaits; // Access checks that waited more than 0.1 millisecond
+	LONG64 mutexTimeouts; // Access checks that failed
+	double mutexWaitTime; // Total milliseconds of the checks that waited
+	LONG64 textureCreations; // Shared, staging and class textures created
+	LONG64 sharedMemoryOpens; // Shared memory maps opened for a new sender or created
+};
+
+// Changed tiles between consecutive frames received by ReceiveImage.
+// The tile size is set by the caller. The other fields are set by ReceiveImage
+// and the buffers remain valid until the next ReceiveImage or spoutDX is released.
+struct SpoutTileMap {
+	unsigned int tileSize = 64; // Tile width and height in pixels
+	unsigned int columns = 0; // Tiles across
+	unsigned int rows = 0; // Tiles down
+	unsigned int changedTiles = 0; // Tiles that have changed
+	const unsigned char* changed = nullptr; // One bit for each tile by rows, bit (i%8) of byte i/8
+	const uint32_t* sad = nullptr; // Sum of absolute differences for each tile
+};
+
+// Rectangles changed by a sender for each frame (see AddDirtyRects).
+// Written to a shared memory map "sendername_rects" when a sender
+// first sends dirty rectangles and read by receivers without locking.
+#define SPOUT_DIRTY_RECTS 16 // Maximum rectangles for each frame
+struct SpoutDirtyRects {
+	volatile LONG64 sequence; // Write count. Odd while writing.
+	LONG64 frame; // Frames sent since the map was created
+	DWORD width; // Sender width
+	DWORD height; // Sender height
+	DWORD count; // Rectangles changed, 0 for the whole frame
+	RECT rects[SPOUT_DIRTY_RECTS];
+};
+
+// Staging textures used in turn by SendImage so that the pixels
+// are written while the GPU copies the previous frames
+#define SPOUT_UPLOAD_TEXTURES 3
+
 class SPOUT_DLLEXP spoutDX {
 
 	public:
@@ -107,6 +182,12 @@ class SPOUT_DLLEXP spoutDX {
 		unsigned int width, unsigned int height);
 	// Send an image - optional row pitch
 	bool SendImage(const unsigned char * pData, unsigned int width, unsigned int height, unsigned int pitch = 0);
+	// Send an image in a pixel format listed in SpoutCopy.h - optional row pitch
+	bool SendImage(const unsigned char * pData, unsigned int width, unsigned int height, SpoutPixelFormat format, unsigned int pitch = 0);
+	// Add rectangles changed since the last frame sent
+	bool AddDirtyRects(const RECT* rects, int count);
+	// Send the whole of the next frame
+	void ClearDirtyRects();
 	// Sender status
 	bool IsInitialized();
 	// Sender name
@@ -134,8 +215,39 @@ class SPOUT_DLLEXP spoutDX {
 	bool ReceiveTexture(ID3D11Texture2D** ppTexture);
 	// Receive an image
 	bool ReceiveImage(unsigned char * pixels, unsigned int width, unsigned int height, bool bRGB = false, bool bInvert = false);
+	// Receive an image in a pixel format listed in SpoutCopy.h
+	bool ReceiveImage(unsigned char * pixels, unsigned int width, unsigned int height, SpoutPixelFormat format, bool bInvert = false);
+	// Receive an image and the tiles changed since the last frame
+	bool ReceiveImage(unsigned char * pixels, unsigned int width, unsigned int height, bool bRGB, bool bInvert, SpoutTileMap* tiles);
+	// Receive a region of the sender image
+	bool ReceiveImageRegion(unsigned char * pixels, unsigned int x, unsigned int y,
+		unsigned int width, unsigned int height, bool bRGB = false, bool bInvert = false);
+	// Y'CbCr matrix for SendImage and ReceiveImage - SPOUT_YUV_BT601, _BT709 or _BT2020
+	void SetYUVMatrix(int matrix);
+	int GetYUVMatrix();
+	// Filter for ReceiveImage if the size is different from the sender - SpoutResampleFilter
+	void SetResampleFilter(int filter);
+	int GetResampleFilter();
+	// Resample in linear light for SPOUT_FILTER_LINEAR
+	void SetResampleGamma(bool bGammaCorrect = true);
+	bool GetResampleGamma();
+	// Clockwise rotation for ReceiveImage - 0, 90, 180 or 270 degrees
+	void SetReceiveRotation(int degrees);
+	int GetReceiveRotation();
+	// Hash ReceiveImage frames to detect identical content
+	void SetFrameHash(bool bHash = true);
+	// Hash of the last frame received
+	uint64_t GetFrameHash();
+	// The last frame received is the same as the one before
+	bool IsFrameIdentical();
+	// Rectangles changed in the last frame received, 0 for the whole frame.
+	// Sender coordinates, including for ReceiveImageRegion.
+	int GetDirtyRects(RECT* rects, int maxcount);
 	// Read pixels from texture
 	bool ReadTexurePixels(ID3D11Texture2D* ppTexture, unsigned char* pixels);
+	// Read pixels from a region of a texture
+	bool ReadTexurePixels(ID3D11Texture2D* pTexture, unsigned char* pixels,
+		unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 	// Open sender selection dialog
 	bool SelectSender(HWND hwnd = NULL);
 	// Sender has changed
@@ -298,10 +410,26 @@ class SPOUT_DLLEXP spoutDX {
 	int  ReadMemoryBuffer(const char* name, char* data, int maxlength);
 	// Create a shared memory buffer
 	bool CreateMemoryBuffer(const char *name, int length);
+	// Create a shared memory buffer with 1 or SPOUT_BUFFER_SLOTS slots
+	bool CreateMemoryBuffer(const char *name, int length, int slots);
 	// Delete a shared memory buffer
 	bool DeleteMemoryBuffer();
 	// Get the number of bytes available for data transfer
 	int  GetMemoryBufferSize(const char *name);
+	// Has the sender written to the buffer since the last read
+	bool MemoryBufferChanged(const char* name);
+	// Write per-frame metadata to the buffer header without locking
+	bool WriteMemoryBufferMetadata(const char* data, int length);
+	// Read per-frame metadata from the buffer header without locking
+	int  ReadMemoryBufferMetadata(const char* name, char* data, int maxlength);
+	// Write directly to the buffer (see spoutMemoryBufferView)
+	char* BeginMemoryBufferWrite(int* size);
+	// Publish the data written
+	void EndMemoryBufferWrite(int length);
+	// Read directly from a sender buffer (see spoutMemoryBufferView)
+	const char* BeginMemoryBufferRead(const char* name, int* length);
+	// Release the data read
+	void EndMemoryBufferRead();
 
 	//
 	// Options used for SpoutCam
@@ -311,6 +439,24 @@ class SPOUT_DLLEXP spoutDX {
 	bool GetMirror();
 	bool GetSwap();
 
+	//
+	// Tone mapping for high dynamic range senders
+	//
+	// Float and half float senders are scRGB.
+	// R10G10B10A2 and 16 bit unorm senders are tone mapped if PQ encoded.
+	// Operators are listed in SpoutCopy.h. The default is none (clamp).
+	void SetToneMap(int toneMap, float exposure = 1.0f, float peakNits = 1000.0f, bool bPQ = false);
+	int GetToneMap();
+
+	//
+	// Performance counters
+	//
+
+	// Get the counters for this object
+	bool GetCounters(SpoutDXcounters* counters);
+	// Reset all counters to zero
+	void ResetCounters();
+
 	//
 	// Public for external access
 	//
@@ -327,6 +473,11 @@ protected :
 	ID3D11Texture2D* m_pSharedTexture = nullptr; // Sender shared texture
 	ID3D11Texture2D* m_pTexture = nullptr; // Class receiving texture
 	ID3D11Texture2D* m_pStaging[2] = {nullptr};
+	ID3D11Texture2D* m_pUpload[SPOUT_UPLOAD_TEXTURES] = {nullptr}; // Staging textures for SendImage
+	int m_UploadIndex = 0; // Upload texture last written
+	ID3D11Texture2D* m_pRegionStaging = nullptr; // Staging texture for region readback
+	bool m_bRegion = false; // ReceiveImage reads m_RegionBox only
+	D3D11_BOX m_RegionBox{};
 	int m_Index = 0;
 	int m_NextIndex = 0;
 
@@ -347,10 +498,125 @@ protected :
 	bool m_bMemoryShare = false; // Using 2.006 memoryshare methods
 	bool m_bMirror = false; // Mirror image
 	bool m_bSwapRB = false; // RGB <> BGR
+	int m_ToneMap = SPOUT_TONEMAP_NONE; // Tone mapping for ReceiveImage
+	float m_ToneMapExposure = 1.0f;
+	float m_ToneMapPeak = 1000.0f;
+	bool m_bToneMapPQ = false;
+	int m_ReceiveFormat = -1; // Pixel format for ReceiveImage (-1 for bRGB)
+	int m_YUVMatrix = SPOUT_YUV_BT709; // Y'CbCr matrix for SendImage and ReceiveImage
+	int m_ResampleFilter = SPOUT_FILTER_NEAREST; // ReceiveImage resampling
+	bool m_bResampleGamma = false; // SPOUT_FILTER_LINEAR in linear light
+	int m_Rotation = 0; // ReceiveImage clockwise rotation
+	bool m_bFrameHash = false; // Hash ReceiveImage frames
+	uint64_t m_FrameHash = 0; // Hash of the last frame
+	bool m_bFrameIdentical = false; // Last frame has the same hash as the one before
 	SHELLEXECUTEINFOA m_ShExecInfo{}; // For ShellExecute
 
 	// For WriteMemoryBuffer/ReadMemoryBuffer
 	SpoutSharedMemory memorybuffer;
+	SpoutMemoryBufferHeader* m_pBufferHeader = nullptr; // Within the memory buffer map
+	LONG64 m_BufferSequence = 0; // Sequence of the last buffer read
+	int m_BufferWriteSlot = -1; // Slot between BeginMemoryBufferWrite and End
+	int m_BufferReadSlot = -1; // Slot between BeginMemoryBufferRead and End
+	bool m_bBufferReadLocked = false; // Buffer locked by BeginMemoryBufferRead
+	bool OpenMemoryBuffer(const char* name);
+	SpoutMemoryBufferHeader* OpenMemoryBufferHeader(const char* name);
+	SpoutMemoryBufferHeader* FindMemoryBufferHeader(char* pBuffer, int capacity);
+	char* MemoryBufferData(int slot);
+	int MemoryBufferSlotLength();
+	void CloseMemoryBuffer();
+
+	// Frame ring for memory share mode
+	spoutFrameRing framering;
+	bool SendFrameRing(const unsigned char* pData, unsigned int pitch);
+	bool ReceiveFrameRing(unsigned char* pixels, unsigned int width, unsigned int height, bool bRGB, bool bInvert);
+
+	// Performance counters
+	// Updated with interlocked functions so that they can
+	// be read from another thread. Times are performance counts.
+	enum {
+		COUNTER_FRAMES_SENT,
+		COUNTER_FRAMES_RECEIVED,
+		COUNTER_BYTES_UPLOADED,
+		COUNTER_BYTES_READBACK,
+		COUNTER_CONVERSIONS,
+		COUNTER_RESAMPLED,
+		COUNTER_CONVERSION_TIME,
+		COUNTER_STAGING_MAPS,
+		COUNTER_STAGING_STALLS,
+		COUNTER_STAGING_TIME,
+		COUNTER_MUTEX_WAITS,
+		COUNTER_MUTEX_TIMEOUTS,
+		COUNTER_MUTEX_TIME,
+		COUNTER_TEXTURES,
+		COUNTER_SHARED_MEMORY,
+		COUNTER_TOTAL
+	};
+	volatile LONG64 m_Counters[COUNTER_TOTAL]{};
+	void AddCounter(int counter, LONG64 value = 1);
+
+	// Check access to the shared texture and record the wait
+	bool CheckSharedTextureAccess();
+
+	// Pixels converted from a high bit depth format before resampling
+	unsigned char* m_pConvertBuffer = nullptr;
+	unsigned int m_ConvertSize = 0;
+	unsigned char* CheckConvertBuffer(unsigned int size);
+
+	// Filtered pixels before conversion to rgb
+	unsigned char* m_pResampleBuffer = nullptr;
+	unsigned int m_ResampleSize = 0;
+
+	// Converted pixels before rotation
+	unsigned char* m_pRotateBuffer = nullptr;
+	unsigned int m_RotateSize = 0;
+
+	// Create or enlarge a class pixel buffer
+	unsigned char* CheckPixelBuffer(unsigned char*& buffer, unsigned int& capacity, unsigned int size);
+
+	// Record the hash of a new frame
+	void UpdateFrameHash(uint64_t hash);
+
+	// Tile map for ReceiveImage and the previous frame compared with
+	SpoutTileMap* m_pTileMap = nullptr;
+	unsigned char* m_pPreviousFrame = nullptr;
+	unsigned int m_PreviousSize = 0;
+	unsigned int m_PreviousWidth = 0;
+	unsigned int m_PreviousHeight = 0;
+	unsigned int m_PreviousBytes = 0;
+	unsigned char* m_pTileChanged = nullptr;
+	unsigned int m_TileChangedSize = 0;
+	unsigned char* m_pTileSAD = nullptr;
+	unsigned int m_TileSADSize = 0;
+	// Compare received pixels with the previous frame. Null pixels for no new frame.
+	void UpdateTileMap(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int bytes);
+
+	// Dirty rectangles of the next frame sent or the last frame received
+	SpoutSharedMemory dirtyrects;
+	SpoutDirtyRects* m_pDirtyRects = nullptr; // Within the dirty rectangle map
+	RECT m_DirtyRects[SPOUT_DIRTY_RECTS]{}; // Sender rectangles for the next frame
+	unsigned int m_DirtyRectCount = 0;
+	RECT m_ReceivedRects[SPOUT_DIRTY_RECTS]{}; // Rectangles of the last frame received
+	unsigned int m_ReceivedRectCount = 0;
+	RECT m_PendingRects[SPOUT_DIRTY_RECTS]{}; // Rectangles of the frame in the ReceiveImage staging texture
+	unsigned int m_PendingRectCount = 0;
+	LONG64 m_DirtyRectFrame = 0; // Last frame published or read
+	unsigned int m_DirtyRectRetry = 0; // Frames before a receiver looks for the map again
+	// Merge a rectangle with those for the next frame
+	void CoalesceDirtyRect(RECT rc);
+	// Clip the rectangles to the sender size. 0 for the whole frame.
+	unsigned int ClipDirtyRects(unsigned int width, unsigned int height);
+	// Copy the rectangles of a texture to the shared texture
+	void CopyDirtyRects(ID3D11Texture2D* pSource, unsigned int count, unsigned int xoffset = 0, unsigned int yoffset = 0);
+	// Publish the rectangles sent with a frame
+	void PublishDirtyRects(unsigned int count);
+	// Read the rectangles of a frame received
+	void ReceiveDirtyRects(bool bStaging);
+	void CloseDirtyRects();
+
+	// Resample sender size rgba pixels with the selected filter
+	void ResamplePixels(const void* source, unsigned int sourcePitch, unsigned char* dest,
+		unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwapRB);
 
 	// Initialize or update the sender
 	bool CheckSender(unsigned int width, unsigned int height, DWORD dwFormat);
@@ -363,13 +629,26 @@ protected :
 
 	void CreateReceiver(const char * sendername, unsigned int width, unsigned int height, DWORD dwFormat);
 	
+	// Copy a region of a texture to the region staging texture and read the pixels
+	bool ReadRegionPixels(ID3D11Texture2D* pSource, const D3D11_BOX& box,
+		unsigned char* pixels, bool bRGB, bool bInvert, int rotation);
+
+	// Create or enlarge the region staging texture
+	bool CheckRegionStaging(unsigned int width, unsigned int height, DXGI_FORMAT format);
+
 	// Read pixels from a staging texture
 	bool ReadPixelData(ID3D11Texture2D* pStagingSource, unsigned char* destpixels,
-		unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwap);
+		unsigned int width, unsigned int height, bool bRGB, bool bInvert, bool bSwap, int rotation = 0);
 	
 	// Create or update staging textures
 	bool CheckStagingTextures(unsigned int width, unsigned int height, DWORD dwFormat = DXGI_FORMAT_B8G8R8A8_UNORM);
 
+	// Create or update the SendImage upload textures
+	bool CheckUploadTexture(unsigned int width, unsigned int height, DWORD dwFormat);
+
+	// Map the next SendImage upload texture for writing
+	ID3D11Texture2D* MapUploadTexture(D3D11_MAPPED_SUBRESOURCE& mapped);
+
 	// Create or update class texture
 	bool CheckTexture(unsigned int width, unsigned int height, DWORD dwFormat);
 
@@ -380,4 +659,39 @@ protected :
 
 };
 
+//
+// Scoped view of a sender memory buffer.
+// Data is written or read in place and released
+// when the view goes out of scope.
+//
+class SPOUT_DLLEXP spoutMemoryBufferView {
+
+public:
+
+	// Writable view of the buffer created by a sender
+	spoutMemoryBufferView(spoutDX* spout);
+	// Readable view of a sender's buffer
+	spoutMemoryBufferView(spoutDX* spout, const char* name);
+	~spoutMemoryBufferView();
+
+	// Pointer to the data. Null if the view is not available.
+	char* Data() const;
+	// Bytes available to write or bytes written by the sender
+	int Size() const;
+	// Number of bytes written. The default is the full size.
+	void SetLength(int length);
+
+private:
+
+	spoutMemoryBufferView(const spoutMemoryBufferView&) = delete;
+	spoutMemoryBufferView& operator=(const spoutMemoryBufferView&) = delete;
+
+	spoutDX* m_pSpout = nullptr;
+	char* m_pData = nullptr;
+	int m_Size = 0;
+	int m_Length = 0;
+	bool m_bWrite = false;
+
+};
+
 #endif
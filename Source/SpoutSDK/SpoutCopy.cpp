@@ -81,10 +81,49 @@
 	29.05.25 - Add rgba_swap_ssse3
 	01.07.25 - memcpy_sse2 - handle trailing bytes to avoid 16 byte limitation
 			   Modify CopyPixels and FlipBuffer to test for SSE2 only
+	17.10.26 - Add highbit2rgba and highbit2rgba16 for R10G10B10A2,
+			   R16G16B16A16 unorm and float, and R32G32B32A32 float.
+			   CheckSSE - test for F16C. Add GetF16C.
+			   Add tonemap2rgba for HDR senders with Reinhard, ACES and BT.2390
+			   Add rgba2tensor for normalised planar float tensors
+			   Add rgba2v210, rgba2p010 and rgba2p210 10 bit Y'CbCr packers
+			   Add yuv2rgba for NV12, YUY2 and UYVY
+			   Add premultiply, unpremultiply and over. ClearAlpha - use SSE2
+			   Add srgb2linear16, linear162srgb and rgba2rgbaResampleLinear
+			   Add rgba2rgbaHalf, rgba2rgbaQuarter and rgba2pyramid
+			   Add rgba2rgbaResampleFilter with bicubic, Mitchell and Lanczos3 filters
+			   Add rgba2rgbaRotate and rgb2rgbRotate
+			   Add FrameHash and CompareTiles
+			   Add region2rgba
+			   rgba2rgbaResampleFilter - gamma correct option for SPOUT_FILTER_LINEAR
+			   Finer linear to sRGB table for dark values
+			   highbit2rgba16 - accept 8 bit RGBA and BGRA
 
 */
 
 #include "SpoutCopy.h"
+#include <dxgiformat.h> // for DXGI format names
+
+// F16C half float conversion. Clang requires the target feature.
+#if !defined(_M_ARM64) && (!defined(__clang__) || defined(__F16C__))
+#define SPOUT_F16C
+#include <immintrin.h>
+#endif
+
+// Tone mapping lookup tables
+struct spoutToneMapLUT {
+	int op = -1;
+	float exposure = 0.0f;
+	float peak = 0.0f;
+	float white = 0.0f;
+	// Tone curve and sRGB encoding indexed by L/(1+L)
+	unsigned char curve[8192]{};
+	// PQ code (12 bit) to linear
+	float pq[4096]{};
+	// Half float to 8 bit
+	bool bHalf = false;
+	unsigned char half[65536]{};
+};
 
 //
 // Class: spoutCopy
@@ -98,12 +137,14 @@ spoutCopy::spoutCopy() {
 	m_bSSE2 = false;
 	m_bSSE3 = false;
 	m_bSSSE3 = false;
+	m_bF16C = false;
 	CheckSSE(); // SSE available - sets m_bSSE2, m_bSSE3, m_bSSSE3
 }
 
 
 spoutCopy::~spoutCopy() {
-
+	if (m_pToneMap)
+		delete m_pToneMap;
 }
 
 //---------------------------------------------------------
@@ -258,11 +299,25 @@ void spoutCopy::RemovePadding(const unsigned char *source, unsigned char *dest,
 // Clear alpha of rgba image pixels to the required value
 void spoutCopy::ClearAlpha(unsigned char* src, unsigned int width, unsigned int height, unsigned char alpha) const
 {
-	unsigned char* pixels = src;
-	for (unsigned int i = 0; i<width*height; i++) {
-		*(pixels + 3) = alpha; // alpha is the last of the 4 bytes
-		pixels += 4; // move the pointer along to the next rgba pixel
+	if (!src)
+		return;
+
+	uint32_t* pixels = reinterpret_cast<uint32_t*>(src);
+	const uint64_t count = (uint64_t)width*height;
+	const uint32_t a = (uint32_t)alpha << 24; // alpha is the last of the 4 bytes
+	uint64_t i = 0;
+	if (m_bSSE2) {
+		// 16 pixels at a time
+		const __m128i colour = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i value  = _mm_set1_epi32((int)a);
+		for (; i + 16 <= count; i += 16) {
+			__m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+			for (int j = 0; j < 4; j++)
+				_mm_storeu_si128(p + j, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(p + j), colour), value));
+		}
 	}
+	for (; i < count; i++)
+		pixels[i] = (pixels[i] & 0x00FFFFFF) | a;
 }
 
 
@@ -465,6 +520,552 @@ void spoutCopy::rgba2rgbaResample(const void* source, void* dest,
 	}
 }
 
+//
+// Linear resampling
+//
+// Separable filter with weights of 15 fractional bits. Reducing averages
+// the area of source pixels covered by each destination pixel.
+// Enlarging interpolates between pixel centres. Intermediate values are
+// 16 bit, linear light if gamma corrected, and sums are 32 bit.
+//
+
+// sRGB to 16 bit linear
+static const uint16_t* srgb_linear_table()
+{
+	static const struct table {
+		uint16_t v[256];
+		table() {
+			for (int i = 0; i < 256; i++) {
+				const double s = i/255.0;
+				const double l = (s <= 0.04045) ? s/12.92 : pow((s + 0.055)/1.055, 2.4);
+				v[i] = (uint16_t)(l*65535.0 + 0.5);
+			}
+		}
+	} lut;
+	return lut.v;
+}
+
+// 16 bit linear to sRGB (see linear_srgb).
+// The first 4096 entries are for each value below 4096, where the sRGB curve
+// is steep. The next 4096 are indexed by the top 12 bits and each entry is
+// the centre of its range. All 8 bit values convert back unchanged.
+static const uint8_t* linear_srgb_table()
+{
+	static const struct table {
+		uint8_t v[8192];
+		table() {
+			for (int i = 0; i < 8192; i++) {
+				const double l = (i < 4096) ? i/65535.0 : ((i - 4096)*16 + 8)/65535.0;
+				const double s = (l <= 0.0031308) ? l*12.92 : 1.055*pow(l, 1.0/2.4) - 0.055;
+				v[i] = (uint8_t)(s*255.0 + 0.5);
+			}
+		}
+	} lut;
+	return lut.v;
+}
+
+// 16 bit linear value to sRGB with linear_srgb_table
+static inline uint8_t linear_srgb(const uint8_t* table, uint16_t l)
+{
+	return (l < 4096) ? table[l] : table[4096 + (l >> 4)];
+}
+
+// Source pixels and weights for each destination pixel.
+// All destination pixels have "count" weights starting at "first".
+struct resample_taps {
+	std::vector<unsigned int> first;
+	std::vector<uint16_t> weights;
+	unsigned int count = 0;
+};
+
+static void resample_weights(unsigned int srcSize, unsigned int dstSize, resample_taps& taps)
+{
+	const double ratio = (double)srcSize/(double)dstSize;
+	unsigned int count = (ratio > 1.0) ? (unsigned int)ceil(ratio) + 1 : 2;
+	if (count > srcSize) count = srcSize;
+	taps.count = count;
+	taps.first.assign(dstSize, 0);
+	taps.weights.assign((size_t)dstSize*count, 0);
+
+	std::vector<double> w(count + 2);
+	for (unsigned int d = 0; d < dstSize; d++) {
+		unsigned int s0 = 0;
+		unsigned int n = 0;
+		if (ratio > 1.0) {
+			// Area covered
+			const double x0 = d*ratio;
+			const double x1 = x0 + ratio;
+			s0 = (unsigned int)x0;
+			for (unsigned int s = s0; s < srcSize && s < x1 && n < count; s++, n++)
+				w[n] = ((s + 1 < x1) ? s + 1 : x1) - ((s > x0) ? s : x0);
+		}
+		else {
+			// Bilinear between pixel centres
+			double c = (d + 0.5)*ratio - 0.5;
+			if (c < 0.0) c = 0.0;
+			if (c > srcSize - 1) c = srcSize - 1;
+			s0 = (unsigned int)c;
+			w[0] = 1.0 - (c - s0);
+			w[1] = c - s0;
+			n = (s0 + 1 < srcSize) ? 2 : 1;
+		}
+		// Keep all weights within the source
+		unsigned int first = s0;
+		if (first + count > srcSize)
+			first = srcSize - count;
+		// Weights sum to exactly 1.0 (32768)
+		double sum = 0.0;
+		for (unsigned int i = 0; i < n; i++)
+			sum += w[i];
+		uint16_t* dw = &taps.weights[(size_t)d*count];
+		int total = 0;
+		unsigned int largest = 0;
+		for (unsigned int i = 0; i < n; i++) {
+			const unsigned int k = s0 + i - first;
+			dw[k] = (uint16_t)(w[i]/sum*32768.0 + 0.5);
+			total += dw[k];
+			if (dw[k] > dw[largest])
+				largest = k;
+		}
+		dw[largest] = (uint16_t)(dw[largest] + 32768 - total);
+		taps.first[d] = first;
+	}
+}
+
+// Weighted sum of four 16 bit channels to 32 bit
+static inline __m128i madd_epu16(__m128i sum, __m128i v, __m128i w)
+{
+	return _mm_add_epi32(sum, _mm_unpacklo_epi16(_mm_mullo_epi16(v, w), _mm_mulhi_epu16(v, w)));
+}
+
+// Round four 32 bit sums of 15 fractional bits to 16 bit
+static inline __m128i round_epu16(__m128i sum)
+{
+	const __m128i v = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(16384)), 15);
+	// Signed pack with offset for unsigned values
+	const __m128i bias = _mm_set1_epi32(32768);
+	return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(v, bias), bias), _mm_set1_epi16(-32768));
+}
+
+//---------------------------------------------------------
+// Function: rgba2rgbaResampleLinear
+// Copy rgba buffers of differing size with bilinear filtering
+// for enlarging and area averaging for reducing
+//
+//   bGammaCorrect - filter in linear light instead of sRGB values
+//   Results are within 0.55 of a double precision reference,
+//   compared to 0.5 without gamma correction
+//
+void spoutCopy::rgba2rgbaResampleLinear(const void* source, void* dest,
+	unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+	unsigned int destWidth, unsigned int destHeight, bool bInvert, bool bGammaCorrect) const
+{
+	if (!source || !dest || sourceWidth == 0 || sourceHeight == 0 || destWidth == 0 || destHeight == 0)
+		return;
+	if (sourcePitch == 0)
+		sourcePitch = sourceWidth*4;
+
+	resample_taps htaps, vtaps;
+	resample_weights(sourceWidth, destWidth, htaps);
+	resample_weights(sourceHeight, destHeight, vtaps);
+
+	const uint16_t* tolinear = srgb_linear_table();
+	const uint8_t* tosrgb = linear_srgb_table();
+
+	// Horizontal pass of all source lines at the destination width
+	std::vector<uint16_t> line((size_t)sourceWidth*4);
+	std::vector<uint16_t> inter((size_t)sourceHeight*destWidth*4);
+	auto src = static_cast<const unsigned char*>(source);
+	for (unsigned int y = 0; y < sourceHeight; y++) {
+		const unsigned char* s = src + (uint64_t)y*sourcePitch;
+		for (unsigned int i = 0; i < sourceWidth*4; i += 4) {
+			line[i]     = bGammaCorrect ? tolinear[s[i]]     : (uint16_t)(s[i]*257);
+			line[i + 1] = bGammaCorrect ? tolinear[s[i + 1]] : (uint16_t)(s[i + 1]*257);
+			line[i + 2] = bGammaCorrect ? tolinear[s[i + 2]] : (uint16_t)(s[i + 2]*257);
+			line[i + 3] = (uint16_t)(s[i + 3]*257);
+		}
+		uint16_t* out = &inter[(size_t)y*destWidth*4];
+		for (unsigned int x = 0; x < destWidth; x++) {
+			const uint16_t* pix = &line[(size_t)htaps.first[x]*4];
+			const uint16_t* w = &htaps.weights[(size_t)x*htaps.count];
+			if (m_bSSE2) {
+				__m128i sum = _mm_setzero_si128();
+				for (unsigned int t = 0; t < htaps.count; t++)
+					sum = madd_epu16(sum, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pix + t*4)), _mm_set1_epi16((short)w[t]));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x*4), round_epu16(sum));
+			}
+			else {
+				for (int c = 0; c < 4; c++) {
+					uint32_t sum = 0;
+					for (unsigned int t = 0; t < htaps.count; t++)
+						sum += (uint32_t)pix[t*4 + c]*w[t];
+					out[x*4 + c] = (uint16_t)((sum + 16384) >> 15);
+				}
+			}
+		}
+	}
+
+	// Vertical pass to the destination
+	const unsigned int channels = destWidth*4;
+	std::vector<uint16_t> result(channels + 4);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < destHeight; y++) {
+		const uint16_t* rows = &inter[(size_t)vtaps.first[y]*channels];
+		const uint16_t* w = &vtaps.weights[(size_t)y*vtaps.count];
+		unsigned int c = 0;
+		if (m_bSSE2) {
+			for (; c + 8 <= channels; c += 8) {
+				__m128i lo = _mm_setzero_si128();
+				__m128i hi = _mm_setzero_si128();
+				for (unsigned int t = 0; t < vtaps.count; t++) {
+					const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (size_t)t*channels + c));
+					const __m128i wt = _mm_set1_epi16((short)w[t]);
+					const __m128i pl = _mm_mullo_epi16(v, wt);
+					const __m128i ph = _mm_mulhi_epu16(v, wt);
+					lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(pl, ph));
+					hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(pl, ph));
+				}
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(&result[c]), round_epu16(lo));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(&result[c + 4]), round_epu16(hi));
+			}
+		}
+		for (; c < channels; c++) {
+			uint32_t sum = 0;
+			for (unsigned int t = 0; t < vtaps.count; t++)
+				sum += (uint32_t)rows[(size_t)t*channels + c]*w[t];
+			result[c] = (uint16_t)((sum + 16384) >> 15);
+		}
+		unsigned char* out = dst + (uint64_t)(bInvert ? (destHeight - 1 - y) : y)*channels;
+		for (c = 0; c < channels; c += 4) {
+			out[c]     = bGammaCorrect ? linear_srgb(tosrgb, result[c])     : (unsigned char)((result[c] + 128)/257);
+			out[c + 1] = bGammaCorrect ? linear_srgb(tosrgb, result[c + 1]) : (unsigned char)((result[c + 1] + 128)/257);
+			out[c + 2] = bGammaCorrect ? linear_srgb(tosrgb, result[c + 2]) : (unsigned char)((result[c + 2] + 128)/257);
+			out[c + 3] = (unsigned char)((result[c + 3] + 128)/257);
+		}
+	}
+
+} // end rgba2rgbaResampleLinear
+
+//
+// Polyphase resampling
+//
+// Separable bicubic, Mitchell or Lanczos3 filter. The filter bank has the
+// weights for each destination pixel in 14 bit fixed point, widened by the
+// reduction ratio when reducing. The horizontal pass converts source lines
+// to 16 bit values with 6 fractional bits. The vertical pass works on
+// blocks of columns so that the lines of a block stay in the cache.
+// Threads work on bands of destination lines.
+//
+
+struct spoutFilterBank {
+	std::vector<unsigned int> first;
+	std::vector<int16_t> weights;
+	unsigned int count = 0;
+};
+
+static double filter_kernel(int filter, double x)
+{
+	x = fabs(x);
+	switch (filter) {
+		case SPOUT_FILTER_BICUBIC: // Catmull-Rom, a = -0.5
+			if (x < 1.0) return (1.5*x - 2.5)*x*x + 1.0;
+			if (x < 2.0) return ((-0.5*x + 2.5)*x - 4.0)*x + 2.0;
+			return 0.0;
+		case SPOUT_FILTER_MITCHELL: // B = C = 1/3
+			if (x < 1.0) return ((7.0*x - 12.0)*x*x + 16.0/3.0)/6.0;
+			if (x < 2.0) return (((-7.0/3.0*x + 12.0)*x - 20.0)*x + 32.0/3.0)/6.0;
+			return 0.0;
+		default: { // Lanczos3
+			if (x < 1e-8) return 1.0;
+			if (x >= 3.0) return 0.0;
+			const double px = 3.14159265358979323846*x;
+			return 3.0*sin(px)*sin(px/3.0)/(px*px);
+		}
+	}
+}
+
+static void filter_weights(int filter, unsigned int srcSize, unsigned int dstSize, spoutFilterBank& bank)
+{
+	const double ratio = (double)srcSize/(double)dstSize;
+	const double scale = (ratio > 1.0) ? ratio : 1.0;
+	const double support = ((filter == SPOUT_FILTER_LANCZOS3) ? 3.0 : 2.0)*scale;
+	unsigned int count = (unsigned int)ceil(support)*2 + 1;
+	if (count > srcSize) count = srcSize;
+	bank.count = count;
+	bank.first.assign(dstSize, 0);
+	bank.weights.assign((size_t)dstSize*count, 0);
+
+	std::vector<double> w(count);
+	for (unsigned int d = 0; d < dstSize; d++) {
+		const double centre = (d + 0.5)*ratio;
+		int x0 = (int)(centre - support + 0.5);
+		int x1 = (int)(centre + support + 0.5);
+		if (x0 < 0) x0 = 0;
+		if (x1 > (int)srcSize) x1 = (int)srcSize;
+		if (x1 - x0 > (int)count) x1 = x0 + (int)count;
+		double sum = 0.0;
+		for (int x = x0; x < x1; x++) {
+			w[x - x0] = filter_kernel(filter, (x + 0.5 - centre)/scale);
+			sum += w[x - x0];
+		}
+		// Keep all weights within the source
+		unsigned int first = (unsigned int)x0;
+		if (first + count > srcSize)
+			first = srcSize - count;
+		// Weights sum to exactly 1.0 (16384)
+		int16_t* dw = &bank.weights[(size_t)d*count];
+		int total = 0;
+		unsigned int largest = 0;
+		for (int x = x0; x < x1; x++) {
+			const unsigned int k = x - first;
+			dw[k] = (int16_t)floor(w[x - x0]/sum*16384.0 + 0.5);
+			total += dw[k];
+			if (dw[k] > dw[largest])
+				largest = k;
+		}
+		dw[largest] = (int16_t)(dw[largest] + 16384 - total);
+		bank.first[d] = first;
+	}
+}
+
+//---------------------------------------------------------
+// Function: rgba2rgbaResampleFilter
+// Copy rgba buffers of differing size with a bicubic, Mitchell or Lanczos3 filter
+//
+//   filter  - SPOUT_FILTER_BICUBIC, SPOUT_FILTER_MITCHELL or SPOUT_FILTER_LANCZOS3.
+//             SPOUT_FILTER_NEAREST and SPOUT_FILTER_LINEAR use rgba2rgbaResample
+//             and rgba2rgbaResampleLinear.
+//   threads - 0 for automatic
+//   bGammaCorrect - SPOUT_FILTER_LINEAR in linear light instead of sRGB values
+//
+// The destination line pitch is destWidth*4.
+//
+void spoutCopy::rgba2rgbaResampleFilter(const void* source, void* dest,
+	unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+	unsigned int destWidth, unsigned int destHeight, int filter, bool bInvert, unsigned int threads,
+	bool bGammaCorrect) const
+{
+	if (!source || !dest || sourceWidth == 0 || sourceHeight == 0 || destWidth == 0 || destHeight == 0)
+		return;
+	if (sourcePitch == 0)
+		sourcePitch = sourceWidth*4;
+
+	if (filter == SPOUT_FILTER_NEAREST) {
+		rgba2rgbaResample(source, dest, sourceWidth, sourceHeight, sourcePitch, destWidth, destHeight, bInvert);
+		return;
+	}
+	if (filter == SPOUT_FILTER_LINEAR) {
+		rgba2rgbaResampleLinear(source, dest, sourceWidth, sourceHeight, sourcePitch, destWidth, destHeight, bInvert, bGammaCorrect);
+		return;
+	}
+
+	spoutFilterBank hbank, vbank;
+	filter_weights(filter, sourceWidth, destWidth, hbank);
+	filter_weights(filter, sourceHeight, destHeight, vbank);
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+
+	unsigned int nthreads = 1;
+#ifdef USE_CHRONO
+	nthreads = threads;
+	if (nthreads == 0) {
+		// One thread for each 512K destination pixels, up to 8
+		nthreads = std::thread::hardware_concurrency();
+		if (nthreads > 8) nthreads = 8;
+		const unsigned int work = (unsigned int)(((uint64_t)destWidth*destHeight) >> 19) + 1;
+		if (nthreads > work) nthreads = work;
+	}
+	if (nthreads > destHeight) nthreads = destHeight;
+	if (nthreads > 1) {
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < nthreads; t++) {
+			workers.emplace_back(&spoutCopy::filter_rows, this, src, sourcePitch,
+				dst, destWidth, destHeight, &hbank, &vbank, bInvert,
+				(unsigned int)(((uint64_t)destHeight*t)/nthreads), (unsigned int)(((uint64_t)destHeight*(t + 1))/nthreads));
+		}
+		// The first band on this thread
+		filter_rows(src, sourcePitch, dst, destWidth, destHeight, &hbank, &vbank, bInvert, 0, destHeight/nthreads);
+		for (auto& worker : workers)
+			worker.join();
+		return;
+	}
+#else
+	UNREFERENCED_PARAMETER(threads);
+#endif
+	filter_rows(src, sourcePitch, dst, destWidth, destHeight, &hbank, &vbank, bInvert, 0, destHeight);
+
+} // end rgba2rgbaResampleFilter
+
+//
+// Power of two reduction
+//
+// Each destination pixel is the average of 2x2 or 4x4 source pixels
+// rounded to nearest. Half reduction averages with pavgb and corrects
+// the rounding so that the result is exact.
+//
+
+//---------------------------------------------------------
+// Function: rgba2rgbaHalf
+// Reduce rgba by exactly half
+//
+//   width, height - source size. The destination is width/2 x height/2.
+//   destPitch     - 0 for (width/2)*4
+//
+// See rgba2pyramid for a threaded version.
+//
+void spoutCopy::rgba2rgbaHalf(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch) const
+{
+	if (!source || !dest || width < 2 || height < 2)
+		return;
+	if (sourcePitch == 0) sourcePitch = width*4;
+	if (destPitch == 0) destPitch = (width/2)*4;
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < height/2; y++) {
+		const unsigned char* row0 = src + (uint64_t)y*2*sourcePitch;
+		half_line(row0, row0 + sourcePitch, reinterpret_cast<uint32_t*>(dst + (uint64_t)y*destPitch), width/2);
+	}
+}
+
+//---------------------------------------------------------
+// Function: rgba2rgbaQuarter
+// Reduce rgba by exactly a quarter
+//
+//   width, height - source size. The destination is width/4 x height/4.
+//   destPitch     - 0 for (width/4)*4
+//
+void spoutCopy::rgba2rgbaQuarter(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch) const
+{
+	if (!source || !dest || width < 4 || height < 4)
+		return;
+	if (sourcePitch == 0) sourcePitch = width*4;
+	if (destPitch == 0) destPitch = (width/4)*4;
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < height/4; y++)
+		quarter_line(src + (uint64_t)y*4*sourcePitch, sourcePitch, reinterpret_cast<uint32_t*>(dst + (uint64_t)y*destPitch), width/4);
+}
+
+//---------------------------------------------------------
+// Function: rgba2pyramid
+// Mip pyramid of successive half reductions
+//
+//   levels  - "count" buffers. levels[i] receives (width >> (i+1)) x (height >> (i+1))
+//             rgba pixels with no line padding.
+//   threads - 0 for automatic
+//
+// Each line of a level is reduced as soon as the two lines above it are
+// complete, so that they are still in the cache. Threads work on bands of
+// source lines that are a multiple of the last level reduction.
+//
+bool spoutCopy::rgba2pyramid(const void* source, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, void** levels, unsigned int count, unsigned int threads) const
+{
+	if (!source || !levels || count == 0 || count > 31 || (width >> count) == 0 || (height >> count) == 0)
+		return false;
+	for (unsigned int i = 0; i < count; i++) {
+		if (!levels[i])
+			return false;
+	}
+	if (sourcePitch == 0) sourcePitch = width*4;
+
+	auto src = static_cast<const unsigned char*>(source);
+	const unsigned int rows = height/2; // first level lines
+	const unsigned int band = 1u << (count - 1); // first level lines for one line of the last
+
+	unsigned int nthreads = 1;
+#ifdef USE_CHRONO
+	nthreads = threads;
+	if (nthreads == 0) {
+		// One thread for each 2M source pixels, up to 8
+		nthreads = std::thread::hardware_concurrency();
+		if (nthreads > 8) nthreads = 8;
+		const unsigned int work = (unsigned int)(((uint64_t)width*height) >> 21) + 1;
+		if (nthreads > work) nthreads = work;
+	}
+	const unsigned int bands = (rows + band - 1)/band;
+	if (nthreads > bands) nthreads = bands;
+	if (nthreads > 1) {
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < nthreads; t++) {
+			const unsigned int start = (unsigned int)(((uint64_t)bands*t)/nthreads)*band;
+			unsigned int end = (unsigned int)(((uint64_t)bands*(t + 1))/nthreads)*band;
+			if (end > rows) end = rows;
+			workers.emplace_back(&spoutCopy::pyramid_rows, this, src, width, height, sourcePitch,
+				levels, count, start, end);
+		}
+		// The first band on this thread
+		pyramid_rows(src, width, height, sourcePitch, levels, count, 0, (bands/nthreads)*band);
+		for (auto& worker : workers)
+			worker.join();
+		return true;
+	}
+#else
+	UNREFERENCED_PARAMETER(threads);
+#endif
+	pyramid_rows(src, width, height, sourcePitch, levels, count, 0, rows);
+
+	return true;
+
+} // end rgba2pyramid
+
+//---------------------------------------------------------
+// Function: srgb2linear16
+// Convert sRGB rgba pixels to 16 bit linear
+void spoutCopy::srgb2linear16(const void* source, uint16_t* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bInvert) const
+{
+	if (!source || !dest)
+		return;
+	if (sourcePitch == 0) sourcePitch = width*4;
+	if (destPitch == 0) destPitch = width*8;
+
+	const uint16_t* tolinear = srgb_linear_table();
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = reinterpret_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* s = src + (uint64_t)(bInvert ? (height - 1 - y) : y)*sourcePitch;
+		auto d = reinterpret_cast<uint16_t*>(dst + (uint64_t)y*destPitch);
+		for (unsigned int i = 0; i < width*4; i += 4) {
+			d[i]     = tolinear[s[i]];
+			d[i + 1] = tolinear[s[i + 1]];
+			d[i + 2] = tolinear[s[i + 2]];
+			d[i + 3] = (uint16_t)(s[i + 3]*257);
+		}
+	}
+}
+
+//---------------------------------------------------------
+// Function: linear162srgb
+// Convert 16 bit linear rgba pixels to sRGB
+void spoutCopy::linear162srgb(const uint16_t* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bInvert) const
+{
+	if (!source || !dest)
+		return;
+	if (sourcePitch == 0) sourcePitch = width*8;
+	if (destPitch == 0) destPitch = width*4;
+
+	const uint8_t* tosrgb = linear_srgb_table();
+	auto src = reinterpret_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < height; y++) {
+		auto s = reinterpret_cast<const uint16_t*>(src + (uint64_t)(bInvert ? (height - 1 - y) : y)*sourcePitch);
+		unsigned char* d = dst + (uint64_t)y*destPitch;
+		for (unsigned int i = 0; i < width*4; i += 4) {
+			d[i]     = linear_srgb(tosrgb, s[i]);
+			d[i + 1] = linear_srgb(tosrgb, s[i + 1]);
+			d[i + 2] = linear_srgb(tosrgb, s[i + 2]);
+			d[i + 3] = (unsigned char)((s[i + 3] + 128)/257);
+		}
+	}
+}
+
 //
 // Group: RGBA <> BGRA
 //
@@ -1475,69 +2076,1365 @@ void spoutCopy::bgra2bgr(const void *bgra_source, void *bgr_dest, unsigned int w
 	}
 } // end bgra2bgr
 
+//
+// Group: High bit depth formats
+//
+// Sender textures in these DXGI formats are accepted by the DirectX 11 copy shader
+// and can be read back directly from a staging texture.
+//
+//   DXGI_FORMAT_R32G32B32A32_FLOAT (2)
+//   DXGI_FORMAT_R16G16B16A16_FLOAT (10)
+//   DXGI_FORMAT_R16G16B16A16_UNORM (11)
+//   DXGI_FORMAT_R10G10B10A2_UNORM  (24)
+//
+// Float values are clamped to 0-1. Half floats use F16C if available.
+//
 
 //---------------------------------------------------------
-// Function: GetSSE
-// Return SSE2, SSE3 and SSSE3 capability
-//
-void spoutCopy::GetSSE(bool &bSSE2, bool &bSSE3, bool &bSSSE3)
+// Function: IsHighBitFormat
+// Return whether a DXGI format can be converted by highbit2rgba
+bool spoutCopy::IsHighBitFormat(DWORD dwFormat) const
 {
-	bSSE2  = m_bSSE2;
-	bSSE3  = m_bSSE3;
-	bSSSE3 = m_bSSSE3;
+	return (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM || dwFormat == DXGI_FORMAT_R10G10B10A2_UNORM);
 }
 
 //---------------------------------------------------------
-// Function: GetSSE2
-//     Return SSE3 capability
-bool spoutCopy::GetSSE2()
+// Function: highbit2rgba
+// Convert high bit depth pixels to 8 bit RGBA, BGRA, RGB or BGR
+// allowing for source and destination line pitch.
+//
+//   glFormat  - GL_RGBA, GL_BGRA_EXT, GL_RGB or GL_BGR_EXT
+//   destPitch - 0 for width * bytes per pixel
+//
+bool spoutCopy::highbit2rgba(const void* source, void* dest,
+	unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch,
+	DWORD dwFormat, GLenum glFormat, bool bInvert) const
 {
-	return m_bSSE2;
-}
+	if (!source || !dest || !IsHighBitFormat(dwFormat))
+		return false;
+
+	const bool bRGB = (glFormat == GL_RGB || glFormat == GL_BGR_EXT);
+	const bool bSwapRB = (glFormat == GL_BGRA_EXT || glFormat == GL_BGR_EXT);
+	if (!bRGB && glFormat != GL_RGBA && glFormat != GL_BGRA_EXT)
+		return false;
+
+	if (destPitch == 0)
+		destPitch = width * (bRGB ? 3 : 4);
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+
+	// Line buffer for RGB and BGR output
+	uint32_t line[256]{};
+
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* srcline = src + (uint64_t)(bInvert ? (height - 1 - y) : y) * sourcePitch;
+		unsigned char* dstline = dst + (uint64_t)y * destPitch;
+		if (!bRGB) {
+			highbit_line_to_rgba8(srcline, reinterpret_cast<uint32_t*>(dstline), width, dwFormat, bSwapRB);
+			continue;
+		}
+		// Convert to rgba in blocks and copy to rgb
+		const unsigned int bpp = (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : (dwFormat == DXGI_FORMAT_R10G10B10A2_UNORM) ? 4 : 8;
+		for (unsigned int x = 0; x < width; x += 256) {
+			const unsigned int count = (width - x < 256) ? (width - x) : 256;
+			highbit_line_to_rgba8(srcline + (uint64_t)x*bpp, line, count, dwFormat, bSwapRB);
+			unsigned char* rgb = dstline + (uint64_t)x*3;
+			for (unsigned int i = 0; i < count; i++) {
+				const uint32_t p = line[i];
+				rgb[0] = (unsigned char)(p);
+				rgb[1] = (unsigned char)(p >> 8);
+				rgb[2] = (unsigned char)(p >> 16);
+				rgb += 3;
+			}
+		}
+	}
+
+	return true;
+
+} // end highbit2rgba
 
 //---------------------------------------------------------
-// Function: GetSSE3
-//     Return sSSE3 capability
-bool spoutCopy::GetSSE3()
+// Function: highbit2rgba16
+// Convert high bit depth pixels to 16 bit unsigned RGBA
+// allowing for source and destination line pitch.
+// 8 bit RGBA and BGRA pixels are also accepted and expanded.
+//
+//   destPitch - 0 for width * 8
+//
+bool spoutCopy::highbit2rgba16(const void* source, void* dest,
+	unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch,
+	DWORD dwFormat, bool bInvert) const
 {
-	return m_bSSE3;
+	const bool b8bit = (dwFormat == DXGI_FORMAT_R8G8B8A8_UNORM || dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM);
+	if (!source || !dest || (!b8bit && !IsHighBitFormat(dwFormat)))
+		return false;
+
+	if (destPitch == 0)
+		destPitch = width * 8;
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* srcline = src + (uint64_t)(bInvert ? (height - 1 - y) : y) * sourcePitch;
+		auto dstline = reinterpret_cast<uint16_t*>(dst + (uint64_t)y * destPitch);
+		if (dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) {
+			// Already 16 bit unorm
+			memcpy(dstline, srcline, (size_t)width * 8);
+			continue;
+		}
+		if (b8bit) {
+			// Replicate 8 bit values into the low byte
+			const unsigned int r = (dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM) ? 2 : 0;
+			for (unsigned int x = 0; x < width; x++) {
+				const unsigned char* p = srcline + x*4;
+				dstline[x*4]     = (uint16_t)(p[r]*257);
+				dstline[x*4 + 1] = (uint16_t)(p[1]*257);
+				dstline[x*4 + 2] = (uint16_t)(p[2 - r]*257);
+				dstline[x*4 + 3] = (uint16_t)(p[3]*257);
+			}
+			continue;
+		}
+		highbit_line_to_rgba16(srcline, dstline, width, dwFormat);
+	}
+
+	return true;
+
+} // end highbit2rgba16
+
+//
+// Group: Tone mapping
+//
+// High dynamic range senders to 8 bit sRGB pixels.
+//
+// Float and half float formats are scRGB with linear BT.709 values
+// and 1.0 for 80 nits reference white. R10G10B10A2 and R16G16B16A16 unorm
+// formats can be PQ (SMPTE ST 2084) encoded BT.2020 with 203 nits
+// reference white (ITU-R BT.2408).
+//
+// Operators :
+//   SPOUT_TONEMAP_NONE     - clamp to reference white
+//   SPOUT_TONEMAP_REINHARD - extended Reinhard with peak as the white point
+//   SPOUT_TONEMAP_ACES     - ACES filmic curve fit (K. Narkowicz)
+//   SPOUT_TONEMAP_BT2390   - ITU-R BT.2390 EETF from peak to reference white
+//
+// Each channel is mapped independently. The tone curve and sRGB encoding
+// are combined in a lookup table that is re-built if the parameters change.
+// Half floats are converted with a table indexed by the 16 bit value.
+//
+
+// PQ constants
+static const float pq_m1 = 0.1593017578125f;
+static const float pq_m2 = 78.84375f;
+static const float pq_c1 = 0.8359375f;
+static const float pq_c2 = 18.8515625f;
+static const float pq_c3 = 18.6875f;
+
+// PQ signal (0-1) to nits
+static float pq_to_nits(float e)
+{
+	const float ep = powf(e < 0.0f ? 0.0f : e, 1.0f/pq_m2);
+	const float num = (ep - pq_c1) > 0.0f ? (ep - pq_c1) : 0.0f;
+	return 10000.0f*powf(num/(pq_c2 - pq_c3*ep), 1.0f/pq_m1);
 }
 
-//---------------------------------------------------------
-// Function: GetSSSE3
-//     Return SSSE3 capability
-bool spoutCopy::GetSSSE3()
+// Nits to PQ signal (0-1)
+static float nits_to_pq(float nits)
 {
-	return m_bSSSE3;
+	const float yp = powf((nits < 0.0f ? 0.0f : nits)/10000.0f, pq_m1);
+	return powf((pq_c1 + pq_c2*yp)/(1.0f + pq_c3*yp), pq_m2);
 }
 
+// Scene value relative to reference white to display value (0-1)
+static float tone_curve(float L, int op, float peak, float white)
+{
+	float D = L;
+	switch (op) {
+		case SPOUT_TONEMAP_REINHARD:
+			{
+				const float Lw = peak/white;
+				D = L*(1.0f + L/(Lw*Lw))/(1.0f + L);
+			}
+			break;
+		case SPOUT_TONEMAP_ACES:
+			{
+				const float x = L*0.6f;
+				D = (x*(2.51f*x + 0.03f))/(x*(2.43f*x + 0.59f) + 0.14f);
+			}
+			break;
+		case SPOUT_TONEMAP_BT2390:
+			{
+				// Source peak to reference white in the PQ domain
+				const float peakPQ = nits_to_pq(peak);
+				const float maxLum = nits_to_pq(white)/peakPQ;
+				float E = nits_to_pq(L*white)/peakPQ;
+				if (E > 1.0f) E = 1.0f;
+				const float KS = 1.5f*maxLum - 0.5f;
+				if (E > KS && KS < 1.0f) {
+					// Hermite spline roll-off
+					const float T = (E - KS)/(1.0f - KS);
+					const float T2 = T*T;
+					const float T3 = T2*T;
+					E = (2.0f*T3 - 3.0f*T2 + 1.0f)*KS
+						+ (T3 - 2.0f*T2 + T)*(1.0f - KS)
+						+ (-2.0f*T3 + 3.0f*T2)*maxLum;
+				}
+				D = pq_to_nits(E*peakPQ)/white;
+			}
+			break;
+		default:
+			break;
+	}
+	if (D < 0.0f) D = 0.0f;
+	if (D > 1.0f) D = 1.0f;
+	// sRGB encoding
+	return (D <= 0.0031308f) ? D*12.92f : 1.055f*powf(D, 1.0f/2.4f) - 0.055f;
+}
 
+//---------------------------------------------------------
+// Function: tonemap2rgba
+// Tone map high dynamic range pixels to 8 bit sRGB RGBA, BGRA, RGB or BGR
+// allowing for source and destination line pitch.
 //
-// Protected
+//   dwFormat  - DXGI_FORMAT_R32G32B32A32_FLOAT, R16G16B16A16_FLOAT,
+//               or R10G10B10A2_UNORM and R16G16B16A16_UNORM with bPQ
+//   glFormat  - GL_RGBA, GL_BGRA_EXT, GL_RGB or GL_BGR_EXT
+//   toneMap   - SpoutToneMap operator
+//   exposure  - scene value multiplier
+//   peakNits  - source peak luminance for Reinhard and BT.2390
+//   bPQ       - unorm formats are PQ encoded BT.2020
 //
+// Unorm formats without PQ encoding are converted by highbit2rgba.
+//
+bool spoutCopy::tonemap2rgba(const void* source, void* dest,
+	unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch,
+	DWORD dwFormat, GLenum glFormat, int toneMap,
+	float exposure, float peakNits, bool bPQ, bool bInvert)
+{
+	const bool bFloat = (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT);
+	if (!bFloat && !bPQ)
+		return highbit2rgba(source, dest, width, height, sourcePitch, destPitch, dwFormat, glFormat, bInvert);
+
+	if (!source || !dest || !IsHighBitFormat(dwFormat))
+		return false;
+
+	const bool bRGB = (glFormat == GL_RGB || glFormat == GL_BGR_EXT);
+	const bool bSwapRB = (glFormat == GL_BGRA_EXT || glFormat == GL_BGR_EXT);
+	if (!bRGB && glFormat != GL_RGBA && glFormat != GL_BGRA_EXT)
+		return false;
+
+	const unsigned int bpp = bRGB ? 3 : 4;
+	if (destPitch == 0)
+		destPitch = width*bpp;
+
+	// Reference white for scRGB or PQ
+	const float white = bFloat ? 80.0f : 203.0f;
+	if (peakNits < white)
+		peakNits = white;
+	if (exposure <= 0.0f)
+		exposure = 1.0f;
+	CheckToneMapLUT(toneMap, exposure, peakNits, white, dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT);
+	const spoutToneMapLUT* lut = m_pToneMap;
+
+	// Output byte positions
+	const unsigned int ri = bSwapRB ? 2 : 0;
+	const unsigned int bi = bSwapRB ? 0 : 2;
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+
+	// Lookup table index from linear values
+	// u = L/(1+L) maps 0 - infinity to 0 - 1
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(8191.0f);
+	const __m128 gain = _mm_setr_ps(exposure, exposure, exposure, 0.0f);
+	int idx[4]{};
+
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* s = src + (uint64_t)(bInvert ? (height - 1 - y) : y)*sourcePitch;
+		unsigned char* d = dst + (uint64_t)y*destPitch;
+
+		if (dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT) {
+			// Half float - one lookup per channel
+			auto h = reinterpret_cast<const uint16_t*>(s);
+			for (unsigned int x = 0; x < width; x++) {
+				d[ri] = lut->half[h[0]];
+				d[1]  = lut->half[h[1]];
+				d[bi] = lut->half[h[2]];
+				if (!bRGB) {
+					float a = half_to_float(h[3]);
+					a = (a > 0.0f) ? ((a < 1.0f) ? a : 1.0f) : 0.0f;
+					d[3] = (unsigned char)(a*255.0f + 0.5f);
+				}
+				h += 4;
+				d += bpp;
+			}
+			continue;
+		}
+
+		for (unsigned int x = 0; x < width; x++) {
+			__m128 p;
+			float a = 1.0f;
+			if (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+				p = _mm_loadu_ps(reinterpret_cast<const float*>(s) + x*4);
+				a = _mm_cvtss_f32(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)));
+			}
+			else {
+				// PQ BT.2020 to linear BT.709
+				float r = 0.0f, g = 0.0f, b = 0.0f;
+				if (dwFormat == DXGI_FORMAT_R10G10B10A2_UNORM) {
+					const uint32_t v = reinterpret_cast<const uint32_t*>(s)[x];
+					const uint32_t r10 = v & 0x3FF, g10 = (v >> 10) & 0x3FF, b10 = (v >> 20) & 0x3FF;
+					r = lut->pq[(r10 << 2) | (r10 >> 8)];
+					g = lut->pq[(g10 << 2) | (g10 >> 8)];
+					b = lut->pq[(b10 << 2) | (b10 >> 8)];
+					a = (float)(v >> 30)/3.0f;
+				}
+				else {
+					const uint16_t* v = reinterpret_cast<const uint16_t*>(s) + x*4;
+					r = lut->pq[v[0] >> 4];
+					g = lut->pq[v[1] >> 4];
+					b = lut->pq[v[2] >> 4];
+					a = (float)v[3]/65535.0f;
+				}
+				p = _mm_setr_ps(
+					 1.6605f*r - 0.5876f*g - 0.0728f*b,
+					-0.1246f*r + 1.1329f*g - 0.0083f*b,
+					-0.0182f*r - 0.1006f*g + 1.1187f*b, 0.0f);
+			}
+			// Exposure and curve index
+			// min returns one for infinity (inf/inf is NaN)
+			p = _mm_max_ps(_mm_mul_ps(p, gain), zero);
+			p = _mm_min_ps(_mm_div_ps(p, _mm_add_ps(p, one)), one);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(idx), _mm_cvttps_epi32(_mm_mul_ps(p, scale)));
+			d[ri] = lut->curve[idx[0]];
+			d[1]  = lut->curve[idx[1]];
+			d[bi] = lut->curve[idx[2]];
+			if (!bRGB) {
+				a = (a > 0.0f) ? ((a < 1.0f) ? a : 1.0f) : 0.0f;
+				d[3] = (unsigned char)(a*255.0f + 0.5f);
+			}
+			d += bpp;
+		}
+	}
+
+	return true;
+
+} // end tonemap2rgba
 
 //
-//					CheckSSE()
+// Group: Tensor conversion
 //
-// https://msdn.microsoft.com/en-us/library/hskdteyh.aspx
+// RGBA or BGRA images to a planar normalised float tensor (NCHW)
+// for inference. Resize, channel order, conversion to float or
+// half float and mean/std normalisation are done in one pass.
 //
-// static bool SSE2 (void) { return CPU_Rep.f_1_EDX_[26]; }
-// SSE2 | [bit 26] EDX
-// SSE2 = (cpuid03 & (0x1 << 26))
+//   out = (value/255 - mean)/std
 //
-// static bool SSE3 (void) { return CPU_Rep.f_1_ECX_[0]; }
-// SSE3 | [bit 0] ECX
-// SSE3 = (cpuid02 & (0x1)
+// Several images can be converted to consecutive batch entries.
+// Rows are divided between threads (see SpoutTensorDesc).
 //
-// static bool SSSE3(void) { return CPU_Rep.f_1_ECX_[9]; }
-// SSSE3 | [bit 9] ECX
-// SSSE3 = (cpuid02 & (0x1 << 9)
+
+//---------------------------------------------------------
+// Function: rgba2tensor
+// Convert one image to a tensor
+bool spoutCopy::rgba2tensor(const SpoutTensorImage& image, void* tensor,
+	const SpoutTensorDesc& desc) const
+{
+	return rgba2tensor(&image, 1, tensor, desc);
+}
+
+//---------------------------------------------------------
+// Function: rgba2tensor
+// Convert a batch of images to a tensor of "count" images
 //
-// SSE4 not currently used :
+// The tensor size is count*3*desc.height*desc.width elements
+// of 4 bytes (float) or 2 bytes (half float)
 //
-// SSE4.1 and SSE4.2 are extensions of SSE, SSE2, SSE3, and SSSE3. 
-// To check if the processor supports SSE4.1, execute CPUID with EAX = 1 as input.
-// If bit 19 of ECX is set, then the processor supports SSE4.1.
+bool spoutCopy::rgba2tensor(const SpoutTensorImage* images, unsigned int count,
+	void* tensor, const SpoutTensorDesc& desc) const
+{
+	if (!images || count == 0 || !tensor || desc.width == 0 || desc.height == 0)
+		return false;
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (!images[i].pixels || images[i].width == 0 || images[i].height == 0)
+			return false;
+	}
+
+	const unsigned int rows = count*desc.height;
+	unsigned int nthreads = 1;
+#ifdef USE_CHRONO
+	nthreads = desc.threads;
+	if (nthreads == 0) {
+		// One thread for each 64K output pixels, up to 8
+		nthreads = std::thread::hardware_concurrency();
+		if (nthreads > 8) nthreads = 8;
+		const unsigned int work = (unsigned int)(((uint64_t)count*desc.width*desc.height)/65536) + 1;
+		if (nthreads > work) nthreads = work;
+	}
+	if (nthreads > rows) nthreads = rows;
+	if (nthreads > 1) {
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < nthreads; t++) {
+			workers.emplace_back(&spoutCopy::tensor_rows, this, images, count, tensor, std::cref(desc),
+				(unsigned int)(((uint64_t)rows*t)/nthreads), (unsigned int)(((uint64_t)rows*(t + 1))/nthreads));
+		}
+		// The first block on this thread
+		tensor_rows(images, count, tensor, desc, 0, rows/nthreads);
+		for (auto& worker : workers)
+			worker.join();
+		return true;
+	}
+#endif
+	tensor_rows(images, count, tensor, desc, 0, rows);
+
+	return true;
+
+} // end rgba2tensor
+
+//---------------------------------------------------------
+// Function: float_to_half
+// Float to half float rounded to nearest even
+uint16_t spoutCopy::float_to_half(float f)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &f, 4);
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t absbits = bits & 0x7FFFFFFF;
+
+	// Infinity or NaN
+	if (absbits >= 0x7F800000)
+		return (uint16_t)(sign | 0x7C00 | (absbits > 0x7F800000 ? 0x200 : 0));
+	// Overflow to infinity
+	if (absbits >= 0x477FF000)
+		return (uint16_t)(sign | 0x7C00);
+
+	// Subnormal or zero
+	if (absbits < 0x38800000) {
+		if (absbits < 0x33000000)
+			return (uint16_t)sign;
+		const uint32_t mantissa = (absbits & 0x7FFFFF) | 0x800000;
+		const uint32_t shift = 126 - (absbits >> 23);
+		uint32_t h = mantissa >> shift;
+		const uint32_t rem = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1)))
+			h++;
+		return (uint16_t)(sign | h);
+	}
+
+	// Normal - rebias the exponent from 127 to 15
+	uint32_t h = (absbits - 0x38000000) >> 13;
+	const uint32_t rem = absbits & 0x1FFF;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+		h++;
+	return (uint16_t)(sign | h);
+}
+
+//
+// Group: 10 bit Y'CbCr output
+//
+// RGBA, BGRA, R10G10B10A2, R16G16B16A16 and R32G32B32A32 pixels to
+// 10 bit limited range Y'CbCr for SDI, NDI and video encoders.
+//
+//   v210 - 4:2:2 packed, 6 pixels in 16 bytes, line pitch a multiple of 128 bytes
+//   P010 - 4:2:0 16 bit Y plane followed by an interleaved CbCr plane of half height
+//   P210 - 4:2:2 16 bit Y plane followed by an interleaved CbCr plane of full height
+//
+// P010 and P210 values are in the high 10 bits of each 16 bit word.
+// Chroma is co-sited with the left luma sample with a [1 2 1] filter
+// and for 4:2:0, vertically between the two lines. Values are clamped
+// to 4-1019 to avoid the SDI reserved codes.
+//
+
+// Luma coefficients of a Y'CbCr matrix
+static void yuv_coefficients(int matrix, float& kr, float& kb)
+{
+	switch (matrix) {
+		case SPOUT_YUV_BT601:  kr = 0.299f;  kb = 0.114f;  break;
+		case SPOUT_YUV_BT2020: kr = 0.2627f; kb = 0.0593f; break;
+		default:               kr = 0.2126f; kb = 0.0722f; break; // BT.709
+	}
+}
+
+// Round and clamp to the 10 bit range excluding SDI reserved codes
+static inline uint32_t clamp_yuv10(float v)
+{
+	const int i = (int)(v + 0.5f);
+	return (uint32_t)((i < 4) ? 4 : (i > 1019) ? 1019 : i);
+}
+
+//---------------------------------------------------------
+// Function: GetPixelBufferPitch
+// Line pitch in bytes of a pixel buffer format.
+// P010, P210 and NV12 return the pitch of the Y plane.
+unsigned int spoutCopy::GetPixelBufferPitch(int pixelFormat, unsigned int width)
+{
+	switch (pixelFormat) {
+		case SPOUT_PIXEL_RGBA:
+		case SPOUT_PIXEL_BGRA:
+			return width*4;
+		case SPOUT_PIXEL_RGB:
+		case SPOUT_PIXEL_BGR:
+			return width*3;
+		case SPOUT_PIXEL_RGBA16:
+			return width*8;
+		case SPOUT_PIXEL_V210:
+			return ((width + 47)/48)*128;
+		case SPOUT_PIXEL_P010:
+		case SPOUT_PIXEL_P210:
+			return ((width + 1) & ~1u)*2;
+		case SPOUT_PIXEL_NV12:
+			return (width + 1) & ~1u;
+		case SPOUT_PIXEL_YUY2:
+		case SPOUT_PIXEL_UYVY:
+			return ((width + 1)/2)*4;
+		default:
+			return 0;
+	}
+}
+
+//---------------------------------------------------------
+// Function: GetPixelBufferSize
+// Size in bytes of a pixel buffer format including all planes
+unsigned int spoutCopy::GetPixelBufferSize(int pixelFormat, unsigned int width, unsigned int height)
+{
+	const unsigned int pitch = GetPixelBufferPitch(pixelFormat, width);
+	if (pixelFormat == SPOUT_PIXEL_P010 || pixelFormat == SPOUT_PIXEL_NV12)
+		return pitch*(height + (height + 1)/2);
+	if (pixelFormat == SPOUT_PIXEL_P210)
+		return pitch*height*2;
+	return pitch*height;
+}
+
+//---------------------------------------------------------
+// Function: rgba2v210
+// Convert to 10 bit 4:2:2 v210
+//
+//   dwFormat  - DXGI format of the source pixels
+//   destPitch - 0 for the v210 line pitch
+//   matrix    - SPOUT_YUV_BT601, SPOUT_YUV_BT709 or SPOUT_YUV_BT2020
+//
+bool spoutCopy::rgba2v210(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, int matrix, bool bInvert) const
+{
+	return rgba2yuv10(source, dest, width, height, sourcePitch, destPitch, dwFormat, SPOUT_PIXEL_V210, matrix, bInvert);
+}
+
+//---------------------------------------------------------
+// Function: rgba2p010
+// Convert to 10 bit 4:2:0 P010
+bool spoutCopy::rgba2p010(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, int matrix, bool bInvert) const
+{
+	return rgba2yuv10(source, dest, width, height, sourcePitch, destPitch, dwFormat, SPOUT_PIXEL_P010, matrix, bInvert);
+}
+
+//---------------------------------------------------------
+// Function: rgba2p210
+// Convert to 10 bit 4:2:2 P210
+bool spoutCopy::rgba2p210(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, int matrix, bool bInvert) const
+{
+	return rgba2yuv10(source, dest, width, height, sourcePitch, destPitch, dwFormat, SPOUT_PIXEL_P210, matrix, bInvert);
+}
+
+//---------------------------------------------------------
+// Function: rgba2yuv10
+// Convert to v210, P010 or P210 selected by pixel format
+bool spoutCopy::rgba2yuv10(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, int pixelFormat,
+	int matrix, bool bInvert) const
+{
+	if (!source || !dest || width == 0 || height == 0)
+		return false;
+	if (dwFormat != DXGI_FORMAT_R8G8B8A8_UNORM && dwFormat != DXGI_FORMAT_B8G8R8A8_UNORM && !IsHighBitFormat(dwFormat))
+		return false;
+	if (pixelFormat != SPOUT_PIXEL_V210 && pixelFormat != SPOUT_PIXEL_P010 && pixelFormat != SPOUT_PIXEL_P210)
+		return false;
+
+	if (destPitch == 0)
+		destPitch = GetPixelBufferPitch(pixelFormat, width);
+	if (sourcePitch == 0)
+		sourcePitch = width*((dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : (dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) ? 8 : 4);
+
+	float kr = 0.0f, kb = 0.0f;
+	yuv_coefficients(matrix, kr, kb);
+
+	// Line buffers
+	const unsigned int w4 = (width + 3) & ~3u;
+	const unsigned int cw = (width + 1)/2;
+	std::vector<uint16_t> Y(w4);
+	std::vector<float> chroma(w4*2); // full width Cb and Cr
+	std::vector<float> cb[2] = { std::vector<float>(cw), std::vector<float>(cw) };
+	std::vector<float> cr[2] = { std::vector<float>(cw), std::vector<float>(cw) };
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	unsigned char* uvplane = dst + (uint64_t)height*destPitch;
+
+	for (unsigned int y = 0; y < height; y++) {
+
+		const unsigned char* srcline = src + (uint64_t)(bInvert ? (height - 1 - y) : y)*sourcePitch;
+		const int c = (pixelFormat == SPOUT_PIXEL_P010) ? (y & 1) : 0;
+		yuv10_line(srcline, width, dwFormat, kr, kb, Y.data(), chroma.data(), cb[c].data(), cr[c].data());
+
+		if (pixelFormat == SPOUT_PIXEL_V210) {
+			// 6 pixels in 4 words. The last group repeats the last pixel.
+			auto out = reinterpret_cast<uint32_t*>(dst + (uint64_t)y*destPitch);
+			auto Yv = [&](unsigned int i) { return (uint32_t)Y[(i < width) ? i : width - 1]; };
+			auto Cb = [&](unsigned int i) { return (uint32_t)clamp_yuv10(cb[0][(i < cw) ? i : cw - 1]); };
+			auto Cr = [&](unsigned int i) { return (uint32_t)clamp_yuv10(cr[0][(i < cw) ? i : cw - 1]); };
+			for (unsigned int x = 0; x < width; x += 6) {
+				const unsigned int i = x/2;
+				out[0] = Cb(i) | (Yv(x) << 10) | (Cr(i) << 20);
+				out[1] = Yv(x + 1) | (Cb(i + 1) << 10) | (Yv(x + 2) << 20);
+				out[2] = Cr(i + 1) | (Yv(x + 3) << 10) | (Cb(i + 2) << 20);
+				out[3] = Yv(x + 4) | (Cr(i + 2) << 10) | (Yv(x + 5) << 20);
+				out += 4;
+			}
+			continue;
+		}
+
+		// P010 and P210 Y plane
+		auto yout = reinterpret_cast<uint16_t*>(dst + (uint64_t)y*destPitch);
+		unsigned int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Y.data() + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(yout + x), _mm_slli_epi16(v, 6));
+		}
+		for (; x < width; x++)
+			yout[x] = (uint16_t)(Y[x] << 6);
+
+		// CbCr plane
+		uint16_t* uvout = nullptr;
+		if (pixelFormat == SPOUT_PIXEL_P210) {
+			uvout = reinterpret_cast<uint16_t*>(uvplane + (uint64_t)y*destPitch);
+			for (unsigned int i = 0; i < cw; i++) {
+				uvout[i*2]     = (uint16_t)(clamp_yuv10(cb[0][i]) << 6);
+				uvout[i*2 + 1] = (uint16_t)(clamp_yuv10(cr[0][i]) << 6);
+			}
+		}
+		else if ((y & 1) || y == height - 1) {
+			// Average two lines, or repeat the last line for odd height
+			uvout = reinterpret_cast<uint16_t*>(uvplane + (uint64_t)(y/2)*destPitch);
+			const int c1 = (y & 1) ? 1 : 0;
+			for (unsigned int i = 0; i < cw; i++) {
+				uvout[i*2]     = (uint16_t)(clamp_yuv10((cb[0][i] + cb[c1][i])*0.5f) << 6);
+				uvout[i*2 + 1] = (uint16_t)(clamp_yuv10((cr[0][i] + cr[c1][i])*0.5f) << 6);
+			}
+		}
+	}
+
+	return true;
+
+} // end rgba2yuv10
+
+
+//
+// 8 bit Y'CbCr to RGBA
+//
+//   NV12 - 4:2:0 Y plane followed by an interleaved CbCr plane of half height
+//   YUY2 - 4:2:2 packed Y0 Cb Y1 Cr
+//   UYVY - 4:2:2 packed Cb Y0 Cr Y1
+//
+// Limited range input. Chroma is repeated for each pair of pixels
+// and for NV12, each pair of lines. 8 pixels are converted at a time
+// with 16 bit fixed point coefficients of 6 fractional bits.
+//
+
+// Fixed point coefficients of a Y'CbCr matrix
+//   Y scale, Cr to R, Cb to G, Cr to G, Cb to B
+// The Y scale (74.52) is applied as 74 + 1/2 to stay within 16 bits.
+static void yuv8_coefficients(int matrix, int16_t coef[5])
+{
+	float kr = 0.0f, kb = 0.0f;
+	yuv_coefficients(matrix, kr, kb);
+	const float kg = 1.0f - kr - kb;
+	const float cs = 255.0f/224.0f;
+	coef[0] = (int16_t)(64.0f*255.0f/219.0f);
+	coef[1] = (int16_t)(64.0f*cs*2.0f*(1.0f - kr) + 0.5f);
+	coef[2] = (int16_t)(64.0f*cs*2.0f*(1.0f - kb)*kb/kg + 0.5f);
+	coef[3] = (int16_t)(64.0f*cs*2.0f*(1.0f - kr)*kr/kg + 0.5f);
+	coef[4] = (int16_t)(64.0f*cs*2.0f*(1.0f - kb) + 0.5f);
+}
+
+// Scalar conversion of one pixel with the same arithmetic as SSE2
+static inline uint32_t yuv8_pixel(int Y, int Cb, int Cr, const int16_t* coef, bool bSwapRB)
+{
+	auto clamp8 = [](int v) { v = (v + 32) >> 6; return (uint32_t)((v < 0) ? 0 : (v > 255) ? 255 : v); };
+	const int y = (Y - 16)*coef[0] + ((Y - 16) >> 1);
+	Cb -= 128;
+	Cr -= 128;
+	const uint32_t r = clamp8(y + Cr*coef[1]);
+	const uint32_t g = clamp8(y - Cb*coef[2] - Cr*coef[3]);
+	const uint32_t b = clamp8(y + Cb*coef[4]);
+	return bSwapRB ? (b | (g << 8) | (r << 16) | 0xFF000000)
+	               : (r | (g << 8) | (b << 16) | 0xFF000000);
+}
+
+//---------------------------------------------------------
+// Function: yuv2rgba
+// Convert 8 bit NV12, YUY2 or UYVY to RGBA or BGRA
+//
+//   sourcePitch - 0 for the pitch of the pixel format (see GetPixelBufferPitch)
+//   destPitch   - 0 for width*4
+//   pixelFormat - SPOUT_PIXEL_NV12, SPOUT_PIXEL_YUY2 or SPOUT_PIXEL_UYVY
+//   matrix      - SPOUT_YUV_BT601, SPOUT_YUV_BT709 or SPOUT_YUV_BT2020
+//   bSwapRB     - BGRA output
+//
+bool spoutCopy::yuv2rgba(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, int pixelFormat,
+	int matrix, bool bSwapRB, bool bInvert) const
+{
+	if (!source || !dest || width == 0 || height == 0)
+		return false;
+	if (pixelFormat != SPOUT_PIXEL_NV12 && pixelFormat != SPOUT_PIXEL_YUY2 && pixelFormat != SPOUT_PIXEL_UYVY)
+		return false;
+
+	if (sourcePitch == 0)
+		sourcePitch = GetPixelBufferPitch(pixelFormat, width);
+	if (destPitch == 0)
+		destPitch = width*4;
+
+	int16_t coef[5]{};
+	yuv8_coefficients(matrix, coef);
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	const unsigned char* uvplane = src + (uint64_t)height*sourcePitch;
+
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* yline = src + (uint64_t)y*sourcePitch;
+		const unsigned char* cline = (pixelFormat == SPOUT_PIXEL_NV12) ? uvplane + (uint64_t)(y/2)*sourcePitch : yline;
+		auto out = reinterpret_cast<uint32_t*>(dst + (uint64_t)(bInvert ? (height - 1 - y) : y)*destPitch);
+		yuv8_line(yline, cline, out, width, pixelFormat, coef, bSwapRB);
+	}
+
+	return true;
+
+} // end yuv2rgba
+
+
+//
+// Alpha
+//
+// premultiply   - colour*alpha/255 rounded
+// unpremultiply - colour*255/alpha using a reciprocal table, within one level.
+//                 Colour greater than alpha is clamped. Zero alpha gives zero colour.
+// over          - premultiplied : src + dst*(255 - src alpha)/255
+//                 straight      : (src*src alpha + dst*(255 - src alpha))/255
+//                 Alpha is src alpha + dst alpha*(255 - src alpha)/255
+//                 The result is premultiplied if the background is.
+//
+
+// Loop over lines allowing for pitch and invert
+template <typename F>
+static bool alpha_lines(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bInvert, F line)
+{
+	if (!source || !dest || width == 0 || height == 0)
+		return false;
+	if (sourcePitch == 0) sourcePitch = width*4;
+	if (destPitch == 0) destPitch = width*4;
+	auto src = static_cast<const unsigned char*>(source);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* s = src + (uint64_t)(bInvert ? (height - 1 - y) : y)*sourcePitch;
+		line(reinterpret_cast<const uint32_t*>(s), reinterpret_cast<uint32_t*>(dst + (uint64_t)y*destPitch));
+	}
+	return true;
+}
+
+// Reciprocal of alpha for unpremultiply : 255*256/alpha rounded
+static const uint16_t* alpha_reciprocal()
+{
+	static const struct table {
+		uint16_t r[256];
+		table() {
+			r[0] = 0;
+			for (unsigned int a = 1; a < 256; a++)
+				r[a] = (uint16_t)((65280 + a/2)/a);
+		}
+	} lut;
+	return lut.r;
+}
+
+// Divide by 255 rounded, for 16 bit words
+static inline __m128i div255_epu16(__m128i t)
+{
+	t = _mm_add_epi16(t, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline uint32_t div255(uint32_t t)
+{
+	t += 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+// Swap red and blue of two 16 bit per channel pixels
+static inline __m128i swaprb_epi16(__m128i p)
+{
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+// Alpha of two 16 bit per channel pixels in all channels
+static inline __m128i alpha_epi16(__m128i p)
+{
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline uint32_t swaprb(uint32_t p)
+{
+	return (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+}
+
+//---------------------------------------------------------
+// Function: premultiply
+// Multiply colour by alpha
+void spoutCopy::premultiply(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bSwapRB, bool bInvert) const
+{
+	alpha_lines(source, dest, width, height, sourcePitch, destPitch, bInvert,
+		[&](const uint32_t* s, uint32_t* d) { premultiply_line(s, d, width, bSwapRB); });
+}
+
+//---------------------------------------------------------
+// Function: unpremultiply
+// Divide colour by alpha
+void spoutCopy::unpremultiply(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bSwapRB, bool bInvert) const
+{
+	alpha_lines(source, dest, width, height, sourcePitch, destPitch, bInvert,
+		[&](const uint32_t* s, uint32_t* d) { unpremultiply_line(s, d, width, bSwapRB); });
+}
+
+//---------------------------------------------------------
+// Function: over
+// Composite source pixels over the background in dest
+//
+//   bPremultiplied - source colour is premultiplied by alpha
+//   bSwapRB        - source is RGBA and dest BGRA or the reverse
+//   bInvert        - flip the source
+//
+void spoutCopy::over(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, bool bPremultiplied, bool bSwapRB, bool bInvert) const
+{
+	alpha_lines(source, dest, width, height, sourcePitch, destPitch, bInvert,
+		[&](const uint32_t* s, uint32_t* d) { over_line(s, d, width, bPremultiplied, bSwapRB); });
+}
+
+//
+// Group: Rotation
+//
+// Clockwise rotation by 0, 90, 180 or 270 degrees.
+// For 90 and 270 degrees, 4x4 blocks of pixels are transposed within
+// tiles of 32x32 pixels so that the source and destination lines of
+// a tile remain in the cache. 24 bit pixels are expanded to 32 bits
+// for the transpose if SSSE3 is available.
+//
+
+// Tile size in pixels
+static const unsigned int rotate_tile_size = 32;
+
+// Swap red and blue of four 32 bit pixels
+static inline __m128i swaprb_epi32(__m128i p)
+{
+	const __m128i low = _mm_set1_epi32(0xFF);
+	return _mm_or_si128(_mm_and_si128(p, _mm_set1_epi32((int)0xFF00FF00)),
+		_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_slli_epi32(_mm_and_si128(p, low), 16)));
+}
+
+// Transpose four lines of four 32 bit pixels to four columns
+static inline void transpose_epi32(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+{
+	const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+	r0 = _mm_unpacklo_epi64(t0, t1);
+	r1 = _mm_unpackhi_epi64(t0, t1);
+	r2 = _mm_unpacklo_epi64(t2, t3);
+	r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Load and store four 24 bit pixels without reading or writing beyond them
+static inline __m128i load_rgb4(const unsigned char* p)
+{
+	int32_t last = 0;
+	memcpy(&last, p + 8, 4);
+	return _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_cvtsi32_si128(last));
+}
+
+static inline void store_rgb4(unsigned char* p, __m128i v)
+{
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(p), v);
+	const int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+	memcpy(p + 8, &last, 4);
+}
+
+//---------------------------------------------------------
+// Function: rgba2rgbaRotate
+// Rotate 32 bit rgba pixels clockwise
+//
+//   rotation  - 0, 90, 180 or 270 degrees. Negative values rotate anti-clockwise.
+//   destPitch - 0 for the destination width, which is "height" for 90 and 270
+//   bSwapRB   - convert RGBA <> BGRA
+//   bInvert   - flip the source before rotation
+//
+// Returns false if the rotation is not a multiple of 90 degrees.
+//
+bool spoutCopy::rgba2rgbaRotate(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, int rotation, bool bSwapRB, bool bInvert) const
+{
+	return rotate_image(source, dest, width, height, sourcePitch, destPitch, rotation, 4, bSwapRB, bInvert);
+}
+
+//---------------------------------------------------------
+// Function: rgb2rgbRotate
+// Rotate 24 bit rgb pixels clockwise
+//
+//   Arguments as for rgba2rgbaRotate. bSwapRB converts RGB <> BGR.
+//
+bool spoutCopy::rgb2rgbRotate(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, int rotation, bool bSwapRB, bool bInvert) const
+{
+	return rotate_image(source, dest, width, height, sourcePitch, destPitch, rotation, 3, bSwapRB, bInvert);
+}
+
+//
+// Group: Regions
+//
+
+//---------------------------------------------------------
+// Function: region2rgba
+// Convert a region of a pitched image to 8 bit pixels
+//
+//   x, y          - region position in the source image
+//   width, height - region size
+//   sourcePitch   - line pitch of the whole source image
+//   destPitch     - 0 for width * bytes per pixel
+//   dwFormat      - DXGI_FORMAT_R8G8B8A8_UNORM, B8G8R8A8_UNORM,
+//                   or a high bit depth format (see IsHighBitFormat)
+//   glFormat      - GL_RGBA, GL_BGRA_EXT, GL_RGB or GL_BGR_EXT
+//
+// Only the lines and pixels of the region are read, so the cost depends on
+// the region size rather than the source image size.
+//
+bool spoutCopy::region2rgba(const void* source, void* dest, unsigned int x, unsigned int y,
+	unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int destPitch,
+	DWORD dwFormat, GLenum glFormat, bool bInvert) const
+{
+	if (!source || !dest || width == 0 || height == 0 || sourcePitch == 0)
+		return false;
+
+	// Bytes per source pixel
+	unsigned int bytes = 4;
+	if (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) bytes = 16;
+	else if (dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) bytes = 8;
+	auto src = static_cast<const unsigned char*>(source) + (uint64_t)y*sourcePitch + (uint64_t)x*bytes;
+
+	if (IsHighBitFormat(dwFormat))
+		return highbit2rgba(src, dest, width, height, sourcePitch, destPitch, dwFormat, glFormat, bInvert);
+
+	const bool bRGB = (glFormat == GL_RGB || glFormat == GL_BGR_EXT);
+	if (!bRGB && glFormat != GL_RGBA && glFormat != GL_BGRA_EXT)
+		return false;
+
+	// Swap if the source and destination order of red and blue differ
+	const bool bSourceBGRA = (dwFormat == DXGI_FORMAT_B8G8R8A8_UNORM || dwFormat == DXGI_FORMAT_B8G8R8X8_UNORM);
+	const bool bDestBGR = (glFormat == GL_BGRA_EXT || glFormat == GL_BGR_EXT);
+	const bool bSwapRB = (bSourceBGRA != bDestBGR);
+	if (destPitch == 0)
+		destPitch = width*(bRGB ? 3 : 4);
+
+	// A region is not 16 byte aligned, so lines are converted
+	// here with unaligned loads and stores
+	const __m128i pack = bSwapRB
+		? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+		: _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	auto dst = static_cast<unsigned char*>(dest);
+	for (unsigned int i = 0; i < height; i++) {
+		const unsigned char* s = src + (uint64_t)(bInvert ? (height - 1 - i) : i)*sourcePitch;
+		unsigned char* d = dst + (uint64_t)i*destPitch;
+		if (!bRGB && !bSwapRB) {
+			memcpy(d, s, (size_t)width*4);
+			continue;
+		}
+		unsigned int n = 0;
+		if (!bRGB && m_bSSE2) {
+			for (; n + 4 <= width; n += 4) {
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + n*4));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d + n*4), swaprb_epi32(v));
+			}
+		}
+		else if (bRGB && m_bSSSE3) {
+			for (; n + 4 <= width; n += 4) {
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + n*4));
+				store_rgb4(d + n*3, _mm_shuffle_epi8(v, pack));
+			}
+		}
+		for (; n < width; n++) {
+			const unsigned char* p = s + n*4;
+			unsigned char* q = d + n*(bRGB ? 3 : 4);
+			q[0] = p[bSwapRB ? 2 : 0];
+			q[1] = p[1];
+			q[2] = p[bSwapRB ? 0 : 2];
+			if (!bRGB) q[3] = p[3];
+		}
+	}
+	return true;
+}
+
+//
+// Group: Frame hash
+//
+// A 64 bit hash in the style of XXH3 for detecting frames that are
+// the same as the last. Each 64 byte stripe of a line is mixed with
+// a secret into eight 64 bit accumulators using 32x32 bit multiplies
+// that SSE2 provides. The accumulators are scrambled after every
+// 1024 bytes and at the end of each line so that the order of
+// stripes and lines changes the result.
+// The result is the same with or without SSE2, but not the same as XXH3.
+//
+
+static const uint64_t hash_prime32 = 0x9E3779B1ULL;
+static const uint64_t hash_prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t hash_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned int hash_stripes = 16; // Stripes between scrambles
+
+// Secret of 192 bytes, read at an 8 byte offset for each stripe
+static const unsigned char* hash_secret()
+{
+	static const struct table {
+		uint64_t s[24];
+		table() {
+			// splitmix64
+			uint64_t x = hash_prime64_1;
+			for (unsigned int i = 0; i < 24; i++) {
+				uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+				z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+				s[i] = z ^ (z >> 31);
+			}
+		}
+	} secret;
+	return reinterpret_cast<const unsigned char*>(secret.s);
+}
+
+// Final avalanche
+static inline uint64_t hash_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= hash_prime64_2;
+	h ^= h >> 29;
+	h *= hash_prime64_1;
+	h ^= h >> 32;
+	return h;
+}
+
+// Accumulate one 64 byte stripe
+static inline void hash_stripe(uint64_t* acc, const unsigned char* p, const unsigned char* key)
+{
+	for (int i = 0; i < 8; i++) {
+		uint64_t data = 0;
+		uint64_t k = 0;
+		memcpy(&data, p + i*8, 8);
+		memcpy(&k, key + i*8, 8);
+		k ^= data;
+		acc[i ^ 1] += data;
+		acc[i] += (k & 0xFFFFFFFF)*(k >> 32);
+	}
+}
+
+static inline __m128i hash_stripe_sse2(__m128i acc, const unsigned char* p, const unsigned char* key)
+{
+	const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	const __m128i dk = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)));
+	const __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+	return _mm_add_epi64(_mm_add_epi64(acc, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))), product);
+}
+
+// Scramble the accumulators
+static inline void hash_scramble(uint64_t* acc, const unsigned char* key)
+{
+	for (int i = 0; i < 8; i++) {
+		uint64_t k = 0;
+		memcpy(&k, key + i*8, 8);
+		acc[i] ^= acc[i] >> 47;
+		acc[i] ^= k;
+		acc[i] *= hash_prime32;
+	}
+}
+
+static inline __m128i hash_scramble_sse2(__m128i acc, const unsigned char* key)
+{
+	const __m128i prime = _mm_set1_epi32((int)hash_prime32);
+	acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+	acc = _mm_xor_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)));
+	const __m128i lo = _mm_mul_epu32(acc, prime);
+	const __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(acc, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+	return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+}
+
+// Accumulate one line, scrambling after every block of stripes and at the end.
+// The last partial stripe is padded with zeros.
+static void hash_line(uint64_t* acc, const unsigned char* line, unsigned int lineBytes,
+	const unsigned char* secret, bool bSSE2)
+{
+	const unsigned int stripes = lineBytes/64;
+	const unsigned int tail = lineBytes%64;
+	alignas(16) unsigned char last[64] = {};
+	if (tail > 0)
+		memcpy(last, line + stripes*64, tail);
+
+	if (bSSE2) {
+		__m128i* xacc = reinterpret_cast<__m128i*>(acc);
+		__m128i a0 = _mm_load_si128(xacc);
+		__m128i a1 = _mm_load_si128(xacc + 1);
+		__m128i a2 = _mm_load_si128(xacc + 2);
+		__m128i a3 = _mm_load_si128(xacc + 3);
+		for (unsigned int n = 0; n <= stripes; n++) {
+			if (n == stripes && tail == 0)
+				break;
+			const unsigned char* p = (n < stripes) ? line + n*64 : last;
+			const unsigned char* key = secret + (n%hash_stripes)*8;
+			a0 = hash_stripe_sse2(a0, p, key);
+			a1 = hash_stripe_sse2(a1, p + 16, key + 16);
+			a2 = hash_stripe_sse2(a2, p + 32, key + 32);
+			a3 = hash_stripe_sse2(a3, p + 48, key + 48);
+			if (n%hash_stripes == hash_stripes - 1 && n < stripes) {
+				a0 = hash_scramble_sse2(a0, secret + 128);
+				a1 = hash_scramble_sse2(a1, secret + 144);
+				a2 = hash_scramble_sse2(a2, secret + 160);
+				a3 = hash_scramble_sse2(a3, secret + 176);
+			}
+		}
+		_mm_store_si128(xacc,     hash_scramble_sse2(a0, secret + 120));
+		_mm_store_si128(xacc + 1, hash_scramble_sse2(a1, secret + 136));
+		_mm_store_si128(xacc + 2, hash_scramble_sse2(a2, secret + 152));
+		_mm_store_si128(xacc + 3, hash_scramble_sse2(a3, secret + 168));
+		return;
+	}
+
+	for (unsigned int n = 0; n < stripes; n++) {
+		hash_stripe(acc, line + n*64, secret + (n%hash_stripes)*8);
+		if (n%hash_stripes == hash_stripes - 1)
+			hash_scramble(acc, secret + 128);
+	}
+	if (tail > 0)
+		hash_stripe(acc, last, secret + (stripes%hash_stripes)*8);
+	hash_scramble(acc, secret + 120);
+}
+
+//---------------------------------------------------------
+// Function: FrameHash
+// 64 bit hash of image lines
+//
+//   lineBytes - bytes of each line to hash, e.g. width*4
+//   pitch     - source line pitch, 0 for lineBytes
+//   step      - hash every "step" lines. 1 for the full image.
+//
+// The line padding is not included, so the same pixels with
+// a different pitch give the same result.
+//
+uint64_t spoutCopy::FrameHash(const void* source, unsigned int lineBytes, unsigned int height,
+	unsigned int pitch, unsigned int step) const
+{
+	if (!source || lineBytes == 0 || height == 0)
+		return 0;
+	if (pitch == 0) pitch = lineBytes;
+	if (step == 0) step = 1;
+
+	const unsigned char* secret = hash_secret();
+	alignas(16) uint64_t acc[8] = {
+		hash_prime32, hash_prime64_1, hash_prime64_2, hash_prime64_1 ^ hash_prime64_2,
+		hash_prime64_2 ^ hash_prime32, hash_prime64_1*hash_prime32, hash_prime64_2*hash_prime32, hash_prime64_1 + 1 };
+
+	auto src = static_cast<const unsigned char*>(source);
+	for (unsigned int y = 0; y < height; y += step)
+		hash_line(acc, src + (uint64_t)y*pitch, lineBytes, secret, m_bSSE2);
+
+	// Merge the accumulators with the size
+	uint64_t h = ((uint64_t)lineBytes*height)*hash_prime64_1;
+	for (int i = 0; i < 8; i++) {
+		h ^= hash_mix(acc[i]);
+		h = ((h << 27) | (h >> 37))*hash_prime64_1 + hash_prime64_2;
+	}
+	return hash_mix(h);
+}
+
+// Sum of absolute byte differences, copying source to previous if bUpdate
+static inline uint32_t sad_bytes(const unsigned char* source, unsigned char* previous,
+	unsigned int count, bool bUpdate, bool bSSE2)
+{
+	uint32_t sum = 0;
+	unsigned int i = 0;
+	if (bSSE2) {
+		__m128i acc = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16) {
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(a, b));
+			if (bUpdate)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(previous + i), a);
+		}
+		sum = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+	}
+	for (; i < count; i++) {
+		sum += (source[i] > previous[i]) ? source[i] - previous[i] : previous[i] - source[i];
+		if (bUpdate)
+			previous[i] = source[i];
+	}
+	return sum;
+}
+
+//---------------------------------------------------------
+// Function: CompareTiles
+// Compare an image with the previous frame in tiles
+//
+//   previous      - previous frame, width*bytesPerPixel line pitch
+//   sourcePitch   - 0 for width*bytesPerPixel
+//   tileSize      - tile width and height in pixels. Tiles at the right
+//                   and bottom edges can be smaller.
+//   changed       - (columns*rows + 7)/8 bytes. Bit (i%8) of byte i/8 is
+//                   set if tile i has changed. Tiles are numbered by rows.
+//   sad           - columns*rows sums of absolute differences of all bytes
+//                   in each tile, or null
+//   bUpdate       - copy the source to "previous" for the next frame
+//
+// The comparison and update are a single pass of SSE2 _mm_sad_epu8.
+// A tile is changed if any byte is different.
+// Returns the number of changed tiles.
+//
+unsigned int spoutCopy::CompareTiles(const void* source, void* previous, unsigned int width, unsigned int height,
+	unsigned int bytesPerPixel, unsigned int sourcePitch, unsigned int tileSize,
+	unsigned char* changed, uint32_t* sad, bool bUpdate) const
+{
+	if (!source || !previous || !changed || width == 0 || height == 0
+		|| bytesPerPixel == 0 || tileSize == 0)
+		return 0;
+
+	const unsigned int lineBytes = width*bytesPerPixel;
+	const unsigned int tileBytes = tileSize*bytesPerPixel;
+	if (sourcePitch == 0) sourcePitch = lineBytes;
+	const unsigned int columns = (width + tileSize - 1)/tileSize;
+	const unsigned int rows = (height + tileSize - 1)/tileSize;
+
+	std::vector<uint32_t> sums;
+	if (!sad) {
+		sums.resize(columns);
+		sad = sums.data();
+	}
+	memset(changed, 0, ((size_t)columns*rows + 7)/8);
+
+	auto src = static_cast<const unsigned char*>(source);
+	auto prev = static_cast<unsigned char*>(previous);
+	unsigned int count = 0;
+	for (unsigned int r = 0; r < rows; r++) {
+		// Sums for this row of tiles
+		uint32_t* tsad = sums.empty() ? sad + (size_t)r*columns : sad;
+		memset(tsad, 0, columns*sizeof(uint32_t));
+		const unsigned int y1 = (height - r*tileSize > tileSize) ? (r + 1)*tileSize : height;
+		for (unsigned int y = r*tileSize; y < y1; y++) {
+			const unsigned char* s = src + (uint64_t)y*sourcePitch;
+			unsigned char* p = prev + (uint64_t)y*lineBytes;
+			for (unsigned int c = 0; c < columns; c++) {
+				const unsigned int x0 = c*tileBytes;
+				const unsigned int n = (lineBytes - x0 > tileBytes) ? tileBytes : lineBytes - x0;
+				tsad[c] += sad_bytes(s + x0, p + x0, n, bUpdate, m_bSSE2);
+			}
+		}
+		for (unsigned int c = 0; c < columns; c++) {
+			if (tsad[c] > 0) {
+				const size_t i = (size_t)r*columns + c;
+				changed[i >> 3] |= (unsigned char)(1 << (i & 7));
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+
+
+//---------------------------------------------------------
+// Function: GetSSE
+// Return SSE2, SSE3 and SSSE3 capability
+//
+void spoutCopy::GetSSE(bool &bSSE2, bool &bSSE3, bool &bSSSE3)
+{
+	bSSE2  = m_bSSE2;
+	bSSE3  = m_bSSE3;
+	bSSSE3 = m_bSSSE3;
+}
+
+//---------------------------------------------------------
+// Function: GetSSE2
+//     Return SSE3 capability
+bool spoutCopy::GetSSE2()
+{
+	return m_bSSE2;
+}
+
+//---------------------------------------------------------
+// Function: GetSSE3
+//     Return sSSE3 capability
+bool spoutCopy::GetSSE3()
+{
+	return m_bSSE3;
+}
+
+//---------------------------------------------------------
+// Function: GetSSSE3
+//     Return SSSE3 capability
+bool spoutCopy::GetSSSE3()
+{
+	return m_bSSSE3;
+}
+
+//---------------------------------------------------------
+// Function: GetF16C
+//     Return F16C half float conversion capability
+bool spoutCopy::GetF16C()
+{
+	return m_bF16C;
+}
+
+
+//
+// Protected
+//
+
+//
+//					CheckSSE()
+//
+// https://msdn.microsoft.com/en-us/library/hskdteyh.aspx
+//
+// static bool SSE2 (void) { return CPU_Rep.f_1_EDX_[26]; }
+// SSE2 | [bit 26] EDX
+// SSE2 = (cpuid03 & (0x1 << 26))
+//
+// static bool SSE3 (void) { return CPU_Rep.f_1_ECX_[0]; }
+// SSE3 | [bit 0] ECX
+// SSE3 = (cpuid02 & (0x1)
+//
+// static bool SSSE3(void) { return CPU_Rep.f_1_ECX_[9]; }
+// SSSE3 | [bit 9] ECX
+// SSSE3 = (cpuid02 & (0x1 << 9)
+//
+// SSE4 not currently used :
+//
+// SSE4.1 and SSE4.2 are extensions of SSE, SSE2, SSE3, and SSSE3. 
+// To check if the processor supports SSE4.1, execute CPUID with EAX = 1 as input.
+// If bit 19 of ECX is set, then the processor supports SSE4.1.
 // To check if the processor supports SSE4.2 instructions for string / text processing,
 // PCMPGTQ, and CRC32, execute CPUID with EAX = 1 as input.
 // If bit 20 of ECX is set, then the processor supports these SSE4.2 in structions.
@@ -1550,6 +3447,9 @@ bool spoutCopy::GetSSSE3()
 // SSE42 | [bit 20] ECX
 // SSE42 = (cpuid02 & (0x1 << 20))
 //
+// F16C | [bit 29] ECX
+// F16C = (cpuid02 & (0x1 << 29))
+//
 // EAX - CPUInfo[0]
 // EBX - CPUInfo[1]
 // ECX - CPUInfo[2]
@@ -1584,6 +3484,10 @@ void spoutCopy::CheckSSE()
 		// SSSE3 | [bit 9] ECX
 		// SSSE3 = (cpuid02 & (0x1 << 9)
 		m_bSSSE3 = ((CPUInfo[2] & (0x1 << 9)) || false);
+#ifdef SPOUT_F16C
+		// F16C | [bit 29] ECX
+		m_bF16C = ((CPUInfo[2] & (0x1 << 29)) || false);
+#endif
 	}
 	#endif
 }
@@ -1799,3 +3703,1095 @@ void spoutCopy::rgba_swap_ssse3(void* __restrict rgba_source, unsigned int width
     }
 
 } // end rgba_swap_ssse3
+
+//
+// High bit depth line conversion
+//
+
+// Half float to float for processors without F16C
+float spoutCopy::half_to_float(uint16_t h)
+{
+	const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1F;
+	uint32_t mantissa = h & 0x3FF;
+	uint32_t bits = 0;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign; // zero
+		}
+		else {
+			// Subnormal - normalize
+			exponent = 113;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	}
+	else if (exponent == 31) {
+		bits = sign | 0x7F800000 | (mantissa << 13); // Inf or NaN
+	}
+	else {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	float f = 0.0f;
+	memcpy(&f, &bits, 4);
+	return f;
+}
+
+// Load one pixel of a float or half float format as four floats
+static inline __m128 load_float_pixel(const unsigned char* src, DWORD dwFormat, bool bF16C)
+{
+	if (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT)
+		return _mm_loadu_ps(reinterpret_cast<const float*>(src));
+#ifdef SPOUT_F16C
+	if (bF16C)
+		return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+#else
+	UNREFERENCED_PARAMETER(bF16C);
+#endif
+	auto h = reinterpret_cast<const uint16_t*>(src);
+	return _mm_setr_ps(spoutCopy::half_to_float(h[0]), spoutCopy::half_to_float(h[1]),
+		spoutCopy::half_to_float(h[2]), spoutCopy::half_to_float(h[3]));
+}
+
+// Convert one line to 8 bit rgba or bgra
+void spoutCopy::highbit_line_to_rgba8(const unsigned char* src, uint32_t* dst,
+	unsigned int width, DWORD dwFormat, bool bSwapRB) const
+{
+	unsigned int x = 0;
+
+	if (dwFormat == DXGI_FORMAT_R10G10B10A2_UNORM) {
+		// R10G10B10A2 - keep the 8 most significant bits
+		auto s = reinterpret_cast<const uint32_t*>(src);
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		for (; x + 4 <= width; x += 4) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x));
+			__m128i r = _mm_and_si128(_mm_srli_epi32(v, 2), mask);
+			const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 12), mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(v, 22), mask);
+			__m128i a = _mm_srli_epi32(v, 30); // 2 bits replicated to 8
+			a = _mm_or_si128(_mm_or_si128(a, _mm_slli_epi32(a, 2)), _mm_or_si128(_mm_slli_epi32(a, 4), _mm_slli_epi32(a, 6)));
+			if (bSwapRB)
+				std::swap(r, b);
+			const __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+				_mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), rgba);
+		}
+		for (; x < width; x++) {
+			const uint32_t p = s[x];
+			uint32_t r = (p >> 2) & 0xFF;
+			const uint32_t g = (p >> 12) & 0xFF;
+			uint32_t b = (p >> 22) & 0xFF;
+			const uint32_t a = (p >> 30) * 0x55;
+			if (bSwapRB)
+				std::swap(r, b);
+			dst[x] = r | (g << 8) | (b << 16) | (a << 24);
+		}
+	}
+	else if (dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) {
+		// R16G16B16A16 unorm - keep the high byte
+		auto s = reinterpret_cast<const uint16_t*>(src);
+		for (; x + 4 <= width; x += 4) {
+			__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x*4));
+			__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x*4 + 8));
+			if (bSwapRB) {
+				v0 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v0, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+				v1 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v1, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+			}
+			const __m128i rgba = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), rgba);
+		}
+		for (; x < width; x++) {
+			const uint16_t* p = s + x*4;
+			uint32_t r = p[0] >> 8;
+			uint32_t b = p[2] >> 8;
+			if (bSwapRB)
+				std::swap(r, b);
+			dst[x] = r | ((uint32_t)(p[1] >> 8) << 8) | (b << 16) | ((uint32_t)(p[3] >> 8) << 24);
+		}
+	}
+	else {
+		// R32G32B32A32 float or R16G16B16A16 half float
+		const unsigned int bpp = (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : 8;
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+		__m128 p[4];
+		for (; x < width; x += 4) {
+			const unsigned int count = (width - x < 4) ? (width - x) : 4;
+			for (unsigned int i = 0; i < 4; i++) {
+				if (i < count) {
+					// max returns zero for NaN
+					p[i] = load_float_pixel(src + (uint64_t)(x + i)*bpp, dwFormat, m_bF16C);
+					p[i] = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p[i], zero), one), scale);
+					if (bSwapRB)
+						p[i] = _mm_shuffle_ps(p[i], p[i], _MM_SHUFFLE(3, 0, 1, 2));
+				}
+				else {
+					p[i] = zero;
+				}
+			}
+			const __m128i rg = _mm_packs_epi32(_mm_cvtps_epi32(p[0]), _mm_cvtps_epi32(p[1]));
+			const __m128i ba = _mm_packs_epi32(_mm_cvtps_epi32(p[2]), _mm_cvtps_epi32(p[3]));
+			const __m128i rgba = _mm_packus_epi16(rg, ba);
+			if (count == 4) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), rgba);
+			}
+			else {
+				uint32_t last[4]{};
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(last), rgba);
+				memcpy(dst + x, last, (size_t)count*4);
+			}
+		}
+	}
+}
+
+// Convert one line to 16 bit rgba
+void spoutCopy::highbit_line_to_rgba16(const unsigned char* src, uint16_t* dst,
+	unsigned int width, DWORD dwFormat) const
+{
+	if (dwFormat == DXGI_FORMAT_R10G10B10A2_UNORM) {
+		// Replicate the high bits of 10 bit values into the low bits
+		auto s = reinterpret_cast<const uint32_t*>(src);
+		for (unsigned int x = 0; x < width; x++) {
+			const uint32_t p = s[x];
+			const uint32_t r = p & 0x3FF;
+			const uint32_t g = (p >> 10) & 0x3FF;
+			const uint32_t b = (p >> 20) & 0x3FF;
+			dst[0] = (uint16_t)((r << 6) | (r >> 4));
+			dst[1] = (uint16_t)((g << 6) | (g >> 4));
+			dst[2] = (uint16_t)((b << 6) | (b >> 4));
+			dst[3] = (uint16_t)((p >> 30) * 0x5555);
+			dst += 4;
+		}
+		return;
+	}
+
+	// Float formats
+	// Scale to 0-65535, then offset to the signed range for the SSE2 pack
+	const unsigned int bpp = (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : 8;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(65535.0f);
+	const __m128i offset = _mm_set1_epi32(32768);
+	const __m128i sign = _mm_set1_epi16((short)0x8000);
+	unsigned int x = 0;
+	for (; x + 2 <= width; x += 2) {
+		__m128 p0 = load_float_pixel(src + (uint64_t)x*bpp, dwFormat, m_bF16C);
+		__m128 p1 = load_float_pixel(src + (uint64_t)(x + 1)*bpp, dwFormat, m_bF16C);
+		p0 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p0, zero), one), scale);
+		p1 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p1, zero), one), scale);
+		const __m128i i0 = _mm_sub_epi32(_mm_cvtps_epi32(p0), offset);
+		const __m128i i1 = _mm_sub_epi32(_mm_cvtps_epi32(p1), offset);
+		const __m128i rgba = _mm_xor_si128(_mm_packs_epi32(i0, i1), sign);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x*4), rgba);
+	}
+	if (x < width) {
+		__m128 p0 = load_float_pixel(src + (uint64_t)x*bpp, dwFormat, m_bF16C);
+		p0 = _mm_mul_ps(_mm_min_ps(_mm_max_ps(p0, zero), one), scale);
+		const __m128i i0 = _mm_sub_epi32(_mm_cvtps_epi32(p0), offset);
+		const __m128i rgba = _mm_xor_si128(_mm_packs_epi32(i0, i0), sign);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x*4), rgba);
+	}
+}
+
+// Build tone mapping lookup tables if the parameters have changed
+void spoutCopy::CheckToneMapLUT(int op, float exposure, float peak, float white, bool bHalf)
+{
+	if (!m_pToneMap)
+		m_pToneMap = new spoutToneMapLUT;
+
+	spoutToneMapLUT* lut = m_pToneMap;
+	const bool bChanged = (lut->op != op || lut->exposure != exposure
+		|| lut->peak != peak || lut->white != white);
+
+	if (bChanged) {
+		lut->op = op;
+		lut->exposure = exposure;
+		lut->peak = peak;
+		lut->white = white;
+		lut->bHalf = false;
+		// Tone curve indexed by u = L/(1+L)
+		for (int i = 0; i < 8192; i++) {
+			const float u = ((float)i + 0.5f)/8192.0f;
+			const float L = u/(1.0f - u);
+			lut->curve[i] = (unsigned char)(tone_curve(L, op, peak, white)*255.0f + 0.5f);
+		}
+		// PQ code to linear relative to reference white
+		for (int i = 0; i < 4096; i++)
+			lut->pq[i] = pq_to_nits((float)i/4095.0f)/white;
+	}
+
+	if (bHalf && !lut->bHalf) {
+		for (int i = 0; i < 65536; i++) {
+			float L = half_to_float((uint16_t)i)*exposure;
+			if (!(L > 0.0f)) L = 0.0f; // negative and NaN
+			if (L > 65504.0f) L = 65504.0f; // infinity
+			lut->half[i] = (unsigned char)(tone_curve(L, op, peak, white)*255.0f + 0.5f);
+		}
+		lut->bHalf = true;
+	}
+}
+
+//
+// Tensor conversion
+//
+
+// Load an 8 bit rgba pixel as four floats
+static inline __m128 load_rgba8_ps(const unsigned char* p)
+{
+	int v = 0;
+	memcpy(&v, p, 4);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i px = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+	return _mm_cvtepi32_ps(px);
+}
+
+// Store four tensor values as float or half float
+static inline void store_tensor4(void* dst, __m128 v, bool bFloat16, bool bF16C)
+{
+	if (!bFloat16) {
+		_mm_storeu_ps(static_cast<float*>(dst), v);
+		return;
+	}
+#ifdef SPOUT_F16C
+	if (bF16C) {
+		_mm_storel_epi64(static_cast<__m128i*>(dst), _mm_cvtps_ph(v, 0));
+		return;
+	}
+#else
+	UNREFERENCED_PARAMETER(bF16C);
+#endif
+	float f[4]{};
+	_mm_storeu_ps(f, v);
+	auto h = static_cast<uint16_t*>(dst);
+	for (int i = 0; i < 4; i++)
+		h[i] = spoutCopy::float_to_half(f[i]);
+}
+
+// Fill tensor elements "from" to "to" of a line with a value
+static void fill_tensor(unsigned char* dst, unsigned int from, unsigned int to,
+	float value, bool bFloat16, bool bF16C)
+{
+	const unsigned int elemSize = bFloat16 ? 2 : 4;
+	const __m128 v = _mm_set1_ps(value);
+	unsigned int x = from;
+	for (; x + 4 <= to; x += 4)
+		store_tensor4(dst + (uint64_t)x*elemSize, v, bFloat16, bF16C);
+	for (; x < to; x++) {
+		if (bFloat16)
+			reinterpret_cast<uint16_t*>(dst)[x] = spoutCopy::float_to_half(value);
+		else
+			reinterpret_cast<float*>(dst)[x] = value;
+	}
+}
+
+// Convert tensor rows "rowStart" to "rowEnd" of all images.
+// Row n is row (n % height) of image (n / height).
+void spoutCopy::tensor_rows(const SpoutTensorImage* images, unsigned int count,
+	void* tensor, const SpoutTensorDesc& desc, unsigned int rowStart, unsigned int rowEnd) const
+{
+	const unsigned int W = desc.width;
+	const unsigned int H = desc.height;
+	const uint64_t planeSize = (uint64_t)W*H;
+	const unsigned int elemSize = desc.bFloat16 ? 2 : 4;
+
+	// Rows of the images in the batch
+	if (rowEnd > count*H)
+		rowEnd = count*H;
+
+	// Normalisation as scale and bias for the red, green and blue channels
+	float scale[3]{};
+	float bias[3]{};
+	float pad[3]{};
+	for (int c = 0; c < 3; c++) {
+		const float sd = (desc.std[c] != 0.0f) ? desc.std[c] : 1.0f;
+		scale[c] = 1.0f/(255.0f*sd);
+		bias[c] = -desc.mean[c]/sd;
+		pad[c] = (desc.pad - desc.mean[c])/sd;
+	}
+	const __m128 vscale = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+	const __m128 vbias = _mm_setr_ps(bias[0], bias[1], bias[2], 0.0f);
+
+	// Output plane of each channel
+	unsigned int plane[3] = { 0, 1, 2 };
+	if (desc.bBGR) {
+		plane[0] = 2;
+		plane[2] = 0;
+	}
+
+	// Source column offsets and weights for each tensor column
+	std::vector<unsigned int> xoff0(W), xoff1(W);
+	std::vector<float> xfrac(W);
+
+	unsigned int row = rowStart;
+	while (row < rowEnd) {
+
+		const unsigned int n = row/H; // Batch image
+		const unsigned int segmentEnd = ((n + 1)*H < rowEnd) ? (n + 1)*H : rowEnd;
+		const SpoutTensorImage& image = images[n];
+		const unsigned int sw = image.width;
+		const unsigned int sh = image.height;
+		const unsigned int pitch = image.pitch ? image.pitch : sw*4;
+		auto pixels = static_cast<const unsigned char*>(image.pixels);
+
+		// Content area of the tensor
+		unsigned int cw = W, ch = H, ox = 0, oy = 0;
+		if (desc.bLetterbox) {
+			const float s = ((float)W/(float)sw < (float)H/(float)sh) ? (float)W/(float)sw : (float)H/(float)sh;
+			cw = (unsigned int)((float)sw*s + 0.5f);
+			ch = (unsigned int)((float)sh*s + 0.5f);
+			if (cw < 1) cw = 1;
+			if (ch < 1) ch = 1;
+			if (cw > W) cw = W;
+			if (ch > H) ch = H;
+			ox = (W - cw)/2;
+			oy = (H - ch)/2;
+		}
+
+		// Bilinear sample positions with pixel centres aligned
+		for (unsigned int x = 0; x < cw; x++) {
+			float sx = ((float)x + 0.5f)*(float)sw/(float)cw - 0.5f;
+			if (sx < 0.0f) sx = 0.0f;
+			if (sx > (float)(sw - 1)) sx = (float)(sw - 1);
+			const unsigned int x0 = (unsigned int)sx;
+			const unsigned int x1 = (x0 + 1 < sw) ? x0 + 1 : x0;
+			xoff0[x] = x0*4;
+			xoff1[x] = x1*4;
+			xfrac[x] = sx - (float)x0;
+		}
+
+		for (; row < segmentEnd; row++) {
+
+			const unsigned int y = row - n*H;
+			unsigned char* dst[3]{};
+			for (int c = 0; c < 3; c++)
+				dst[c] = static_cast<unsigned char*>(tensor) + ((uint64_t)(n*3 + plane[c])*planeSize + (uint64_t)y*W)*elemSize;
+
+			// Letterbox borders
+			const bool bBorderRow = (y < oy || y >= oy + ch);
+			if (bBorderRow || cw < W) {
+				for (int c = 0; c < 3; c++) {
+					if (bBorderRow) {
+						fill_tensor(dst[c], 0, W, pad[c], desc.bFloat16, m_bF16C);
+					}
+					else {
+						fill_tensor(dst[c], 0, ox, pad[c], desc.bFloat16, m_bF16C);
+						fill_tensor(dst[c], ox + cw, W, pad[c], desc.bFloat16, m_bF16C);
+					}
+				}
+				if (bBorderRow)
+					continue;
+			}
+
+			float sy = ((float)(y - oy) + 0.5f)*(float)sh/(float)ch - 0.5f;
+			if (sy < 0.0f) sy = 0.0f;
+			if (sy > (float)(sh - 1)) sy = (float)(sh - 1);
+			const unsigned int y0 = (unsigned int)sy;
+			const unsigned int y1 = (y0 + 1 < sh) ? y0 + 1 : y0;
+			const __m128 fy = _mm_set1_ps(sy - (float)y0);
+			const unsigned char* row0 = pixels + (uint64_t)y0*pitch;
+			const unsigned char* row1 = pixels + (uint64_t)y1*pitch;
+
+			// Four tensor columns at a time, transposed to planar
+			__m128 v[4];
+			for (unsigned int x = 0; x < cw; x += 4) {
+				const unsigned int num = (cw - x < 4) ? (cw - x) : 4;
+				for (unsigned int i = 0; i < 4; i++) {
+					if (i >= num) {
+						v[i] = _mm_setzero_ps();
+						continue;
+					}
+					const unsigned int tx = x + i;
+					const __m128 fx = _mm_set1_ps(xfrac[tx]);
+					const __m128 p00 = load_rgba8_ps(row0 + xoff0[tx]);
+					const __m128 p01 = load_rgba8_ps(row0 + xoff1[tx]);
+					const __m128 p10 = load_rgba8_ps(row1 + xoff0[tx]);
+					const __m128 p11 = load_rgba8_ps(row1 + xoff1[tx]);
+					const __m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), fx));
+					const __m128 bot = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), fx));
+					__m128 p = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bot, top), fy));
+					if (image.bBGRA)
+						p = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 0, 1, 2));
+					v[i] = _mm_add_ps(_mm_mul_ps(p, vscale), vbias);
+				}
+				// Rows become red, green, blue and alpha of four pixels
+				_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+				const uint64_t offset = (uint64_t)(ox + x)*elemSize;
+				if (num == 4) {
+					for (int c = 0; c < 3; c++)
+						store_tensor4(dst[c] + offset, v[c], desc.bFloat16, m_bF16C);
+				}
+				else {
+					for (int c = 0; c < 3; c++) {
+						float last[4]{}; // Four floats or halves
+						store_tensor4(last, v[c], desc.bFloat16, m_bF16C);
+						memcpy(dst[c] + offset, last, (size_t)num*elemSize);
+					}
+				}
+			}
+		}
+	}
+}
+
+//
+// 10 bit Y'CbCr output
+//
+
+// Load one pixel of a source format as normalised rgba floats
+static inline __m128 load_pixel_norm(const unsigned char* p, DWORD dwFormat, bool bF16C)
+{
+	switch (dwFormat) {
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			return _mm_mul_ps(load_rgba8_ps(p), _mm_set1_ps(1.0f/255.0f));
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			{
+				const __m128 v = _mm_mul_ps(load_rgba8_ps(p), _mm_set1_ps(1.0f/255.0f));
+				return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+			}
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+			{
+				uint32_t v = 0;
+				memcpy(&v, p, 4);
+				const __m128i c = _mm_setr_epi32(v & 0x3FF, (v >> 10) & 0x3FF, (v >> 20) & 0x3FF, v >> 30);
+				return _mm_mul_ps(_mm_cvtepi32_ps(c), _mm_setr_ps(1.0f/1023.0f, 1.0f/1023.0f, 1.0f/1023.0f, 1.0f/3.0f));
+			}
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+			{
+				const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+				const __m128i c = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+				return _mm_mul_ps(_mm_cvtepi32_ps(c), _mm_set1_ps(1.0f/65535.0f));
+			}
+		default: // Float and half float
+			return _mm_min_ps(_mm_max_ps(load_float_pixel(p, dwFormat, bF16C), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	}
+}
+
+// Convert one line to 10 bit luma and filtered, subsampled chroma.
+//   Y      - width rounded up to 4 values
+//   chroma - 2 x width rounded up to 4 values for full width Cb and Cr
+//   Cb, Cr - (width+1)/2 unrounded values
+void spoutCopy::yuv10_line(const unsigned char* src, unsigned int width, DWORD dwFormat,
+	float kr, float kb, uint16_t* Y, float* chroma, float* Cb, float* Cr) const
+{
+	const unsigned int bpp = (dwFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) ? 16 : (dwFormat == DXGI_FORMAT_R16G16B16A16_FLOAT || dwFormat == DXGI_FORMAT_R16G16B16A16_UNORM) ? 8 : 4;
+	const unsigned int w4 = (width + 3) & ~3u;
+	float* cbfull = chroma;
+	float* crfull = chroma + w4;
+
+	// Limited range scaling
+	const float kg = 1.0f - kr - kb;
+	const __m128 vkr = _mm_set1_ps(kr);
+	const __m128 vkg = _mm_set1_ps(kg);
+	const __m128 vkb = _mm_set1_ps(kb);
+	const __m128 yscale = _mm_set1_ps(876.0f);
+	const __m128 yoffset = _mm_set1_ps(64.0f);
+	const __m128 cbscale = _mm_set1_ps(896.0f/(2.0f*(1.0f - kb)));
+	const __m128 crscale = _mm_set1_ps(896.0f/(2.0f*(1.0f - kr)));
+	const __m128 coffset = _mm_set1_ps(512.0f);
+	const __m128i ymin = _mm_set1_epi16(4);
+	const __m128i ymax = _mm_set1_epi16(1019);
+
+	__m128 p[4];
+	for (unsigned int x = 0; x < w4; x += 4) {
+		for (unsigned int i = 0; i < 4; i++) {
+			// Repeat the last pixel to fill the group
+			const unsigned int sx = (x + i < width) ? x + i : width - 1;
+			p[i] = load_pixel_norm(src + (uint64_t)sx*bpp, dwFormat, m_bF16C);
+		}
+		_MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+		const __m128 luma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0], vkr), _mm_mul_ps(p[1], vkg)), _mm_mul_ps(p[2], vkb));
+		const __m128i yi = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(luma, yscale), yoffset));
+		__m128i y16 = _mm_packs_epi32(yi, yi);
+		y16 = _mm_min_epi16(_mm_max_epi16(y16, ymin), ymax);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(Y + x), y16);
+		_mm_storeu_ps(cbfull + x, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p[2], luma), cbscale), coffset));
+		_mm_storeu_ps(crfull + x, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p[0], luma), crscale), coffset));
+	}
+
+	// Co-sited chroma with a [1 2 1] filter
+	const unsigned int cw = (width + 1)/2;
+	for (unsigned int i = 0; i < cw; i++) {
+		const unsigned int x = i*2;
+		const unsigned int xl = (x > 0) ? x - 1 : 0;
+		const unsigned int xr = (x + 1 < width) ? x + 1 : width - 1;
+		Cb[i] = 0.25f*cbfull[xl] + 0.5f*cbfull[x] + 0.25f*cbfull[xr];
+		Cr[i] = 0.25f*crfull[xl] + 0.5f*crfull[x] + 0.25f*crfull[xr];
+	}
+}
+
+// Convert a line of 8 bit Y'CbCr to RGBA or BGRA
+// "cline" is the CbCr line for NV12 or the same as "yline" for packed formats
+void spoutCopy::yuv8_line(const unsigned char* yline, const unsigned char* cline, uint32_t* dst,
+	unsigned int width, int pixelFormat, const int16_t* coef, bool bSwapRB) const
+{
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i lowbyte = _mm_set1_epi16(0x00FF);
+		const __m128i lowword = _mm_set1_epi32(0x0000FFFF);
+		const __m128i zero    = _mm_setzero_si128();
+		const __m128i y16     = _mm_set1_epi16(16);
+		const __m128i c128    = _mm_set1_epi16(128);
+		const __m128i round   = _mm_set1_epi16(32);
+		const __m128i alpha   = _mm_set1_epi8((char)0xFF);
+		const __m128i ys   = _mm_set1_epi16(coef[0]);
+		const __m128i crR  = _mm_set1_epi16(coef[1]);
+		const __m128i cbG  = _mm_set1_epi16(coef[2]);
+		const __m128i crG  = _mm_set1_epi16(coef[3]);
+		const __m128i cbB  = _mm_set1_epi16(coef[4]);
+
+		for (; x + 8 <= width; x += 8) {
+
+			// 8 luma and 4 CbCr pairs as 16 bit words
+			__m128i Y, C;
+			if (pixelFormat == SPOUT_PIXEL_NV12) {
+				Y = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(yline + x)), zero);
+				C = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cline + x)), zero);
+			}
+			else {
+				const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yline + x*2));
+				if (pixelFormat == SPOUT_PIXEL_YUY2) {
+					Y = _mm_and_si128(p, lowbyte);
+					C = _mm_srli_epi16(p, 8);
+				}
+				else {
+					Y = _mm_srli_epi16(p, 8);
+					C = _mm_and_si128(p, lowbyte);
+				}
+			}
+
+			// Repeat each Cb and Cr for two pixels
+			__m128i Cb = _mm_and_si128(C, lowword);
+			__m128i Cr = _mm_srli_epi32(C, 16);
+			Cb = _mm_sub_epi16(_mm_or_si128(Cb, _mm_slli_epi32(Cb, 16)), c128);
+			Cr = _mm_sub_epi16(_mm_or_si128(Cr, _mm_slli_epi32(Cr, 16)), c128);
+			Y = _mm_sub_epi16(Y, y16);
+			Y = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(Y, ys), _mm_srai_epi16(Y, 1)), round);
+
+			// Saturating adds keep the out of range sums clamped
+			__m128i R = _mm_adds_epi16(Y, _mm_mullo_epi16(Cr, crR));
+			__m128i G = _mm_subs_epi16(_mm_subs_epi16(Y, _mm_mullo_epi16(Cb, cbG)), _mm_mullo_epi16(Cr, crG));
+			__m128i B = _mm_adds_epi16(Y, _mm_mullo_epi16(Cb, cbB));
+			R = _mm_packus_epi16(_mm_srai_epi16(R, 6), zero);
+			G = _mm_packus_epi16(_mm_srai_epi16(G, 6), zero);
+			B = _mm_packus_epi16(_mm_srai_epi16(B, 6), zero);
+			if (bSwapRB) {
+				const __m128i t = R;
+				R = B;
+				B = t;
+			}
+
+			// Interleave to RGBA
+			const __m128i rg = _mm_unpacklo_epi8(R, G);
+			const __m128i ba = _mm_unpacklo_epi8(B, alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),     _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 4), _mm_unpackhi_epi16(rg, ba));
+		}
+	}
+
+	// Remaining pixels
+	for (; x < width; x++) {
+		const unsigned int i = x/2;
+		if (pixelFormat == SPOUT_PIXEL_NV12)
+			dst[x] = yuv8_pixel(yline[x], cline[i*2], cline[i*2 + 1], coef, bSwapRB);
+		else if (pixelFormat == SPOUT_PIXEL_YUY2)
+			dst[x] = yuv8_pixel(yline[x*2], yline[i*4 + 1], yline[i*4 + 3], coef, bSwapRB);
+		else
+			dst[x] = yuv8_pixel(yline[x*2 + 1], yline[i*4], yline[i*4 + 2], coef, bSwapRB);
+	}
+}
+
+// Premultiply a line of pixels
+void spoutCopy::premultiply_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bSwapRB) const
+{
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i zero = _mm_setzero_si128();
+		// Alpha is multiplied by 255 to stay the same
+		const __m128i colour = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const __m128i a255   = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		for (; x + 4 <= width; x += 4) {
+			const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+			__m128i lo = _mm_unpacklo_epi8(p, zero);
+			__m128i hi = _mm_unpackhi_epi8(p, zero);
+			lo = div255_epu16(_mm_mullo_epi16(lo, _mm_or_si128(_mm_and_si128(alpha_epi16(lo), colour), a255)));
+			hi = div255_epu16(_mm_mullo_epi16(hi, _mm_or_si128(_mm_and_si128(alpha_epi16(hi), colour), a255)));
+			if (bSwapRB) {
+				lo = swaprb_epi16(lo);
+				hi = swaprb_epi16(hi);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(lo, hi));
+		}
+	}
+
+	for (; x < width; x++) {
+		const uint32_t p = src[x];
+		const uint32_t a = p >> 24;
+		uint32_t q = div255((p & 0xFF)*a) | (div255(((p >> 8) & 0xFF)*a) << 8)
+			| (div255(((p >> 16) & 0xFF)*a) << 16) | (a << 24);
+		dst[x] = bSwapRB ? swaprb(q) : q;
+	}
+}
+
+// Unpremultiply a line of pixels
+void spoutCopy::unpremultiply_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bSwapRB) const
+{
+	const uint16_t* recip = alpha_reciprocal();
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 4 <= width; x += 4) {
+			__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+			// Clamp colour to alpha
+			__m128i a = _mm_srli_epi32(p, 24);
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+			p = _mm_min_epu8(p, a);
+			// Colour times the reciprocal, 256 for alpha to stay the same.
+			// The high word of the product is the result and
+			// bit 15 of the low word rounds it.
+			const uint16_t r0 = recip[src[x] >> 24];
+			const uint16_t r1 = recip[src[x + 1] >> 24];
+			const uint16_t r2 = recip[src[x + 2] >> 24];
+			const uint16_t r3 = recip[src[x + 3] >> 24];
+			const __m128i mlo = _mm_set_epi16(256, (short)r1, (short)r1, (short)r1, 256, (short)r0, (short)r0, (short)r0);
+			const __m128i mhi = _mm_set_epi16(256, (short)r3, (short)r3, (short)r3, 256, (short)r2, (short)r2, (short)r2);
+			const __m128i lo = _mm_slli_epi16(_mm_unpacklo_epi8(p, zero), 8);
+			const __m128i hi = _mm_slli_epi16(_mm_unpackhi_epi8(p, zero), 8);
+			__m128i qlo = _mm_add_epi16(_mm_mulhi_epu16(lo, mlo), _mm_srli_epi16(_mm_mullo_epi16(lo, mlo), 15));
+			__m128i qhi = _mm_add_epi16(_mm_mulhi_epu16(hi, mhi), _mm_srli_epi16(_mm_mullo_epi16(hi, mhi), 15));
+			if (bSwapRB) {
+				qlo = swaprb_epi16(qlo);
+				qhi = swaprb_epi16(qhi);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(qlo, qhi));
+		}
+	}
+
+	for (; x < width; x++) {
+		const uint32_t p = src[x];
+		const uint32_t a = p >> 24;
+		const uint32_t r = recip[a];
+		uint32_t q = a << 24;
+		for (int c = 0; c < 3; c++) {
+			uint32_t v = (p >> (c*8)) & 0xFF;
+			if (v > a) v = a;
+			const uint32_t m = (v << 8)*r;
+			q |= ((m >> 16) + ((m >> 15) & 1)) << (c*8);
+		}
+		dst[x] = bSwapRB ? swaprb(q) : q;
+	}
+}
+
+// Composite a line of pixels over the background
+void spoutCopy::over_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bPremultiplied, bool bSwapRB) const
+{
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i c255 = _mm_set1_epi16(255);
+		const __m128i colour = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const __m128i a255   = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		for (; x + 4 <= width; x += 4) {
+			const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+			__m128i slo = _mm_unpacklo_epi8(s, zero);
+			__m128i shi = _mm_unpackhi_epi8(s, zero);
+			if (bSwapRB) {
+				slo = swaprb_epi16(slo);
+				shi = swaprb_epi16(shi);
+			}
+			const __m128i salo = alpha_epi16(slo);
+			const __m128i sahi = alpha_epi16(shi);
+			// Background times inverse source alpha
+			__m128i dlo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, salo));
+			__m128i dhi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, sahi));
+			__m128i q;
+			if (bPremultiplied) {
+				// Saturate in case colour is greater than alpha
+				const __m128i sq = bSwapRB ? _mm_packus_epi16(slo, shi) : s;
+				q = _mm_adds_epu8(sq, _mm_packus_epi16(div255_epu16(dlo), div255_epu16(dhi)));
+			}
+			else {
+				// Source times source alpha, or 255 for alpha
+				dlo = _mm_add_epi16(dlo, _mm_mullo_epi16(slo, _mm_or_si128(_mm_and_si128(salo, colour), a255)));
+				dhi = _mm_add_epi16(dhi, _mm_mullo_epi16(shi, _mm_or_si128(_mm_and_si128(sahi, colour), a255)));
+				q = _mm_packus_epi16(div255_epu16(dlo), div255_epu16(dhi));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), q);
+		}
+	}
+
+	for (; x < width; x++) {
+		const uint32_t s = bSwapRB ? swaprb(src[x]) : src[x];
+		const uint32_t d = dst[x];
+		const uint32_t a = s >> 24;
+		uint32_t q = 0;
+		for (int c = 0; c < 4; c++) {
+			const uint32_t sc = (s >> (c*8)) & 0xFF;
+			const uint32_t dc = ((d >> (c*8)) & 0xFF)*(255 - a);
+			uint32_t v = 0;
+			if (bPremultiplied)
+				v = sc + div255(dc);
+			else
+				v = div255(sc*((c == 3) ? 255 : a) + dc);
+			q |= ((v > 255) ? 255 : v) << (c*8);
+		}
+		dst[x] = q;
+	}
+}
+
+// Reduce two lines to one line of "width" pixels
+void spoutCopy::half_line(const unsigned char* row0, const unsigned char* row1, uint32_t* dst, unsigned int width) const
+{
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i one = _mm_set1_epi8(1);
+		for (; x + 4 <= width; x += 4) {
+			const __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x*8)));
+			const __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x*8 + 16)));
+			const __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x*8)));
+			const __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x*8 + 16)));
+			// Even and odd pixels of each line
+			const __m128i a = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i b = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+			const __m128i c = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i d = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+			const __m128i ab = _mm_avg_epu8(a, b);
+			const __m128i cd = _mm_avg_epu8(c, d);
+			// Each average rounds up. Subtract one where both halves were rounded
+			// up and the final average rounds up again to get (a+b+c+d+2)/4.
+			const __m128i err = _mm_and_si128(_mm_and_si128(
+				_mm_or_si128(_mm_xor_si128(a, b), _mm_xor_si128(c, d)), _mm_xor_si128(ab, cd)), one);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_sub_epi8(_mm_avg_epu8(ab, cd), err));
+		}
+	}
+
+	for (; x < width; x++) {
+		const unsigned char* p0 = row0 + x*8;
+		const unsigned char* p1 = row1 + x*8;
+		uint32_t q = 0;
+		for (int c = 0; c < 4; c++)
+			q |= (uint32_t)((p0[c] + p0[c + 4] + p1[c] + p1[c + 4] + 2) >> 2) << (c*8);
+		dst[x] = q;
+	}
+}
+
+// Reduce four lines to one line of "width" pixels
+void spoutCopy::quarter_line(const unsigned char* src, unsigned int pitch, uint32_t* dst, unsigned int width) const
+{
+	unsigned int x = 0;
+
+	if (m_bSSE2) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(8);
+		for (; x < width; x++) {
+			// 16 bit sums of pixels 0+2 and 1+3 of four lines
+			__m128i sum = zero;
+			for (unsigned int r = 0; r < 4; r++) {
+				const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (uint64_t)r*pitch + x*16));
+				sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(p, zero), _mm_unpackhi_epi8(p, zero)));
+			}
+			sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 4);
+			dst[x] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+		}
+	}
+
+	for (; x < width; x++) {
+		uint32_t q = 0;
+		for (int c = 0; c < 4; c++) {
+			unsigned int sum = 8;
+			for (unsigned int r = 0; r < 4; r++) {
+				const unsigned char* p = src + (uint64_t)r*pitch + x*16 + c;
+				sum += p[0] + p[4] + p[8] + p[12];
+			}
+			q |= (uint32_t)(sum >> 4) << (c*8);
+		}
+		dst[x] = q;
+	}
+}
+
+// Reduce first level lines "rowStart" to "rowEnd" and the lines of
+// the following levels that depend on them
+void spoutCopy::pyramid_rows(const unsigned char* source, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, void** levels, unsigned int count, unsigned int rowStart, unsigned int rowEnd) const
+{
+	for (unsigned int r = rowStart; r < rowEnd; r++) {
+		const unsigned char* row0 = source + (uint64_t)r*2*sourcePitch;
+		half_line(row0, row0 + sourcePitch, static_cast<uint32_t*>(levels[0]) + (uint64_t)r*(width >> 1), width >> 1);
+		// Continue down the levels while a pair of lines is complete
+		unsigned int row = r;
+		for (unsigned int k = 1; k < count && (row & 1); k++) {
+			const unsigned int w = width >> k; // level k-1 line width
+			const unsigned int next = row >> 1;
+			if (next >= (height >> (k + 1)))
+				break;
+			const unsigned char* prev = static_cast<const unsigned char*>(levels[k - 1]) + (uint64_t)(row - 1)*w*4;
+			half_line(prev, prev + w*4, static_cast<uint32_t*>(levels[k]) + (uint64_t)next*(w >> 1), w >> 1);
+			row = next;
+		}
+	}
+}
+
+// Filter destination lines "rowStart" to "rowEnd".
+// The source lines used by the band are filtered horizontally first.
+void spoutCopy::filter_rows(const unsigned char* source, unsigned int sourcePitch,
+	unsigned char* dest, unsigned int destWidth, unsigned int destHeight,
+	const spoutFilterBank* hbank, const spoutFilterBank* vbank, bool bInvert,
+	unsigned int rowStart, unsigned int rowEnd) const
+{
+	if (rowStart >= rowEnd)
+		return;
+
+	const unsigned int channels = destWidth*4;
+	const unsigned int srcStart = vbank->first[rowStart];
+	const unsigned int srcEnd = vbank->first[rowEnd - 1] + vbank->count;
+	std::vector<int16_t> inter((size_t)(srcEnd - srcStart)*channels);
+
+	// Horizontal pass to 16 bit with 6 fractional bits
+	const unsigned int hcount = hbank->count;
+	const __m128i zero = _mm_setzero_si128();
+	for (unsigned int y = srcStart; y < srcEnd; y++) {
+		const unsigned char* line = source + (uint64_t)y*sourcePitch;
+		int16_t* out = &inter[(size_t)(y - srcStart)*channels];
+		for (unsigned int x = 0; x < destWidth; x++) {
+			const unsigned char* pix = line + (size_t)hbank->first[x]*4;
+			const int16_t* w = &hbank->weights[(size_t)x*hcount];
+			if (m_bSSE2) {
+				__m128i sum = zero;
+				unsigned int t = 0;
+				for (; t + 2 <= hcount; t += 2) {
+					// Channels of two pixels interleaved for multiply and add
+					const __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pix + t*4)), zero);
+					const __m128i wt = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[t + 1] << 16) | (uint16_t)w[t]));
+					sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(p, _mm_srli_si128(p, 8)), wt));
+				}
+				if (t < hcount) {
+					int32_t last = 0;
+					memcpy(&last, pix + t*4, 4);
+					const __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+					sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(p, zero), _mm_set1_epi32((uint16_t)w[t])));
+				}
+				sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x*4), _mm_packs_epi32(sum, sum));
+			}
+			else {
+				for (int c = 0; c < 4; c++) {
+					int sum = 128;
+					for (unsigned int t = 0; t < hcount; t++)
+						sum += pix[t*4 + c]*w[t];
+					sum >>= 8;
+					out[x*4 + c] = (int16_t)((sum < -32768) ? -32768 : (sum > 32767) ? 32767 : sum);
+				}
+			}
+		}
+	}
+
+	// Vertical pass in blocks of 256 channels
+	const unsigned int vcount = vbank->count;
+	const unsigned int block = 256;
+	for (unsigned int c0 = 0; c0 < channels; c0 += block) {
+		const unsigned int c1 = (c0 + block < channels) ? c0 + block : channels;
+		for (unsigned int y = rowStart; y < rowEnd; y++) {
+			const int16_t* rows = &inter[(size_t)(vbank->first[y] - srcStart)*channels];
+			const int16_t* w = &vbank->weights[(size_t)y*vcount];
+			unsigned char* out = dest + (uint64_t)(bInvert ? (destHeight - 1 - y) : y)*channels;
+			unsigned int c = c0;
+			if (m_bSSE2) {
+				for (; c + 8 <= c1; c += 8) {
+					__m128i lo = _mm_set1_epi32(1 << 19);
+					__m128i hi = lo;
+					unsigned int t = 0;
+					for (; t + 2 <= vcount; t += 2) {
+						const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (size_t)t*channels + c));
+						const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (size_t)(t + 1)*channels + c));
+						const __m128i wt = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[t + 1] << 16) | (uint16_t)w[t]));
+						lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wt));
+						hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wt));
+					}
+					if (t < vcount) {
+						const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + (size_t)t*channels + c));
+						const __m128i wt = _mm_set1_epi32((uint16_t)w[t]);
+						lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), wt));
+						hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), wt));
+					}
+					const __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, 20), _mm_srai_epi32(hi, 20));
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out + c), _mm_packus_epi16(v, v));
+				}
+			}
+			for (; c < c1; c++) {
+				int sum = 1 << 19;
+				for (unsigned int t = 0; t < vcount; t++)
+					sum += rows[(size_t)t*channels + c]*w[t];
+				sum >>= 20;
+				out[c] = (unsigned char)((sum < 0) ? 0 : (sum > 255) ? 255 : sum);
+			}
+		}
+	}
+}
+
+// Rotate 32 or 24 bit pixels by 0, 90, 180 or 270 degrees
+bool spoutCopy::rotate_image(const void* source, void* dest, unsigned int width, unsigned int height,
+	unsigned int sourcePitch, unsigned int destPitch, int rotation,
+	unsigned int bytes, bool bSwapRB, bool bInvert) const
+{
+	if (!source || !dest || width == 0 || height == 0)
+		return false;
+	rotation = ((rotation % 360) + 360) % 360;
+	if (rotation % 90 != 0)
+		return false;
+
+	const bool bTranspose = (rotation == 90 || rotation == 270);
+	if (sourcePitch == 0) sourcePitch = width*bytes;
+	if (destPitch == 0) destPitch = (bTranspose ? height : width)*bytes;
+
+	// Flip by reading source lines from the bottom up
+	auto src = static_cast<const unsigned char*>(source);
+	int64_t pitch = (int64_t)sourcePitch;
+	if (bInvert) {
+		src += (uint64_t)(height - 1)*sourcePitch;
+		pitch = -pitch;
+	}
+	auto dst = static_cast<unsigned char*>(dest);
+
+	if (bTranspose) {
+		for (unsigned int y = 0; y < height; y += rotate_tile_size) {
+			for (unsigned int x = 0; x < width; x += rotate_tile_size)
+				rotate_tile(src, pitch, dst, destPitch, width, height, x, y, bytes, rotation == 90, bSwapRB);
+		}
+		return true;
+	}
+
+	// 0 and 180 degrees line by line
+	const bool bReverse = (rotation == 180);
+	for (unsigned int y = 0; y < height; y++) {
+		const unsigned char* s = src + (int64_t)y*pitch;
+		unsigned char* d = dst + (uint64_t)(bReverse ? (height - 1 - y) : y)*destPitch;
+		if (!bReverse && !bSwapRB) {
+			memcpy(d, s, (size_t)width*bytes);
+			continue;
+		}
+		unsigned int x = 0;
+		if (bytes == 4 && m_bSSE2) {
+			for (; x + 4 <= width; x += 4) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x*4));
+				if (bSwapRB)
+					v = swaprb_epi32(v);
+				if (bReverse)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + (width - 4 - x)*4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+				else
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + x*4), v);
+			}
+		}
+		for (; x < width; x++) {
+			const unsigned char* p = s + x*bytes;
+			unsigned char* q = d + (bReverse ? (width - 1 - x) : x)*bytes;
+			q[0] = p[bSwapRB ? 2 : 0];
+			q[1] = p[1];
+			q[2] = p[bSwapRB ? 0 : 2];
+			if (bytes == 4) q[3] = p[3];
+		}
+	}
+	return true;
+}
+
+// Rotate a tile of source pixels at x0, y0 by 90 (b90) or 270 degrees.
+// The source line pitch is negative for a flipped source.
+void spoutCopy::rotate_tile(const unsigned char* src, int64_t pitch, unsigned char* dst, unsigned int destPitch,
+	unsigned int width, unsigned int height, unsigned int x0, unsigned int y0,
+	unsigned int bytes, bool b90, bool bSwapRB) const
+{
+	const unsigned int x1 = (width - x0 > rotate_tile_size) ? x0 + rotate_tile_size : width;
+	const unsigned int y1 = (height - y0 > rotate_tile_size) ? y0 + rotate_tile_size : height;
+
+	// Destination of source pixel x, y
+	auto target = [&](unsigned int x, unsigned int y) {
+		if (b90)
+			return dst + (uint64_t)x*destPitch + (uint64_t)(height - 1 - y)*bytes;
+		return dst + (uint64_t)(width - 1 - x)*destPitch + (uint64_t)y*bytes;
+	};
+
+	// Extent of whole 4x4 blocks
+	const bool bSIMD = (bytes == 4) ? m_bSSE2 : m_bSSSE3;
+	const unsigned int bx1 = bSIMD ? x0 + ((x1 - x0) & ~3u) : x0;
+	const unsigned int by1 = bSIMD ? y0 + ((y1 - y0) & ~3u) : y0;
+
+	if (bytes == 4) {
+		for (unsigned int y = y0; y < by1; y += 4) {
+			const unsigned char* s = src + (int64_t)y*pitch;
+			for (unsigned int x = x0; x < bx1; x += 4) {
+				const unsigned char* p = s + x*4;
+				__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + pitch));
+				__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + pitch*2));
+				__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + pitch*3));
+				if (bSwapRB) {
+					r0 = swaprb_epi32(r0);
+					r1 = swaprb_epi32(r1);
+					r2 = swaprb_epi32(r2);
+					r3 = swaprb_epi32(r3);
+				}
+				// Source columns. Reverse their order for 90 degrees.
+				transpose_epi32(r0, r1, r2, r3);
+				if (b90) {
+					r0 = _mm_shuffle_epi32(r0, _MM_SHUFFLE(0, 1, 2, 3));
+					r1 = _mm_shuffle_epi32(r1, _MM_SHUFFLE(0, 1, 2, 3));
+					r2 = _mm_shuffle_epi32(r2, _MM_SHUFFLE(0, 1, 2, 3));
+					r3 = _mm_shuffle_epi32(r3, _MM_SHUFFLE(0, 1, 2, 3));
+				}
+				const unsigned int yd = b90 ? y + 3 : y;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target(x, yd)), r0);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target(x + 1, yd)), r1);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target(x + 2, yd)), r2);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target(x + 3, yd)), r3);
+			}
+		}
+	}
+	else if (bSIMD) {
+		// Expand to 32 bits with the red/blue swap, then compress
+		// with the column order reversed for 90 degrees
+		const __m128i expand = bSwapRB
+			? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+			: _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i compress = b90
+			? _mm_setr_epi8(12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2, -1, -1, -1, -1)
+			: _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		for (unsigned int y = y0; y < by1; y += 4) {
+			const unsigned char* s = src + (int64_t)y*pitch;
+			for (unsigned int x = x0; x < bx1; x += 4) {
+				const unsigned char* p = s + x*3;
+				__m128i r0 = _mm_shuffle_epi8(load_rgb4(p), expand);
+				__m128i r1 = _mm_shuffle_epi8(load_rgb4(p + pitch), expand);
+				__m128i r2 = _mm_shuffle_epi8(load_rgb4(p + pitch*2), expand);
+				__m128i r3 = _mm_shuffle_epi8(load_rgb4(p + pitch*3), expand);
+				transpose_epi32(r0, r1, r2, r3);
+				const unsigned int yd = b90 ? y + 3 : y;
+				store_rgb4(target(x, yd), _mm_shuffle_epi8(r0, compress));
+				store_rgb4(target(x + 1, yd), _mm_shuffle_epi8(r1, compress));
+				store_rgb4(target(x + 2, yd), _mm_shuffle_epi8(r2, compress));
+				store_rgb4(target(x + 3, yd), _mm_shuffle_epi8(r3, compress));
+			}
+		}
+	}
+
+	// Remaining columns and lines
+	for (unsigned int y = y0; y < y1; y++) {
+		const unsigned char* s = src + (int64_t)y*pitch;
+		for (unsigned int x = (y < by1) ? bx1 : x0; x < x1; x++) {
+			const unsigned char* p = s + x*bytes;
+			unsigned char* q = target(x, y);
+			q[0] = p[bSwapRB ? 2 : 0];
+			q[1] = p[1];
+			q[2] = p[bSwapRB ? 0 : 2];
+			if (bytes == 4) q[3] = p[3];
+		}
+	}
+}
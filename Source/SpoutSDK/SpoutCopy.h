@@ -48,6 +48,71 @@
 #include <cmath> // For compatibility with Clang. PR#81
 #include <stdint.h> // for _uint32 etc
 
+// Tone mapping operators for high dynamic range senders
+enum SpoutToneMap {
+	SPOUT_TONEMAP_NONE,     // Clamp
+	SPOUT_TONEMAP_REINHARD, // Extended Reinhard
+	SPOUT_TONEMAP_ACES,     // ACES filmic fit
+	SPOUT_TONEMAP_BT2390,   // ITU-R BT.2390 EETF
+};
+
+struct spoutToneMapLUT;
+
+// Resampling filters
+enum SpoutResampleFilter {
+	SPOUT_FILTER_NEAREST,  // Nearest neighbour (rgba2rgbaResample)
+	SPOUT_FILTER_LINEAR,   // Bilinear or area average (rgba2rgbaResampleLinear)
+	SPOUT_FILTER_BICUBIC,  // Catmull-Rom bicubic
+	SPOUT_FILTER_MITCHELL, // Mitchell-Netravali B = C = 1/3
+	SPOUT_FILTER_LANCZOS3, // Lanczos 3 lobe
+};
+
+struct spoutFilterBank;
+
+// Pixel buffer formats
+enum SpoutPixelFormat {
+	SPOUT_PIXEL_RGBA,
+	SPOUT_PIXEL_BGRA,
+	SPOUT_PIXEL_RGB,
+	SPOUT_PIXEL_BGR,
+	SPOUT_PIXEL_V210, // 10 bit 4:2:2 packed
+	SPOUT_PIXEL_P010, // 10 bit 4:2:0 Y plane and CbCr plane
+	SPOUT_PIXEL_P210, // 10 bit 4:2:2 Y plane and CbCr plane
+	SPOUT_PIXEL_NV12, // 8 bit 4:2:0 Y plane and CbCr plane
+	SPOUT_PIXEL_YUY2, // 8 bit 4:2:2 packed Y0 Cb Y1 Cr
+	SPOUT_PIXEL_UYVY, // 8 bit 4:2:2 packed Cb Y0 Cr Y1
+	SPOUT_PIXEL_RGBA16, // 16 bit unsigned RGBA
+};
+
+// Y'CbCr matrix
+enum SpoutYUVMatrix {
+	SPOUT_YUV_BT601,
+	SPOUT_YUV_BT709,
+	SPOUT_YUV_BT2020,
+};
+
+// Source image for rgba2tensor
+struct SpoutTensorImage {
+	const void* pixels = nullptr; // RGBA or BGRA pixels
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int pitch = 0;       // Line pitch in bytes, 0 for width*4
+	bool bBGRA = false;           // Pixels are BGRA
+};
+
+// Tensor format for rgba2tensor
+struct SpoutTensorDesc {
+	unsigned int width = 224;     // Tensor width
+	unsigned int height = 224;    // Tensor height
+	bool bFloat16 = false;        // Half float instead of float elements
+	bool bBGR = false;            // Blue, green, red planes instead of red, green, blue
+	bool bLetterbox = false;      // Keep the image aspect ratio and pad the borders
+	float pad = 0.0f;             // Border value before normalisation (0-1)
+	float mean[3] = { 0.0f, 0.0f, 0.0f }; // Red, green, blue mean (0-1)
+	float std[3] = { 1.0f, 1.0f, 1.0f };  // Red, green, blue standard deviation
+	unsigned int threads = 0;     // Threads to use, 0 for automatic
+};
+
 class SPOUT_DLLEXP spoutCopy {
 
 	public:
@@ -55,6 +120,10 @@ class SPOUT_DLLEXP spoutCopy {
 		spoutCopy();
 		~spoutCopy();
 
+		// Tone mapping tables are owned and not copied
+		spoutCopy(const spoutCopy&) = delete;
+		spoutCopy& operator=(const spoutCopy&) = delete;
+
 		// Copy image pixels and select fastest method based on image width
 		void CopyPixels(const unsigned char *src, unsigned char *dst,
 						unsigned int width, unsigned int height, 
@@ -99,6 +168,74 @@ class SPOUT_DLLEXP spoutCopy {
 			unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
 			unsigned int destWidth, unsigned int destHeight, bool bInvert = false) const;
 
+		// Copy rgba buffers of differing size with bilinear filtering for enlarging
+		// and area averaging for reducing, optionally in linear light
+		void rgba2rgbaResampleLinear(const void* source, void* dest,
+			unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+			unsigned int destWidth, unsigned int destHeight,
+			bool bInvert = false, bool bGammaCorrect = true) const;
+
+		// Copy rgba buffers of differing size with a bicubic, Mitchell or Lanczos3 filter
+		void rgba2rgbaResampleFilter(const void* source, void* dest,
+			unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+			unsigned int destWidth, unsigned int destHeight,
+			int filter = SPOUT_FILTER_LANCZOS3, bool bInvert = false, unsigned int threads = 0,
+			bool bGammaCorrect = false) const;
+
+		// Reduce rgba by exactly half. Odd last lines and columns are ignored.
+		void rgba2rgbaHalf(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0) const;
+
+		// Reduce rgba by exactly a quarter
+		void rgba2rgbaQuarter(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0) const;
+
+		// Mip pyramid of successive half reductions in one sweep of the source.
+		// levels[i] receives (width >> (i+1)) x (height >> (i+1)) rgba pixels.
+		bool rgba2pyramid(const void* source, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, void** levels, unsigned int count, unsigned int threads = 0) const;
+
+		//
+		// sRGB <> linear
+		//
+		// 16 bit linear light RGBA. Alpha is scaled to 16 bits unchanged.
+		// Pitch is in bytes, 0 for the width.
+		//
+
+		// Convert sRGB rgba pixels to 16 bit linear
+		void srgb2linear16(const void* source, uint16_t* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0, bool bInvert = false) const;
+		// Convert 16 bit linear rgba pixels to sRGB
+		void linear162srgb(const uint16_t* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0, bool bInvert = false) const;
+
+		//
+		// Rotation
+		//
+		// Clockwise by 0, 90, 180 or 270 degrees. 90 and 270 exchange width
+		// and height of the destination. Pitch 0 is the line width. bSwapRB
+		// also converts RGBA <> BGRA and bInvert flips the source first.
+		//
+
+		// Rotate 32 bit rgba pixels
+		bool rgba2rgbaRotate(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, int rotation,
+			bool bSwapRB = false, bool bInvert = false) const;
+		// Rotate 24 bit rgb pixels
+		bool rgb2rgbRotate(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, int rotation,
+			bool bSwapRB = false, bool bInvert = false) const;
+
+		//
+		// Regions
+		//
+
+		// Convert a region at x, y of a pitched image in a DXGI format
+		// to 8 bit RGBA, BGRA, RGB or BGR allowing for destination pitch
+		bool region2rgba(const void* source, void* dest, unsigned int x, unsigned int y,
+			unsigned int width, unsigned int height, unsigned int sourcePitch, unsigned int destPitch,
+			DWORD dwFormat, GLenum glFormat = GL_RGBA, bool bInvert = false) const;
+
 		//
 		// RGBA <> BGRA
 		//
@@ -209,11 +346,129 @@ class SPOUT_DLLEXP spoutCopy {
 		// Copy BGRA to BGR
 		void bgra2bgr (const void* bgra_source, void *bgr_dest,  unsigned int width, unsigned int height, bool bInvert = false) const;
 
+		//
+		// High bit depth formats
+		//
+		// DXGI_FORMAT_R10G10B10A2_UNORM, R16G16B16A16_FLOAT,
+		// R16G16B16A16_UNORM and R32G32B32A32_FLOAT
+		//
+
+		// Can the DXGI format be converted
+		bool IsHighBitFormat(DWORD dwFormat) const;
+
+		// Convert to 8 bit RGBA, BGRA, RGB or BGR allowing for source and destination pitch
+		bool highbit2rgba(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat,
+			GLenum glFormat = GL_RGBA, bool bInvert = false) const;
+
+		// Convert to 16 bit RGBA allowing for source and destination pitch.
+		// 8 bit RGBA and BGRA are also accepted.
+		bool highbit2rgba16(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, bool bInvert = false) const;
+
+		// Half float to float
+		static float half_to_float(uint16_t h);
+
+		// Tone map high dynamic range pixels to 8 bit sRGB RGBA, BGRA, RGB or BGR
+		bool tonemap2rgba(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat,
+			GLenum glFormat = GL_RGBA, int toneMap = SPOUT_TONEMAP_ACES,
+			float exposure = 1.0f, float peakNits = 1000.0f,
+			bool bPQ = false, bool bInvert = false);
+
+		//
+		// Tensor conversion
+		//
+
+		// Resize, normalise and convert an image to a planar float tensor (NCHW)
+		bool rgba2tensor(const SpoutTensorImage& image, void* tensor, const SpoutTensorDesc& desc) const;
+		// Convert a batch of images to a tensor
+		bool rgba2tensor(const SpoutTensorImage* images, unsigned int count,
+			void* tensor, const SpoutTensorDesc& desc) const;
+
+		// Float to half float
+		static uint16_t float_to_half(float f);
+
+		//
+		// 10 bit Y'CbCr
+		//
+		// Source pixels are DXGI_FORMAT_R8G8B8A8_UNORM, B8G8R8A8_UNORM
+		// or a high bit depth format (see IsHighBitFormat)
+		//
+
+		// Line pitch and buffer size of a SpoutPixelFormat
+		static unsigned int GetPixelBufferPitch(int pixelFormat, unsigned int width);
+		static unsigned int GetPixelBufferSize(int pixelFormat, unsigned int width, unsigned int height);
+
+		// Convert to v210 4:2:2
+		bool rgba2v210(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat,
+			int matrix = SPOUT_YUV_BT709, bool bInvert = false) const;
+		// Convert to P010 4:2:0
+		bool rgba2p010(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat,
+			int matrix = SPOUT_YUV_BT709, bool bInvert = false) const;
+		// Convert to P210 4:2:2
+		bool rgba2p210(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat,
+			int matrix = SPOUT_YUV_BT709, bool bInvert = false) const;
+		// Convert to v210, P010 or P210 selected by pixel format
+		bool rgba2yuv10(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, DWORD dwFormat, int pixelFormat,
+			int matrix = SPOUT_YUV_BT709, bool bInvert = false) const;
+
+		//
+		// 8 bit Y'CbCr
+		//
+
+		// Convert NV12, YUY2 or UYVY to RGBA or BGRA
+		bool yuv2rgba(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, int pixelFormat,
+			int matrix = SPOUT_YUV_BT709, bool bSwapRB = false, bool bInvert = false) const;
+
+		//
+		// Alpha
+		//
+		// 8 bit RGBA or BGRA pixels. Source and destination can be the same.
+		// Pitch 0 is width*4. Separate bands of lines can be converted
+		// by separate threads. bSwapRB also converts RGBA <> BGRA.
+		//
+
+		// Multiply colour by alpha
+		void premultiply(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0,
+			bool bSwapRB = false, bool bInvert = false) const;
+		// Divide colour by alpha
+		void unpremultiply(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0,
+			bool bSwapRB = false, bool bInvert = false) const;
+		// Composite source over a background in dest
+		void over(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch = 0, unsigned int destPitch = 0, bool bPremultiplied = true,
+			bool bSwapRB = false, bool bInvert = false) const;
+
+		//
+		// Frame comparison
+		//
+
+		// 64 bit hash of image lines for detecting identical frames.
+		// Pitch 0 is lineBytes. Hash every "step" lines for a faster sample.
+		uint64_t FrameHash(const void* source, unsigned int lineBytes, unsigned int height,
+			unsigned int pitch = 0, unsigned int step = 1) const;
+
+		// Compare an image with the previous frame in tiles and optionally update it.
+		// "changed" receives one bit for each tile and "sad" the sum of absolute differences.
+		// Returns the number of tiles that changed.
+		unsigned int CompareTiles(const void* source, void* previous, unsigned int width, unsigned int height,
+			unsigned int bytesPerPixel, unsigned int sourcePitch, unsigned int tileSize,
+			unsigned char* changed, uint32_t* sad = nullptr, bool bUpdate = true) const;
+
 		// SSE capability
 		void GetSSE(bool &bSSE2, bool &bSSE3, bool &bSSSE3);
 		bool GetSSE2();
 		bool GetSSE3();
 		bool GetSSSE3();
+		bool GetF16C();
 
 		// LJ DEBUG
 		void rgba_swap_ssse3(void* __restrict rgbasource, unsigned int width, unsigned int height);
@@ -224,6 +479,50 @@ class SPOUT_DLLEXP spoutCopy {
 		bool m_bSSE2 = false;
 		bool m_bSSE3 = false;
 		bool m_bSSSE3 = false;
+		bool m_bF16C = false;
+
+		// High bit depth line conversion
+		void highbit_line_to_rgba8(const unsigned char* src, uint32_t* dst,
+			unsigned int width, DWORD dwFormat, bool bSwapRB) const;
+		void highbit_line_to_rgba16(const unsigned char* src, uint16_t* dst,
+			unsigned int width, DWORD dwFormat) const;
+
+		// Tone mapping lookup tables
+		spoutToneMapLUT* m_pToneMap = nullptr;
+		void CheckToneMapLUT(int op, float exposure, float peak, float white, bool bHalf);
+
+		// Tensor rows for rgba2tensor threads
+		void tensor_rows(const SpoutTensorImage* images, unsigned int count,
+			void* tensor, const SpoutTensorDesc& desc, unsigned int rowStart, unsigned int rowEnd) const;
+
+		// 10 bit Y'CbCr line conversion
+		void yuv10_line(const unsigned char* src, unsigned int width, DWORD dwFormat,
+			float kr, float kb, uint16_t* Y, float* chroma, float* Cb, float* Cr) const;
+		// 8 bit Y'CbCr line conversion
+		void yuv8_line(const unsigned char* yline, const unsigned char* cline, uint32_t* dst,
+			unsigned int width, int pixelFormat, const int16_t* coef, bool bSwapRB) const;
+		// Half and quarter line reduction
+		void half_line(const unsigned char* row0, const unsigned char* row1, uint32_t* dst, unsigned int width) const;
+		void quarter_line(const unsigned char* src, unsigned int pitch, uint32_t* dst, unsigned int width) const;
+		// Filtered rows for rgba2rgbaResampleFilter threads
+		void filter_rows(const unsigned char* source, unsigned int sourcePitch,
+			unsigned char* dest, unsigned int destWidth, unsigned int destHeight,
+			const spoutFilterBank* hbank, const spoutFilterBank* vbank, bool bInvert,
+			unsigned int rowStart, unsigned int rowEnd) const;
+		// Pyramid rows for rgba2pyramid threads
+		void pyramid_rows(const unsigned char* source, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, void** levels, unsigned int count, unsigned int rowStart, unsigned int rowEnd) const;
+		// 32 or 24 bit rotation and cache tiles for 90 and 270 degrees
+		bool rotate_image(const void* source, void* dest, unsigned int width, unsigned int height,
+			unsigned int sourcePitch, unsigned int destPitch, int rotation,
+			unsigned int bytes, bool bSwapRB, bool bInvert) const;
+		void rotate_tile(const unsigned char* src, int64_t pitch, unsigned char* dst, unsigned int destPitch,
+			unsigned int width, unsigned int height, unsigned int x0, unsigned int y0,
+			unsigned int bytes, bool b90, bool bSwapRB) const;
+		// Alpha line conversion
+		void premultiply_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bSwapRB) const;
+		void unpremultiply_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bSwapRB) const;
+		void over_line(const uint32_t* src, uint32_t* dst, unsigned int width, bool bPremultiplied, bool bSwapRB) const;
 
 		void rgba_bgra(const void *rgba_source, void *bgra_dest, unsigned int width, unsigned int height, bool bInvert = false) const;
 		void rgba_bgra_sse2(const void *rgba_source, void *bgra_dest, unsigned int width, unsigned int height, bool bInvert = false) const;
@@ -16,6 +16,9 @@
 //		07.06.25	- Add "__DX9__" define for include by SpoutDX9 or SpoutDirectX9
 //		20.06.25	- Cleanup and test for both DX11 and DX9
 //		30.06.25	- Move DirectX9 functions to a separate file SpoutDX9shaders.hpp
+//		17.10.26	- ComputeShader - add trace events for each shader dispatch
+//					- Add ToneMap for high dynamic range senders
+//					- Add Rotate by 90, 180 or 270 degrees with tiled transpose
 //
 // ====================================================================================
 /*
@@ -89,6 +92,8 @@ public:
 		if (m_AdjustProgram) m_AdjustProgram->Release();
 		if (m_TempProgram) m_TempProgram->Release();
 		if (m_CasProgram) m_CasProgram->Release();
+		if (m_ToneMapProgram) m_ToneMapProgram->Release();
+		if (m_RotateProgram) m_RotateProgram->Release();
 
 		// Release compute shader SRV and UAV
 		ReleaseShaderResources();
@@ -269,6 +274,22 @@ public:
 					width, height, casWidth, casLevel);
 	}
 
+	// Tone map a high dynamic range source to an 8 bit sRGB destination
+	//     toneMap   - 0 clamp, 1 Reinhard, 2 ACES, 3 BT.2390 (see SpoutCopy.h)
+	//     exposure  - scene value multiplier
+	//     peakNits  - source peak luminance for Reinhard and BT.2390
+	//     bPQ       - source is PQ encoded BT.2020 instead of scRGB
+	bool ToneMap(ID3D11Texture2D* destTexture, ID3D11Texture2D* sourceTexture,
+		DXGI_FORMAT destFormat, DXGI_FORMAT sourceFormat,
+		unsigned int width, unsigned int height,
+		int toneMap, float exposure = 1.0f, float peakNits = 1000.0f, bool bPQ = false)
+	{
+		return ComputeShader(m_ToneMapHLSL, // shader source
+					destTexture, sourceTexture,
+					destFormat, sourceFormat,
+					width, height, (float)toneMap, exposure, peakNits, bPQ ? 1.0f : 0.0f);
+	}
+
 	// Brightness/Contrast/Saturation/Gamma
 	//     Brighness  (-1 to 1), default 0
 	//     Contrast   ( 0 to 2), default 1
@@ -327,6 +348,23 @@ public:
 					width, height);
 	}
 
+	// Rotate clockwise by 90, 180 or 270 degrees
+	//     width, height - source size
+	//     The destination is height x width for 90 and 270 degrees
+	bool Rotate(ID3D11Texture2D* destTexture, ID3D11Texture2D* sourceTexture,
+		DXGI_FORMAT destFormat, DXGI_FORMAT sourceFormat,
+		unsigned int width, unsigned int height,
+		int rotation, bool bSwap = false)
+	{
+		rotation = ((rotation % 360) + 360) % 360;
+		if (rotation % 90 != 0)
+			return false;
+		return ComputeShader(m_RotateHLSL, // shader source
+					destTexture, sourceTexture,
+					destFormat, sourceFormat,
+					width, height, (float)rotation, (float)bSwap);
+	}
+
 
 	// Create a DirectX texture with specific usage, cpu, bind and misc flags 
 	bool CreateDX11Texture(ID3D11Device* pd3dDevice,
@@ -542,6 +580,8 @@ protected:
 			float value1 = 0.0f, float value2 = 0.0f,
 			float value3 = 0.0f, float value4 = 0.0f)
 	{
+		SPOUT_TRACE("spoutDXshaders::ComputeShader");
+
 		// Source texture can be null if reading and writing to dest
 		if (shaderSource.empty() || !destTexture || !m_pd3dDevice)
 			return false;
@@ -565,18 +605,24 @@ protected:
 
 		// Find the shader program from the source passed in
 		ID3D11ComputeShader* shaderProgram = nullptr;
-		if (shaderSource == m_CopyHLSL)         shaderProgram = m_CopyProgram;
-		else if (shaderSource == m_FlipHLSL)    shaderProgram = m_FlipProgram;
-		else if (shaderSource == m_MirrorHLSL)  shaderProgram = m_MirrorProgram;
-		else if (shaderSource == m_SwapHLSL)    shaderProgram = m_SwapProgram;
-		else if (shaderSource == m_BlurHLSL)    shaderProgram = m_BlurProgram;
-		else if (shaderSource == m_SharpenHLSL) shaderProgram = m_SharpenProgram;
-		else if (shaderSource == m_AdjustHLSL)  shaderProgram = m_AdjustProgram;
-		else if (shaderSource == m_TempHLSL)    shaderProgram = m_TempProgram;
-		else if (shaderSource == m_CasHLSL)     shaderProgram = m_CasProgram;
+		const char* shaderName = nullptr; // For trace events
+		if (shaderSource == m_CopyHLSL)         { shaderProgram = m_CopyProgram;    shaderName = "spoutDXshaders::Copy"; }
+		else if (shaderSource == m_FlipHLSL)    { shaderProgram = m_FlipProgram;    shaderName = "spoutDXshaders::Flip"; }
+		else if (shaderSource == m_MirrorHLSL)  { shaderProgram = m_MirrorProgram;  shaderName = "spoutDXshaders::Mirror"; }
+		else if (shaderSource == m_SwapHLSL)    { shaderProgram = m_SwapProgram;    shaderName = "spoutDXshaders::Swap"; }
+		else if (shaderSource == m_BlurHLSL)    { shaderProgram = m_BlurProgram;    shaderName = "spoutDXshaders::Blur"; }
+		else if (shaderSource == m_SharpenHLSL) { shaderProgram = m_SharpenProgram; shaderName = "spoutDXshaders::Sharpen"; }
+		else if (shaderSource == m_AdjustHLSL)  { shaderProgram = m_AdjustProgram;  shaderName = "spoutDXshaders::Adjust"; }
+		else if (shaderSource == m_TempHLSL)    { shaderProgram = m_TempProgram;    shaderName = "spoutDXshaders::Temperature"; }
+		else if (shaderSource == m_CasHLSL)     { shaderProgram = m_CasProgram;     shaderName = "spoutDXshaders::AdaptiveSharpen"; }
+		else if (shaderSource == m_ToneMapHLSL) { shaderProgram = m_ToneMapProgram; shaderName = "spoutDXshaders::ToneMap"; }
+		else if (shaderSource == m_RotateHLSL)  { shaderProgram = m_RotateProgram;  shaderName = "spoutDXshaders::Rotate"; }
 		else
 			return false;
 
+		// Trace the shader from creation to dispatch and flush
+		SPOUT_TRACE(shaderName);
+
 		// Create the compute shader program from source
 		if (!shaderProgram) {
 			shaderProgram = CreateDXcomputeShader(m_pd3dDevice, shaderSource.c_str());
@@ -591,6 +637,8 @@ protected:
 				if (shaderSource == m_AdjustHLSL)  m_AdjustProgram  = shaderProgram;
 				if (shaderSource == m_TempHLSL)    m_TempProgram    = shaderProgram;
 				if (shaderSource == m_CasHLSL)     m_CasProgram     = shaderProgram;
+				if (shaderSource == m_ToneMapHLSL) m_ToneMapProgram = shaderProgram;
+				if (shaderSource == m_RotateHLSL)  m_RotateProgram  = shaderProgram;
 			}
 		}
 
@@ -717,6 +765,8 @@ protected:
 	ID3D11ComputeShader* m_AdjustProgram = nullptr;
 	ID3D11ComputeShader* m_TempProgram = nullptr;
 	ID3D11ComputeShader* m_CasProgram = nullptr;
+	ID3D11ComputeShader* m_ToneMapProgram = nullptr;
+	ID3D11ComputeShader* m_RotateProgram = nullptr;
 	
 	// Shader parameters
 	struct m_ShaderParams
@@ -854,6 +904,57 @@ protected:
 		}
 	)";
 
+	// Rotate clockwise to a destination of the rotated size.
+	// For 90 and 270 degrees a 16x16 tile of the source is transposed
+	// in group shared memory so that adjacent threads write adjacent
+	// destination pixels.
+	const char* m_RotateHLSL = R"(
+		Texture2D<float4> src : register(t0);
+		RWTexture2D<float4> dst : register(u0);
+		cbuffer params : register(b0)
+		{
+			float value1; // rotation degrees
+			float value2; // RGBA <> BGRA swap
+			float value3;
+			float value4;
+			uint width;   // source width
+			uint height;  // source height
+		};
+		groupshared float4 tile[16][16];
+		[numthreads(16, 16, 1)]
+		void CSMain(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
+		{
+			// Load the source tile
+			if (DTid.x < width && DTid.y < height)
+				tile[GTid.y][GTid.x] = src.Load(int3(DTid.xy, 0));
+			GroupMemoryBarrierWithGroupSync();
+
+			// Tile position of the source pixel written by this thread
+			uint2 tpos = GTid.xy;
+			if (value1 == 90.0)
+				tpos = uint2(GTid.y, 15 - GTid.x);
+			else if (value1 == 270.0)
+				tpos = uint2(GTid.y, GTid.x);
+
+			uint2 spos = Gid.xy*16 + tpos;
+			if (spos.x >= width || spos.y >= height)
+				return;
+
+			float4 color = tile[tpos.y][tpos.x];
+			if (value2 == 1.0)
+				color = color.bgra;
+
+			uint2 pos = spos;
+			if (value1 == 90.0)
+				pos = uint2(height - 1 - spos.y, spos.x);
+			else if (value1 == 180.0)
+				pos = uint2(width - 1 - spos.x, height - 1 - spos.y);
+			else if (value1 == 270.0)
+				pos = uint2(spos.y, width - 1 - spos.x);
+			dst[pos] = color;
+		}
+	)";
+
 
 	// Single pass 5x5 blur
 	// Source and destination required for SamplerState
@@ -1049,6 +1150,103 @@ protected:
 
 	)";
 
+	// Tone map high dynamic range source to 8 bit sRGB
+	//     value1 - operator : 0 clamp, 1 Reinhard, 2 ACES, 3 BT.2390
+	//     value2 - exposure
+	//     value3 - source peak luminance (nits)
+	//     value4 - 0 scRGB linear BT.709 (80 nits white)
+	//              1 PQ encoded BT.2020 (203 nits white)
+	const char* m_ToneMapHLSL = R"(
+		Texture2D<float4> src : register(t0);
+		RWTexture2D<float4> dst : register(u0); // UNORM destination
+		cbuffer params : register(b0)
+		{
+			float value1; // operator
+			float value2; // exposure
+			float value3; // peak nits
+			float value4; // PQ
+			uint width;
+			uint height;
+		};
+
+		static const float m1 = 0.1593017578125;
+		static const float m2 = 78.84375;
+		static const float c1 = 0.8359375;
+		static const float c2 = 18.8515625;
+		static const float c3 = 18.6875;
+
+		// PQ signal to nits
+		float3 pq2nits(float3 e)
+		{
+			float3 ep = pow(saturate(e), 1.0/m2);
+			return 10000.0*pow(max(ep - c1, 0.0)/(c2 - c3*ep), 1.0/m1);
+		}
+
+		// Nits to PQ signal
+		float3 nits2pq(float3 n)
+		{
+			float3 yp = pow(max(n, 0.0)/10000.0, m1);
+			return pow((c1 + c2*yp)/(1.0 + c3*yp), m2);
+		}
+
+		// BT.2390 EETF from peak to reference white
+		float3 eetf(float3 L, float peak, float white)
+		{
+			float peakPQ = nits2pq(peak.xxx).x;
+			float maxLum = nits2pq(white.xxx).x/peakPQ;
+			float KS = 1.5*maxLum - 0.5;
+			float3 E = min(nits2pq(L*white)/peakPQ, 1.0);
+			float3 T = saturate((E - KS)/max(1.0 - KS, 1e-5));
+			float3 T2 = T*T;
+			float3 T3 = T2*T;
+			float3 P = (2.0*T3 - 3.0*T2 + 1.0)*KS + (T3 - 2.0*T2 + T)*(1.0 - KS) + (-2.0*T3 + 3.0*T2)*maxLum;
+			E = (E > KS && KS < 1.0) ? P : E;
+			return pq2nits(E*peakPQ)/white;
+		}
+
+		float3 srgb(float3 c)
+		{
+			return (c <= 0.0031308) ? c*12.92 : 1.055*pow(c, 1.0/2.4) - 0.055;
+		}
+
+		[numthreads(16, 16, 1)]
+		void CSMain(uint3 DTid : SV_DispatchThreadID)
+		{
+			if (DTid.x >= width || DTid.y >= height)
+				return;
+
+			float4 c = src.Load(uint3(DTid.xy, 0));
+			float white = (value4 > 0.5) ? 203.0 : 80.0;
+			float peak = max(value3, white);
+
+			// Linear BT.709 relative to reference white
+			float3 L = c.rgb;
+			if (value4 > 0.5) {
+				float3 n = pq2nits(c.rgb)/white;
+				L = float3(
+					 1.6605*n.r - 0.5876*n.g - 0.0728*n.b,
+					-0.1246*n.r + 1.1329*n.g - 0.0083*n.b,
+					-0.0182*n.r - 0.1006*n.g + 1.1187*n.b);
+			}
+			L = max(L*value2, 0.0);
+
+			float3 D = L;
+			if (value1 == 1.0) {
+				float Lw = peak/white;
+				D = L*(1.0 + L/(Lw*Lw))/(1.0 + L);
+			}
+			else if (value1 == 2.0) {
+				float3 x = L*0.6;
+				D = (x*(2.51*x + 0.03))/(x*(2.43*x + 0.59) + 0.14);
+			}
+			else if (value1 == 3.0) {
+				D = eetf(L, peak, white);
+			}
+
+			dst[DTid.xy] = float4(srgb(saturate(D)), saturate(c.a));
+		}
+	)";
+
 	// Brightness/Contrast/Saturation/Gamma
 	//     Brighness  (-1 to 1), default 0
 	//     Contrast   ( 0 to 2), default 1
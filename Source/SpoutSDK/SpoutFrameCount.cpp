@@ -97,6 +97,12 @@
 //		09.05.25	- Add WaitNewFrame - to be tested
 //					  UpdateSenderFps change m_FrameTimeNumber from 8 to 2
 //		06.07.25	- Add GetSenderName
+//		17.10.26	- GetNewFrame, WaitNewFrame, WaitFrameSync, CheckAccess
+//					  use rate-limited SPOUTLOG macros for per-frame failures
+//					- HoldFps, UpdateSenderFps and WaitNewFrame use class timing counts
+//					  instead of the global StartTiming/EndTiming and StartCounter.
+//					- CheckTextureAccess - add trace event
+//					- Read and write "Framecount" with the configuration cache
 //
 // ====================================================================================
 //
@@ -154,10 +160,10 @@ spoutFrameCount::spoutFrameCount()
 	m_PeriodMin = 0; // For setting Windows time period
 	m_bIsNewFrame = true; // Default true for apps without frame count
 
-	// Check the registry setting for frame counting between sender and receiver
+	// Check the user setting for frame counting between sender and receiver
 	m_bFrameCount = false; // default not set
 	DWORD dwFrame = 0;
-	if (ReadDwordFromRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "Framecount", &dwFrame)) {
+	if (ReadSpoutConfigDword("Framecount", &dwFrame)) {
 		m_bFrameCount = (dwFrame == 1);
 	}
 
@@ -191,8 +197,8 @@ spoutFrameCount::spoutFrameCount()
 	*m_FpsStartPtr = *m_FpsEndPtr = std::chrono::steady_clock::now();
 
 #else
-	// Initialize PC msec frequency counter
-	StartCounter();
+	// Independent of the global StartTiming and StartCounter
+	m_FrameStartCount = m_FpsStartCount = GetTimingCount();
 #endif
 
 }
@@ -231,7 +237,7 @@ void spoutFrameCount::SetFrameCount(bool bEnable)
 	if (bEnable) {
 		// Frame counting not already set to registry
 		if (!m_bFrameCount) {
-			WriteDwordToRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "Framecount", 1);
+			WriteSpoutConfigDword("Framecount", 1);
 			m_bFrameCount = true;
 			m_bCountDisabled = false; // Application disable flag
 		}
@@ -244,7 +250,7 @@ void spoutFrameCount::SetFrameCount(bool bEnable)
 			if (IsFrameCountEnabled())
 				CleanupFrameCount();
 		}
-		WriteDwordToRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "Framecount", 0);
+		WriteSpoutConfigDword("Framecount", 0);
 		m_bFrameCount = false;
 		m_bCountDisabled = false;
 	}
@@ -293,8 +299,8 @@ void spoutFrameCount::EnableFrameCount(const char* SenderName)
 	* m_FrameStartPtr = *m_FrameEndPtr = std::chrono::steady_clock::now();
 	*m_FpsStartPtr = *m_FpsEndPtr = std::chrono::steady_clock::now();
 #else
-	// Initialize PC msec frequency counter
-	StartCounter();
+	// Independent of the global StartTiming and StartCounter
+	m_FrameStartCount = m_FpsStartCount = GetTimingCount();
 #endif
 
 	// Return if already enabled for this sender
@@ -472,14 +478,14 @@ void spoutFrameCount::HoldFps(int fps)
 #else
 
 	// Milliseconds elapsed
-	double elapsedTime = EndTiming();
+	const double elapsedTime = GetTimingElapsed(m_FrameStartCount);
 
 	// Sleep to reach the target frame time
 	if (elapsedTime < target)
 		Sleep((DWORD)(target - elapsedTime));
 
 	// Set start time for the next frame
-	StartTiming();
+	m_FrameStartCount = GetTimingCount();
 
 #endif
 
@@ -576,15 +582,15 @@ bool spoutFrameCount::GetNewFrame()
 			// the receiver released it, or increased because the sender
 			// released and incremented it.
 			if (ReleaseSemaphore(m_hCountSemaphore, 1, &framecount) == false) {
-				SpoutLogError("spoutFrameCount::GetNewFrame - ReleaseSemaphore failed");
+				SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::GetNewFrame - ReleaseSemaphore failed");
 				return true; // do not block
 			}
 			break;
 		case WAIT_ABANDONED :
-			SpoutLogWarning("SpoutFrameCount::GetNewFrame - WAIT_ABANDONED");
+			SPOUTLOG_WARNING_LIMIT(1, "SpoutFrameCount::GetNewFrame - WAIT_ABANDONED");
 			break;
 		case WAIT_FAILED :
-			SpoutLogWarning("SpoutFrameCount::GetNewFrame - WAIT_FAILED");
+			SPOUTLOG_WARNING_LIMIT(1, "SpoutFrameCount::GetNewFrame - WAIT_FAILED");
 			break;
 		default :
 			break;
@@ -644,7 +650,8 @@ bool spoutFrameCount::WaitNewFrame(DWORD dwTimeout)
 	StartTimePeriod();
 
 	// Start timeout
-	StartTiming();
+	// A local count so that application StartTiming/EndTiming is not affected
+	const LONGLONG waitStart = GetTimingCount();
 	do {
 		// Access the frame count semaphore
 		// WaitForSingleObject decrements the semaphore's count by one.
@@ -656,14 +663,14 @@ bool spoutFrameCount::WaitNewFrame(DWORD dwTimeout)
 				// The next time round, the count will be increased if the sender
 				// incremented it with SetNewFrame.
 				if (ReleaseSemaphore(m_hCountSemaphore, 1, &framecount) == false) {
-					SpoutLogError("spoutFrameCount::WaitNewFrame - ReleaseSemaphore failed");
+					SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::WaitNewFrame - ReleaseSemaphore failed");
 					return true; // do not block
 				}
 			case WAIT_ABANDONED :
-				SpoutLogWarning("SpoutFrameCount::WaitNewFrame - WAIT_ABANDONED");
+				SPOUTLOG_WARNING_LIMIT(1, "SpoutFrameCount::WaitNewFrame - WAIT_ABANDONED");
 				break;
 			case WAIT_FAILED :
-				SpoutLogWarning("SpoutFrameCount::WaitNewFrame - WAIT_FAILED");
+				SPOUTLOG_WARNING_LIMIT(1, "SpoutFrameCount::WaitNewFrame - WAIT_FAILED");
 				break;
 			default :
 				break;
@@ -691,10 +698,9 @@ bool spoutFrameCount::WaitNewFrame(DWORD dwTimeout)
 			return true;
 		}
 		// Sleep 4 msec (1/4 frame) to prevent high CPU usage
-		// (std::chrono sleep cannot be used because it affects StartTiming and EndTiming)
 		Sleep(4);
 
-	} while (EndTiming() < dwTimeout);
+	} while (GetTimingElapsed(waitStart) < (double)dwTimeout);
 
 	// Wait failed to get a new frame
 	m_bIsNewFrame = false;
@@ -762,6 +768,8 @@ void spoutFrameCount::CleanupFrameCount()
 //
 bool spoutFrameCount::CheckTextureAccess(ID3D11Texture2D* D3D11texture)
 {
+	SPOUT_TRACE("spoutFrameCount::CheckTextureAccess");
+
 	// Test for a keyed mutex.
 	// If no texture was passed in, the function returns false
 	if (IsKeyedMutex(D3D11texture)) {
@@ -897,7 +905,7 @@ bool spoutFrameCount::CheckAccess()
 			// The thread got ownership of the mutex
 			return true;
 		case WAIT_ABANDONED: // 0x00000080L
-			SpoutLogError("spoutFrameCount::CheckAccess - WAIT_ABANDONED");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::CheckAccess - WAIT_ABANDONED");
 			break;
 		case WAIT_TIMEOUT: // 0x00000102L
 			// The time-out interval elapsed, and the object's state is non-signalled.
@@ -906,10 +914,10 @@ bool spoutFrameCount::CheckAccess()
 			break;
 		case WAIT_FAILED: // 0xFFFFFFFF
 			// Could use call GetLastError here
-			SpoutLogError("spoutFrameCount::CheckAccess - WAIT_FAILED");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::CheckAccess - WAIT_FAILED");
 			break;
 		default:
-			SpoutLogError("spoutFrameCount::CheckAccess - unknown error");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::CheckAccess - unknown error");
 			break;
 	}
 
@@ -1014,16 +1022,16 @@ bool spoutFrameCount::WaitFrameSync(const char *sendername, DWORD dwTimeout)
 			bSignal = true;
 			break;
 		case WAIT_ABANDONED:
-			SpoutLogError("spoutFrameCount::WaitFrameSync - WAIT_ABANDONED");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::WaitFrameSync - WAIT_ABANDONED");
 			break;
 		case WAIT_TIMEOUT: // The time-out interval elapsed, and the object's state is non-signalled.
-			SpoutLogWarning("spoutFrameCount::WaitFrameSync - WAIT_TIMEOUT");
+			SPOUTLOG_WARNING_LIMIT(1, "spoutFrameCount::WaitFrameSync - WAIT_TIMEOUT");
 			break;
 		case WAIT_FAILED: // Could use call GetLastError
-			SpoutLogError("spoutFrameCount::WaitFrameSync - WAIT_FAILED");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::WaitFrameSync - WAIT_FAILED");
 			break;
 		default:
-			SpoutLogError("spoutFrameCount::WaitFrameSync - unknown error");
+			SPOUTLOG_ERROR_LIMIT(1, "spoutFrameCount::WaitFrameSync - unknown error");
 			break;
 	}
 
@@ -1173,10 +1181,8 @@ void spoutFrameCount::UpdateSenderFps(long framecount)
 		// Msecs between this frame and the last
 		m_FrameTime = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(*m_FpsEndPtr - *m_FpsStartPtr).count()/1000000.0);
 #else
-		// End time since last call
-		double thisFrame = GetCounter();
 		// Msecs between this frame and the last
-		m_FrameTime = thisFrame - m_lastFrame;
+		m_FrameTime = GetTimingElapsed(m_FpsStartCount);
 #endif
 		
 		if (m_FrameTime > 1.0) { // > 1 msec
@@ -1208,7 +1214,7 @@ void spoutFrameCount::UpdateSenderFps(long framecount)
 #ifdef USE_CHRONO
 		*m_FpsStartPtr = std::chrono::steady_clock::now();
 #else
-		m_lastFrame = thisFrame;
+		m_FpsStartCount = GetTimingCount();
 #endif
 
 	}
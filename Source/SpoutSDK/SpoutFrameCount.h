@@ -191,6 +191,12 @@ protected:
 	std::chrono::steady_clock::time_point* m_FrameStartPtr;
 	std::chrono::steady_clock::time_point* m_FrameEndPtr;
 
+#else
+
+	// Performance counts for HoldFps and sender fps
+	LONGLONG m_FrameStartCount;
+	LONGLONG m_FpsStartCount;
+
 #endif
 
 };
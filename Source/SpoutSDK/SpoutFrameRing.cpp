@@ -0,0 +1,478 @@
+//
+//		spoutFrameRing
+//
+//		Shared memory ring of CPU frames for memory share mode.
+//
+//		A sender writes each frame to the next of a number of slots and
+//		never waits for receivers. Each slot has a sequence number that is
+//		odd while the frame is written, so that receivers can copy the
+//		newest complete frame without locks and detect if it was
+//		overwritten during the copy. A slow receiver skips frames.
+//
+//		Single producer, multiple consumers.
+//
+// ====================================================================================
+//		Revisions :
+//
+//		17.10.26	- Create file
+//					- Receivers keep the ring details when opened. A ring held by a
+//					  receiver is not cleared when created again. Add IsChanged.
+//
+// ====================================================================================
+//
+/*
+	Copyright (c) 2026. Lynn Jarvis. All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without modification, 
+	are permitted provided that the following conditions are met:
+
+		1. Redistributions of source code must retain the above copyright notice, 
+		   this list of conditions and the following disclaimer.
+
+		2. Redistributions in binary form must reproduce the above copyright notice, 
+		   this list of conditions and the following disclaimer in the documentation 
+		   and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"	AND ANY 
+	EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES 
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE	ARE DISCLAIMED. 
+	IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+	PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+	LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "SpoutFrameRing.h"
+
+#include <string>
+
+//
+// Class: spoutFrameRing
+//
+// Shared memory ring of CPU frames.
+//
+//    Sender
+//        ring.Create("Sender", width, height, width*4, DXGI_FORMAT_B8G8R8A8_UNORM);
+//        ring.WriteFrame(pixels);
+//
+//    Receiver
+//        ring.Open("Sender");
+//        if (ring.ReadFrame(pixels)) ...
+//
+// Refer to source code for documentation.
+//
+
+spoutFrameRing::spoutFrameRing()
+{
+
+}
+
+spoutFrameRing::~spoutFrameRing()
+{
+	Close();
+}
+
+//
+// Group: Sender
+//
+
+//---------------------------------------------------------
+// Function: Create
+// Create a ring for frames of the given size.
+//
+//    The map name is the sender name with "_ring" appended.
+//    Pitch is the number of bytes per line.
+//    The format is recorded for receivers.
+bool spoutFrameRing::Create(const char* name, unsigned int width, unsigned int height,
+	unsigned int pitch, DWORD dwFormat, unsigned int slots)
+{
+	if (!name || !*name || width == 0 || height == 0 || pitch == 0 || slots < 2) {
+		SpoutLogError("spoutFrameRing::Create - invalid arguments");
+		return false;
+	}
+
+	Close();
+
+	// Frame data for each slot is aligned to 64 bytes
+	const size_t slotsize = ((size_t)pitch*height + 63) & ~(size_t)63;
+	const size_t headersize = sizeof(SpoutFrameRingHeader) + slots*sizeof(SpoutFrameRingSlot);
+	const size_t mapsize = headersize + slots*slotsize;
+	if (slotsize > MAXDWORD) {
+		SpoutLogError("spoutFrameRing::Create - frame too large");
+		return false;
+	}
+
+	if (!MapRing(name, mapsize, true))
+		return false;
+
+	// A new map is filled with zero. A map still held by a receiver
+	// is not cleared while it is read. The receiver finds that the
+	// generation has changed and opens the ring again.
+	m_pHeader->magic = 0;
+	MemoryBarrier();
+	m_Generation = InterlockedIncrement(&m_pHeader->generation);
+	m_pSlots = reinterpret_cast<SpoutFrameRingSlot*>(m_pMap + sizeof(SpoutFrameRingHeader));
+	m_pData = m_pMap + headersize;
+	for (unsigned int i = 0; i < slots; i++)
+		InterlockedExchange64(&m_pSlots[i].sequence, 0);
+	InterlockedExchange64(&m_pHeader->latest, 0);
+	m_pHeader->slots = slots;
+	m_pHeader->width = width;
+	m_pHeader->height = height;
+	m_pHeader->pitch = pitch;
+	m_pHeader->format = dwFormat;
+	m_pHeader->slotSize = (DWORD)slotsize;
+	m_Slots = slots;
+	m_Width = width;
+	m_Height = height;
+	m_Pitch = pitch;
+	m_Format = dwFormat;
+	m_SlotSize = slotsize;
+	m_bSender = true;
+	m_Frame = 0;
+
+	// Receivers check the magic number last
+	m_pHeader->version = SPOUT_RING_VERSION;
+	MemoryBarrier();
+	m_pHeader->magic = SPOUT_RING_MAGIC;
+
+	SpoutLogNotice("spoutFrameRing::Create - %s_ring %dx%d, %d slots", name, width, height, slots);
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: WriteFrame
+// Write a new frame.
+//
+//    The frame is written to the next slot, overwriting the oldest.
+//    Pitch is the number of bytes per line of the source pixels.
+//    Default is the pitch of the ring.
+bool spoutFrameRing::WriteFrame(const unsigned char* pixels, unsigned int pitch)
+{
+	if (!pixels || !m_bSender || !m_pHeader)
+		return false;
+
+	const unsigned int ringpitch = m_Pitch;
+	if (pitch == 0)
+		pitch = ringpitch;
+
+	const LONG64 frame = m_Frame + 1;
+	const DWORD slot = (DWORD)(frame % m_Slots);
+	SpoutFrameRingSlot* pSlot = &m_pSlots[slot];
+	BYTE* pDest = m_pData + (size_t)slot*m_SlotSize;
+
+	// Odd while the frame is written
+	InterlockedExchange64(&pSlot->sequence, frame*2 - 1);
+
+	if (pitch == ringpitch) {
+		memcpy(pDest, pixels, (size_t)ringpitch*m_Height);
+	}
+	else {
+		const unsigned int linebytes = (pitch < ringpitch) ? pitch : ringpitch;
+		for (unsigned int y = 0; y < m_Height; y++)
+			memcpy(pDest + (size_t)y*ringpitch, pixels + (size_t)y*pitch, linebytes);
+	}
+	pSlot->timestamp = GetTimingCount();
+
+	// Complete, then publish as the newest
+	InterlockedExchange64(&pSlot->sequence, frame*2);
+	InterlockedExchange64(&m_pHeader->latest, frame);
+	m_Frame = frame;
+
+	return true;
+}
+
+//
+// Group: Receiver
+//
+
+//---------------------------------------------------------
+// Function: Open
+// Open a sender's ring
+bool spoutFrameRing::Open(const char* name)
+{
+	if (!name || !*name)
+		return false;
+
+	Close();
+
+	// The size is found from the header
+	if (!MapRing(name, 0, false))
+		return false;
+
+	if (m_MapSize < sizeof(SpoutFrameRingHeader) || m_pHeader->magic != SPOUT_RING_MAGIC
+		|| m_pHeader->version != SPOUT_RING_VERSION) {
+		SpoutLogWarning("spoutFrameRing::Open - %s_ring is not a frame ring", name);
+		Close();
+		return false;
+	}
+
+	// Keep the ring details. The sender can create the ring again
+	// while they are read, so check the generation afterwards.
+	m_Generation = InterlockedCompareExchange(&m_pHeader->generation, 0, 0);
+	m_Slots = m_pHeader->slots;
+	m_Width = m_pHeader->width;
+	m_Height = m_pHeader->height;
+	m_Pitch = m_pHeader->pitch;
+	m_Format = m_pHeader->format;
+	m_SlotSize = m_pHeader->slotSize;
+	MemoryBarrier();
+	if (m_pHeader->magic != SPOUT_RING_MAGIC
+		|| InterlockedCompareExchange(&m_pHeader->generation, 0, 0) != m_Generation) {
+		// Try again next time
+		Close();
+		return false;
+	}
+
+	const size_t headersize = sizeof(SpoutFrameRingHeader) + (size_t)m_Slots*sizeof(SpoutFrameRingSlot);
+	if (m_Slots < 2 || m_Pitch == 0 || m_SlotSize < (size_t)m_Pitch*m_Height
+		|| m_MapSize < headersize + (size_t)m_Slots*m_SlotSize) {
+		SpoutLogWarning("spoutFrameRing::Open - %s_ring is incomplete", name);
+		Close();
+		return false;
+	}
+
+	m_pSlots = reinterpret_cast<SpoutFrameRingSlot*>(m_pMap + sizeof(SpoutFrameRingHeader));
+	m_pData = m_pMap + headersize;
+	m_bSender = false;
+	m_Frame = 0;
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: IsNewFrame
+// Is a newer frame available than the last read
+bool spoutFrameRing::IsNewFrame()
+{
+	if (!m_pHeader)
+		return false;
+	const LONG64 latest = InterlockedCompareExchange64(&m_pHeader->latest, 0, 0);
+	return (latest != 0 && latest != m_Frame);
+}
+
+//---------------------------------------------------------
+// Function: ReadFrame
+// Read the newest complete frame.
+//
+//    Pitch is the number of bytes per line of the destination pixels.
+//    Default is the pitch of the ring.
+//    Returns false if there is no new frame.
+//    If the sender overwrites the frame while it is copied,
+//    the copy is repeated with the newest.
+//    The size is that of the ring when it was opened. Returns false
+//    if the sender has created the ring again (see IsChanged).
+bool spoutFrameRing::ReadFrame(unsigned char* pixels, unsigned int pitch)
+{
+	if (!pixels || m_bSender || !m_pHeader)
+		return false;
+
+	const unsigned int ringpitch = m_Pitch;
+	if (pitch == 0)
+		pitch = ringpitch;
+
+	for (int i = 0; i < 8; i++) {
+
+		if (IsChanged())
+			return false;
+
+		const LONG64 frame = InterlockedCompareExchange64(&m_pHeader->latest, 0, 0);
+		if (frame == 0 || frame == m_Frame)
+			return false;
+
+		const DWORD slot = (DWORD)(frame % m_Slots);
+		SpoutFrameRingSlot* pSlot = &m_pSlots[slot];
+		const BYTE* pSource = m_pData + (size_t)slot*m_SlotSize;
+
+		// The slot has already been re-used for a newer frame
+		if (InterlockedCompareExchange64(&pSlot->sequence, 0, 0) != frame*2)
+			continue;
+
+		if (pitch == ringpitch) {
+			memcpy(pixels, pSource, (size_t)ringpitch*m_Height);
+		}
+		else {
+			const unsigned int linebytes = (pitch < ringpitch) ? pitch : ringpitch;
+			for (unsigned int y = 0; y < m_Height; y++)
+				memcpy(pixels + (size_t)y*pitch, pSource + (size_t)y*ringpitch, linebytes);
+		}
+
+		// The copy is complete if the slot was not written meanwhile
+		// and the ring was not created again
+		if (InterlockedCompareExchange64(&pSlot->sequence, 0, 0) == frame*2 && !IsChanged()) {
+			m_Frame = frame;
+			return true;
+		}
+	}
+
+	SPOUTLOG_WARNING_LIMIT(1, "spoutFrameRing::ReadFrame - frame overwritten during copy");
+
+	return false;
+}
+
+//---------------------------------------------------------
+// Function: IsChanged
+// Has the sender created the ring again since it was opened.
+//
+//    The frame size may have changed. Close and open the ring again.
+bool spoutFrameRing::IsChanged()
+{
+	if (!m_pHeader || m_bSender)
+		return false;
+	return (InterlockedCompareExchange(&m_pHeader->generation, 0, 0) != m_Generation);
+}
+
+//
+// Group: Common
+//
+
+//---------------------------------------------------------
+// Function: Close
+// Close the ring
+void spoutFrameRing::Close()
+{
+	UnmapRing();
+	m_pHeader = nullptr;
+	m_pSlots = nullptr;
+	m_pData = nullptr;
+	m_Frame = 0;
+	m_bSender = false;
+	m_Slots = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_Pitch = 0;
+	m_Format = 0;
+	m_SlotSize = 0;
+	m_Generation = 0;
+}
+
+//---------------------------------------------------------
+// Function: IsOpen
+// Is the ring created or open
+bool spoutFrameRing::IsOpen()
+{
+	return (m_pHeader != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: GetWidth
+unsigned int spoutFrameRing::GetWidth()
+{
+	return m_Width;
+}
+
+//---------------------------------------------------------
+// Function: GetHeight
+unsigned int spoutFrameRing::GetHeight()
+{
+	return m_Height;
+}
+
+//---------------------------------------------------------
+// Function: GetPitch
+unsigned int spoutFrameRing::GetPitch()
+{
+	return m_Pitch;
+}
+
+//---------------------------------------------------------
+// Function: GetFormat
+DWORD spoutFrameRing::GetFormat()
+{
+	return m_Format;
+}
+
+//---------------------------------------------------------
+// Function: GetFrame
+// Number of the last frame written or read
+LONG64 spoutFrameRing::GetFrame()
+{
+	return m_Frame;
+}
+
+//
+// Protected
+//
+
+//
+// Create or open the shared memory.
+// For open, the size is found from the mapped view.
+//
+bool spoutFrameRing::MapRing(const char* name, size_t size, bool bCreate)
+{
+	std::string mapname = name;
+	mapname += "_ring";
+	bool bExists = false;
+
+	if (bCreate) {
+		m_hMap = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+			(DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF), mapname.c_str());
+		// A receiver may still hold the ring of a previous sender
+		// of the same name. It is used if it is large enough.
+		bExists = (m_hMap && GetLastError() == ERROR_ALREADY_EXISTS);
+		SetLastError(NO_ERROR);
+	}
+	else {
+		m_hMap = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mapname.c_str());
+	}
+
+	if (!m_hMap) {
+		if (bCreate)
+			SpoutLogError("spoutFrameRing::MapRing - could not create %s", mapname.c_str());
+		return false;
+	}
+
+	m_pMap = static_cast<BYTE*>(MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	if (!m_pMap) {
+		SpoutLogError("spoutFrameRing::MapRing - could not map %s", mapname.c_str());
+		CloseHandle(m_hMap);
+		m_hMap = NULL;
+		return false;
+	}
+
+	if (bCreate && !bExists) {
+		m_MapSize = size;
+	}
+	else {
+		// OpenFileMapping does not return the size. Use the mapped view.
+		MEMORY_BASIC_INFORMATION mbi={};
+		VirtualQuery(m_pMap, &mbi, sizeof(mbi));
+		m_MapSize = mbi.RegionSize;
+		if (bCreate && m_MapSize < size) {
+			// The sender tries again each frame while a receiver holds the map
+			if (m_SmallMapSize != size || strcmp(m_SmallMapName, mapname.c_str()) != 0) {
+				SpoutLogWarning("spoutFrameRing::MapRing - %s exists with a smaller size", mapname.c_str());
+				strncpy_s(m_SmallMapName, 256, mapname.c_str(), _TRUNCATE);
+				m_SmallMapSize = size;
+			}
+			UnmapRing();
+			return false;
+		}
+	}
+	m_SmallMapSize = 0;
+	m_SmallMapName[0] = 0;
+
+	m_pHeader = reinterpret_cast<SpoutFrameRingHeader*>(m_pMap);
+
+	return true;
+}
+
+//
+// Close the shared memory
+//
+void spoutFrameRing::UnmapRing()
+{
+	if (m_pMap) {
+		UnmapViewOfFile(m_pMap);
+		m_pMap = nullptr;
+	}
+	if (m_hMap) {
+		CloseHandle(m_hMap);
+		m_hMap = NULL;
+	}
+	m_MapSize = 0;
+}
@@ -0,0 +1,156 @@
+/*
+
+	SpoutFrameRing.h
+
+	Shared memory ring of CPU frames for memory share mode
+
+	- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+	Copyright (c) 2026, Lynn Jarvis. All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without modification, 
+	are permitted provided that the following conditions are met:
+
+		1. Redistributions of source code must retain the above copyright notice, 
+		   this list of conditions and the following disclaimer.
+
+		2. Redistributions in binary form must reproduce the above copyright notice, 
+		   this list of conditions and the following disclaimer in the documentation 
+		   and/or other materials provided with the distribution.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"	AND ANY 
+	EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES 
+	OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE	ARE DISCLAIMED. 
+	IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+	INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+	PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+	LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+
+#ifndef __spoutFrameRing__
+#define __spoutFrameRing__
+
+#include "SpoutCommon.h"
+
+using namespace spoututils;
+
+#define SPOUT_RING_MAGIC    0x474E5253 // "SRNG"
+#define SPOUT_RING_VERSION  1
+#define SPOUT_RING_SLOTS    4 // Default number of frame slots
+
+//
+// Shared memory layout
+//
+// The ring header is followed by the slot headers and then
+// the frame data for each slot, aligned to 64 bytes.
+// Only fixed size types and aligned 64 bit values are used
+// so that the layout is the same for 32 and 64 bit processes.
+//
+struct SpoutFrameRingHeader {
+	DWORD magic; // SPOUT_RING_MAGIC
+	DWORD version; // SPOUT_RING_VERSION
+	DWORD slots; // Number of frame slots
+	DWORD width; // Frame width
+	DWORD height; // Frame height
+	DWORD pitch; // Bytes per line
+	DWORD format; // Pixel format (DXGI_FORMAT for spoutDX)
+	DWORD slotSize; // Bytes of frame data for each slot
+	volatile LONG64 latest; // Number of the newest complete frame. Zero for none.
+	volatile LONG generation; // Incremented each time the ring is created
+	BYTE reserved[20];
+};
+
+struct SpoutFrameRingSlot {
+	volatile LONG64 sequence; // Frame number * 2. Odd while the frame is written.
+	LONG64 timestamp; // Performance count when written
+	BYTE reserved[48];
+};
+
+class SPOUT_DLLEXP spoutFrameRing {
+
+	public:
+
+	spoutFrameRing();
+	~spoutFrameRing();
+
+	//
+	// Sender
+	//
+
+	// Create a ring for frames of the given size.
+	// Pitch is the number of bytes per line.
+	bool Create(const char* name, unsigned int width, unsigned int height,
+		unsigned int pitch, DWORD dwFormat, unsigned int slots = SPOUT_RING_SLOTS);
+	// Write a new frame. Never waits for receivers.
+	bool WriteFrame(const unsigned char* pixels, unsigned int pitch = 0);
+
+	//
+	// Receiver
+	//
+
+	// Open a sender's ring
+	bool Open(const char* name);
+	// Is a newer frame available than the last read
+	bool IsNewFrame();
+	// Read the newest complete frame.
+	// Returns false if there is no new frame.
+	bool ReadFrame(unsigned char* pixels, unsigned int pitch = 0);
+	// Has the sender created the ring again since it was opened
+	bool IsChanged();
+
+	//
+	// Common
+	//
+
+	// Close the ring
+	void Close();
+	// Is the ring created or open
+	bool IsOpen();
+	// Frame details
+	unsigned int GetWidth();
+	unsigned int GetHeight();
+	unsigned int GetPitch();
+	DWORD GetFormat();
+	// Number of the last frame written or read
+	LONG64 GetFrame();
+
+	protected:
+
+	// Platform specific shared memory.
+	// The protocol only needs a mapping shared between processes
+	// and 64 bit atomic operations, so the equivalent for POSIX
+	// is shm_open, ftruncate and mmap with __atomic builtins.
+	bool MapRing(const char* name, size_t size, bool bCreate);
+	void UnmapRing();
+
+	HANDLE m_hMap = NULL;
+	BYTE* m_pMap = nullptr;
+	size_t m_MapSize = 0;
+	SpoutFrameRingHeader* m_pHeader = nullptr;
+	SpoutFrameRingSlot* m_pSlots = nullptr;
+	BYTE* m_pData = nullptr;
+	LONG64 m_Frame = 0; // Last frame written or read
+	bool m_bSender = false;
+
+	// Ring details when created or opened.
+	// The shared header can be re-written by a new sender
+	// of the same name, so receivers use these instead.
+	unsigned int m_Slots = 0;
+	unsigned int m_Width = 0;
+	unsigned int m_Height = 0;
+	unsigned int m_Pitch = 0;
+	DWORD m_Format = 0;
+	size_t m_SlotSize = 0;
+	LONG m_Generation = 0;
+
+	// Map found too small by Create, to warn only once
+	char m_SmallMapName[256]={};
+	size_t m_SmallMapSize = 0;
+
+};
+
+#endif
@@ -110,6 +110,8 @@
 	Version 2.007.014
 	20.06.24 - Add GetSenderIndex
 	23.08.24 - GetSenderInfo, SetSenderID - initialize SharedTextureInfo
+	17.10.26 - getSharedInfo - add trace event
+			   Read and write "MaxSenders" with the configuration cache
 
 
 	- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -155,10 +157,10 @@ spoutSenderNames::spoutSenderNames() {
 	// 15.09.18 - moved from interop class
 	// 06.06.19 - increase default maximum number of senders from 10 to 256
 	// 28.08.20 - decreased from 256 to 64
-	// Read the registry key if it exists
+	// Read the user setting if it exists
 	DWORD dwSenders = 64; // default maximum number of senders.
-	ReadDwordFromRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "MaxSenders", &dwSenders);
-	// If the registry read fails, the default will be used
+	ReadSpoutConfigDword("MaxSenders", &dwSenders);
+	// If the read fails, the default will be used
 	m_MaxSenders = (int)dwSenders;
 
 }
@@ -555,8 +557,8 @@ void spoutSenderNames::SetMaxSenders(int maxSenders)
 {
 	SpoutLogNotice("spoutSenderNames::SetMaxSenders - Setting max senders to %d", maxSenders);
 	m_MaxSenders = maxSenders;
-	// Set to the registry so that other applications will read the new maximum size
-	WriteDwordToRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "MaxSenders", (DWORD)maxSenders);
+	// Save the setting so that other applications will read the new maximum size
+	WriteSpoutConfigDword("MaxSenders", (DWORD)maxSenders);
 }
 
 int spoutSenderNames::GetMaxSenders()
@@ -1261,6 +1263,8 @@ bool spoutSenderNames::getActiveSenderName(char *SenderName, const int maxchars)
 // so the creation pointer and handle may not be known
 bool spoutSenderNames::getSharedInfo(const char* sharedMemoryName, SharedTextureInfo* info) 
 {
+	SPOUT_TRACE("spoutSenderNames::getSharedInfo");
+
 	SpoutSharedMemory mem;
 	// Open is possibly faster than Create because the function is called all the time
 	if(mem.Open(sharedMemoryName)) {
@@ -240,6 +240,28 @@
 		13.05.25 - Use a local file pointer for freopen_s with AllocConsole
 				   if "standaloneutils" is defined to avoid crash - unknown cause
 		25.05.25 - Add print option to EndTiming
+		17.10.26 - _doLog - check log level before formatting the log.
+				   Console log prints the formatted string instead of re-using va_list.
+				   Add EnableSpoutLogAsync, LogAsyncEnabled and FlushSpoutLog
+				   for lock-free queued logs written by a background thread.
+				 - Add SpoutLogLevelEnabled, SpoutLogLimited and SPOUTLOG macros
+				   for compile-time, lazy and rate-limited logs in time-critical code.
+				 - StartTiming/EndTiming start point is per thread.
+				   Add GetTimingCount and GetTimingElapsed for independent timing.
+				   Add timing histograms and spoutScopedTimer (SPOUT_TIMER macro).
+				 - Add trace events with Chrome trace JSON export (SPOUT_TRACE macros).
+				 - Add flight recorder of recent logs and trace events
+				   written on demand or for an unhandled exception.
+				 - Add configuration cache with registry, INI file, environment
+				   and application sources. GetSpoutVersion uses the cache.
+				 - Add CloseSpoutLog to stop the log thread before a dll unloads.
+				   The log thread is not joined during static destruction.
+				 - Configuration state is created on first use for global objects
+				   of other modules. A watched source stays watched when changed.
+				 - The log thread holds its own reference to the log file state.
+				 - The flight recorder retains warnings and errors by default.
+				 - Registry change notification is thread agnostic. The watch
+				   decision is made by _configWatchAction without system calls.
 
 */
 
@@ -275,9 +297,192 @@ namespace spoututils {
 	char logChars[1024]={}; // The current log string
 	bool bConsole = false;
 #ifdef USE_CHRONO
-	std::chrono::steady_clock::time_point start;
-	std::chrono::steady_clock::time_point end;
+	// StartTiming/EndTiming start point for each thread
+	thread_local std::chrono::steady_clock::time_point start;
+	thread_local std::chrono::steady_clock::time_point end;
+
+	// Asynchronous logging
+	// A bounded ring of log records shared by all producer threads.
+	// Each record carries a sequence number so that producers claim
+	// a slot with a single compare-exchange and the log thread can
+	// tell when the record is complete (Vyukov bounded queue).
+	struct asyncLogRecord {
+		std::atomic<size_t> sequence;
+		SpoutLogLevel level;
+		char text[1024];
+	};
+	const size_t asyncLogSize = 256; // Must be a power of 2
+	asyncLogRecord* asyncLogRing = nullptr;
+	std::atomic<size_t> asyncLogHead(0); // Next record for the log thread
+	std::atomic<size_t> asyncLogTail(0); // Next record for producers
+	std::atomic<size_t> asyncLogDone(0); // Records written by the log thread
+	std::atomic<unsigned int> asyncLogDropped(0); // Logs lost with the ring full
+	std::atomic<bool> bAsyncLog(false);
+	std::atomic<bool> bAsyncWaiting(false);
+	HANDLE hAsyncLogEvent = NULL;
+	HANDLE hAsyncLogStopped = NULL; // Set by the log thread after its last write
+	std::thread asyncLogThread;
+	// The log file used by the log thread. The thread holds its own
+	// reference, so the state remains valid if the thread is still
+	// running when static objects are destroyed.
+	struct asyncLogFileState {
+		std::mutex mutex; // Protects the paths and the file
+		std::ofstream file; // Remains open while logging asynchronously
+		std::string openPath; // Path of the open file
+		std::string logPath; // Copy of logPath for the log thread
+	};
+	namespace {
+		// Created on first use, as for the configuration state
+		const std::shared_ptr<asyncLogFileState>& _asyncLogState()
+		{
+			static const std::shared_ptr<asyncLogFileState> state = std::make_shared<asyncLogFileState>();
+			return state;
+		}
+	}
+	// Timing histograms
+	// Each thread records into its own block so that samples are added
+	// without locks. The blocks are merged when statistics are read.
+	// Buckets are half-octaves of nanoseconds from 256 nsec.
+	const int maxTimingHistograms = 32;
+	const int timingBuckets = 64;
+	struct timingBins {
+		std::atomic<unsigned long long> count;
+		std::atomic<unsigned long long> total; // nanoseconds
+		std::atomic<unsigned long long> min;
+		std::atomic<unsigned long long> max;
+		std::atomic<unsigned long long> bucket[timingBuckets];
+	};
+	struct timingThreadBlock {
+		timingBins bins[maxTimingHistograms];
+		timingThreadBlock* next;
+	};
+	std::atomic<timingThreadBlock*> timingThreads(nullptr); // All thread blocks
+	thread_local timingThreadBlock* timingBlock = nullptr; // Block for this thread
+	char timingNames[maxTimingHistograms][128]={};
+	std::atomic<int> timingHistogramCount(0);
+	std::mutex timingNameMutex; // For histogram creation only
+	std::atomic<bool> bTimingEnabled(false);
+
+	// Trace events
+	// Each thread records into its own ring of events without locks.
+	// The oldest events are overwritten when a ring is full.
+	struct traceEvent {
+		const char* name;
+		LONGLONG timestamp; // Performance count
+		LONGLONG duration; // Performance count for complete events
+		double value; // Counter value
+		char phase; // 'B' begin, 'E' end, 'X' complete, 'C' counter
+	};
+	const size_t traceRingSize = 2048; // Events for each thread. Must be a power of 2
+	struct traceThreadRing {
+		traceEvent events[traceRingSize];
+		std::atomic<size_t> head; // Total events recorded
+		DWORD threadId;
+		traceThreadRing* next;
+	};
+	std::atomic<traceThreadRing*> traceThreads(nullptr); // All thread rings
+	thread_local traceThreadRing* traceRing = nullptr; // Ring for this thread
+	std::atomic<bool> bTraceEnabled(false);
+	LONGLONG traceStart = 0; // Performance count when tracing was enabled
+
+	// Flight recorder
+	// A fixed ring of recent logs and trace events shared by all threads.
+	// Writers claim a position with one atomic increment and overwrite the oldest.
+	// Each record has its own sequence so that a record being written
+	// is skipped when the ring is written out, even from a crash handler,
+	// and two writers are never in the same record after the ring wraps.
+	// Trace events are binary and only formatted when written out.
+	// Logs are formatted when they are added, because arguments such as
+	// strings may not remain valid until the ring is written out.
+	struct flightRecord {
+		std::atomic<size_t> sequence; // 2*position + 1 while written, 2*position + 2 when complete
+		LONGLONG timestamp; // Performance count
+		LONGLONG duration; // Performance count for complete events
+		double value; // Counter value
+		const char* name; // Trace event name
+		DWORD threadId;
+		SpoutLogLevel level;
+		char type; // 'L' log or trace event phase
+		char text[256]; // Log text
+	};
+	const size_t flightRingSize = 1024; // Must be a power of 2
+	flightRecord* flightRing = nullptr; // Retained for a crash handler
+	std::atomic<size_t> flightHead(0); // Total records
+	std::atomic<bool> bFlightEnabled(false);
+	SpoutLogLevel flightLevel = SPOUT_LOG_WARNING;
+	LONGLONG flightStart = 0; // Performance count when the recorder was enabled
+	char flightPath[MAX_PATH]={}; // Default file, prepared before a crash
+	bool bFlightCrashDump = false;
+	LPTOP_LEVEL_EXCEPTION_FILTER flightPrevFilter = nullptr;
+	void (__cdecl *flightPrevAbort)(int) = nullptr;
+	volatile LONG flightWriting = 0; // One writer at a time
+
+	namespace {
+		timingThreadBlock* _newTimingBlock();
+		void _clearTimingBlock(timingThreadBlock* block);
+		int _timingBucket(unsigned long long ns);
+		double _timingBucketLimit(int bucket);
+		traceThreadRing* _newTraceRing();
+		void _addFlightLog(SpoutLogLevel level, const char* format, va_list args);
+		void _addFlightEvent(char phase, const char* name, LONGLONG timestamp, LONGLONG duration, double value);
+		bool _writeFlightRecorder(const char* filepath, DWORD exceptionCode);
+		LONG WINAPI _flightExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo);
+		void __cdecl _flightAbortHandler(int sig);
+		void _asyncLogThread(std::shared_ptr<asyncLogFileState> state);
+	}
+
+	// If the log thread is still running during static destruction,
+	// it cannot be joined. In a dll this is within the loader lock,
+	// which the thread needs to exit. Wait for the thread to finish
+	// writing instead and detach it. If the wait times out, the thread
+	// only uses the ring, which is never freed, and its own reference
+	// to the file state. If the process is terminating, the thread has
+	// already stopped. See CloseSpoutLog.
+	struct asyncLogClose {
+		~asyncLogClose() {
+			if (!asyncLogThread.joinable())
+				return;
+			if (WaitForSingleObject(asyncLogThread.native_handle(), 0) != WAIT_OBJECT_0) {
+				bAsyncLog = false;
+				if (hAsyncLogEvent)
+					SetEvent(hAsyncLogEvent);
+				if (hAsyncLogStopped)
+					WaitForSingleObject(hAsyncLogStopped, 1000);
+			}
+			asyncLogThread.detach();
+		}
+	} asyncLogCloser;
 #endif
+	// Configuration cache
+	// Settings are loaded from the source once and then read from memory.
+	// Names are not case sensitive and are saved in lower case.
+	struct spoutConfigState {
+		SpoutConfigSource source = SPOUT_CONFIG_REGISTRY;
+		std::string path; // INI file for SPOUT_CONFIG_FILE
+		SpoutConfigReader reader = nullptr; // For SPOUT_CONFIG_CUSTOM
+		std::map<std::string, std::string> values;
+		volatile LONG loaded = 0;
+		bool bWatch = false;
+		HANDLE hChange = NULL; // Registry or folder change notification
+		HKEY hKey = NULL; // Registry key watched for changes
+		SRWLOCK lock = SRWLOCK_INIT;
+	};
+	const char* configSubkey = "Software\\Leading Edge\\Spout";
+#ifndef REG_NOTIFY_THREAD_AGNOSTIC
+#define REG_NOTIFY_THREAD_AGNOSTIC 0x10000000L // Windows 8 and later
+#endif
+
+	namespace {
+		// Settings can be read by constructors of global objects in
+		// other modules, before the globals of this module exist.
+		// The state is created on first use.
+		spoutConfigState& _config()
+		{
+			static spoutConfigState config;
+			return config;
+		}
+	}
+
 	// PC timer
 	double PCFreq = 0.0;
 	__int64 CounterStart = 0;
@@ -320,7 +525,7 @@ namespace spoututils {
 	std::string GetSpoutVersion(int * number) {
 		std::string vstr;
 		DWORD dwVers = 0;
-		if (ReadDwordFromRegistry(HKEY_CURRENT_USER, "Software\\Leading Edge\\Spout", "Version", &dwVers)) {
+		if (ReadSpoutConfigDword("Version", &dwVers)) {
 			// Create version string e.g. 2.006, 2.007, 2.007.009
 			std::string str = std::to_string(dwVers);
 			// 2006, 2007, 2007009
@@ -658,6 +863,13 @@ namespace spoututils {
 	// You can find and examine the log file after the application has run.
 	void EnableSpoutLogFile(const char* filename, bool bAppend)
 	{
+#ifdef USE_CHRONO
+		// Wait for the log thread to finish with the current file
+		asyncLogFileState& state = *_asyncLogState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.file.is_open())
+			state.file.close();
+#endif
 		bEnableLogFile = true;
 		if (!logPath.empty()) {
 			if (logFile.is_open())
@@ -670,6 +882,9 @@ namespace spoututils {
 		logPath = _getLogFilePath(filename);
 
 		_logtofile(bAppend);
+#ifdef USE_CHRONO
+		state.logPath = logPath;
+#endif
 
 	}
 
@@ -677,6 +892,13 @@ namespace spoututils {
 	// Function: DisableSpoutLogFile
 	// Disable logging to file
 	void DisableSpoutLogFile() {
+#ifdef USE_CHRONO
+		asyncLogFileState& state = *_asyncLogState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.file.is_open())
+			state.file.close();
+		state.logPath.clear();
+#endif
 		if (!logPath.empty()) {
 			if (logFile.is_open())
 				logFile.close();
@@ -710,6 +932,8 @@ namespace spoututils {
 	// Disable logging to console and file
 	void DisableSpoutLog()
 	{
+		// Write any queued logs and stop the log thread
+		EnableSpoutLogAsync(false);
 		CloseSpoutConsole();
 		if (!logPath.empty()) {
 			if (logFile.is_open())
@@ -768,6 +992,9 @@ namespace spoututils {
 		std::string logstr = "";
 		std::string path;
 
+		// Include logs still queued for the log thread
+		FlushSpoutLog();
+
 		// Check for specified log file path
 		if (filepath && *filepath != 0) {
 			path = _getLogFilePath(filepath);
@@ -832,6 +1059,100 @@ namespace spoututils {
 		CurrentLogLevel = level;
 	}
 
+	// ---------------------------------------------------------
+	// Function: EnableSpoutLogAsync
+	// Enable or disable asynchronous logging
+	//
+	// Logs are formatted directly into a lock-free ring by the calling
+	// thread and a background thread writes them to the console and
+	// to a log file that remains open. Useful where logs are produced
+	// in time-critical code or from several threads.
+	//
+	// If the ring is full, the log is dropped and a count of
+	// dropped logs is shown when the log thread catches up.
+	//
+	// Disable before the application closes, or call CloseSpoutLog
+	// or DisableSpoutLog, so that queued logs are written.
+	//
+	// Requires std::chrono. Logs remain synchronous otherwise.
+	void EnableSpoutLogAsync(bool bAsync)
+	{
+#ifdef USE_CHRONO
+		if (bAsync) {
+			if (bAsyncLog)
+				return;
+			if (!asyncLogRing) {
+				// Allocated once and retained, because producers
+				// could still be writing after the log thread stops.
+				asyncLogRing = new asyncLogRecord[asyncLogSize];
+				for (size_t i = 0; i < asyncLogSize; i++)
+					asyncLogRing[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			if (!hAsyncLogEvent)
+				hAsyncLogEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+			if (!hAsyncLogStopped)
+				hAsyncLogStopped = CreateEventA(NULL, TRUE, FALSE, NULL);
+			ResetEvent(hAsyncLogStopped);
+			bAsyncLog = true;
+			asyncLogThread = std::thread(_asyncLogThread, _asyncLogState());
+		}
+		else {
+			if (!bAsyncLog)
+				return;
+			// The log thread writes any remaining logs and exits
+			bAsyncLog = false;
+			if (hAsyncLogEvent)
+				SetEvent(hAsyncLogEvent);
+			if (asyncLogThread.joinable())
+				asyncLogThread.join();
+		}
+#else
+		UNREFERENCED_PARAMETER(bAsync);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: LogAsyncEnabled
+	// Is asynchronous logging enabled
+	bool LogAsyncEnabled()
+	{
+#ifdef USE_CHRONO
+		return bAsyncLog;
+#else
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: CloseSpoutLog
+	// Write queued asynchronous logs and stop the log thread.
+	//
+	// Call before the application closes or a dll using SpoutUtils
+	// is unloaded. The thread cannot be stopped safely from static
+	// destructors, so logs still queued then could be lost.
+	// Log settings are retained and logs after this are synchronous.
+	void CloseSpoutLog()
+	{
+		EnableSpoutLogAsync(false);
+	}
+
+	// ---------------------------------------------------------
+	// Function: FlushSpoutLog
+	// Wait for queued asynchronous logs to be written.
+	// Returns after one second if the log thread does not respond.
+	void FlushSpoutLog()
+	{
+#ifdef USE_CHRONO
+		if (!bAsyncLog)
+			return;
+		const size_t queued = asyncLogTail.load();
+		for (int i = 0; i < 1000 && asyncLogDone.load() < queued; i++) {
+			SetEvent(hAsyncLogEvent);
+			Sleep(1);
+		}
+#endif
+	}
+
 
 	// ---------------------------------------------------------
 	// Function: SpoutLog
@@ -873,11 +1194,8 @@ namespace spoututils {
 	{
 		va_list args;
 		va_start(args, format);
-		// Show warning text bright yellow
-		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-		SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY);
+		// Warning text is shown bright yellow by _doLog
 		_doLog(SPOUT_LOG_WARNING, format, args);
-		SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
 		va_end(args);
 	}
 
@@ -914,68 +1232,128 @@ namespace spoututils {
 		if (!format)
 			return;
 
+#ifdef USE_CHRONO
+		// The flight recorder retains logs whether or not they are shown
+		if (bFlightEnabled.load(std::memory_order_relaxed)
+			&& level != SPOUT_LOG_SILENT && level >= flightLevel) {
+			va_list flightargs;
+			va_copy(flightargs, args);
+			_addFlightLog(level, format, flightargs);
+			va_end(flightargs);
+		}
+#endif
+
+		// Check the level before the log is formatted
+		if (!_logShown(level))
+			return;
+
+#ifdef USE_CHRONO
+		// Asynchronous logging
+		if (bAsyncLog) {
+			if (!_pushAsyncLog(level, format, args))
+				asyncLogDropped++;
+			// Make sure that a fatal log is written
+			if (level == SPOUT_LOG_FATAL)
+				FlushSpoutLog();
+			return;
+		}
+#endif
+
 		char currentLog[1024]={}; // allow more than the name length
 
 		// Construct the current log
 		vsprintf_s(currentLog, 1024, format, args);
 
-		// Return if logging is paused
-		if (!bDoLogs)
+		// Prevent multiple logs by comparing with the last
+		if (strcmp(currentLog, logChars) == 0) {
 			return;
+		}
 
-		if (level != SPOUT_LOG_SILENT
-			&& CurrentLogLevel != SPOUT_LOG_SILENT
-			&& level >= CurrentLogLevel
-			&& format != nullptr) {
-
-			// Prevent multiple logs by comparing with the last
-			if (strcmp(currentLog, logChars) == 0) {
-				// Save the current log as the last
-				strcpy_s(logChars, 1024, currentLog);
-				return;
-			}
+		// Save the current log as the last
+		strcpy_s(logChars, 1024, currentLog);
 
-			// Save the current log as the last
-			strcpy_s(logChars, 1024, currentLog);
+		// Console logging
+		if (bConsole && bEnableLog) {
+			_logtoconsole(level, currentLog);
+		} // end console log
 
-			// Console logging
-			if (bConsole && bEnableLog) {
-				// Yellow text for warnings and errors
-				HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-				FILE* out = stdout; // Console output
-				if (level == SPOUT_LOG_WARNING || level == SPOUT_LOG_ERROR)
-					SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY);
-				if (level != SPOUT_LOG_NONE) {
-					// Show log level
-					fprintf(out, "[%s] ", _levelName(level).c_str());
-				}
-				// The log
-				vfprintf(out, format, args);
-				// Newline
-				fprintf(out, "\n");
-				// Reset white text
-				SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-			} // end console log
-
-			// File logging
-			if (bEnableLogFile && !logPath.empty()) {
-				// Log file output
-				// Append to the the current log file so it remains closed
-				// No verbose logs for log to file
-				if (level != SPOUT_LOG_VERBOSE) {
-					logFile.open(logPath, logFile.app);
-					if (logFile.is_open()) {
-						if (level != SPOUT_LOG_NONE) {
-							// Show log level
-							logFile << "[" << _levelName(level).c_str()  << "] ";
-						}
-						// The log and newline
-						logFile << currentLog << std::endl;
+		// File logging
+		if (bEnableLogFile && !logPath.empty()) {
+			// Log file output
+			// Append to the the current log file so it remains closed
+			// No verbose logs for log to file
+			if (level != SPOUT_LOG_VERBOSE) {
+				logFile.open(logPath, logFile.app);
+				if (logFile.is_open()) {
+					if (level != SPOUT_LOG_NONE) {
+						// Show log level
+						logFile << "[" << _levelName(level).c_str()  << "] ";
 					}
-					logFile.close();
+					// The log and newline
+					logFile << currentLog << std::endl;
 				}
-			} // end file log
+				logFile.close();
+			}
+		} // end file log
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutLogLevelEnabled
+	// Would a log of this level be shown
+	//
+	// Used by the SPOUTLOG macros to avoid evaluating
+	// arguments for logs that would not be shown
+	// or retained by the flight recorder.
+	bool SpoutLogLevelEnabled(SpoutLogLevel level)
+	{
+#ifdef USE_CHRONO
+		if (bFlightEnabled.load(std::memory_order_relaxed)
+			&& level != SPOUT_LOG_SILENT && level >= flightLevel)
+			return true;
+#endif
+		return _logShown(level);
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutLogLimited
+	// Log limited to a number per second
+	//
+	// Used by the SPOUTLOG_LIMIT macros with a static limit for each call site.
+	// Logs over the limit are counted but not formatted. The next log
+	// shown after a suppressed period reports the number suppressed.
+	void SpoutLogLimited(SpoutLogLimit* limit, SpoutLogLevel level, const char* format, ...)
+	{
+		if (!limit || !format)
+			return;
+
+		// Start a new period each second
+		LONG suppressed = 0;
+		const LONG now = (LONG)GetTickCount();
+		const LONG start = limit->start;
+		if ((DWORD)(now - start) >= 1000 || limit->count == 0) {
+			// Only one thread resets the period
+			if (InterlockedCompareExchange(&limit->start, now, start) == start) {
+				InterlockedExchange(&limit->count, 0);
+				suppressed = InterlockedExchange(&limit->suppressed, 0);
+			}
+		}
+
+		if (InterlockedIncrement(&limit->count) > limit->maxcount) {
+			InterlockedExchangeAdd(&limit->suppressed, suppressed + 1);
+			return;
+		}
+
+		va_list args;
+		va_start(args, format);
+		if (suppressed > 0) {
+			char currentLog[1024]={};
+			vsprintf_s(currentLog, 1024, format, args);
+			_doLogArgs(level, "%s (%ld similar logs suppressed)", currentLog, suppressed);
+		}
+		else {
+			_doLog(level, format, args);
 		}
+		va_end(args);
 	}
 
 	// ---------------------------------------------------------
@@ -1540,6 +1918,191 @@ namespace spoututils {
 
 	}
 
+	//
+	// Group: Configuration
+	//
+	// Spout settings are read from a single process-wide cache
+	// instead of each object reading the registry.
+	//
+	// The default source is the registry key used by SpoutSettings.
+	// An INI file, environment variables or an application function
+	// can be used instead, for example for a portable installation.
+	//
+	//    SetSpoutConfigSource(SPOUT_CONFIG_FILE, "C:\\Spout\\spout.ini");
+	//
+	//    [Spout]
+	//    MaxSenders=64
+	//    Framecount=1
+	//
+	// Environment variable names are the setting name
+	// with a "SPOUT_" prefix, for example SPOUT_MAXSENDERS=64.
+	//
+
+	// ---------------------------------------------------------
+	// Function: SetSpoutConfigSource
+	// Select the source of settings.
+	//
+	// Settings are loaded from the new source on the next read.
+	// If the source is watched for changes, the new source is watched.
+	void SetSpoutConfigSource(SpoutConfigSource source, const char* filepath)
+	{
+		spoutConfigState& config = _config();
+		AcquireSRWLockExclusive(&config.lock);
+		_watchConfig(false);
+		config.source = source;
+		config.path = filepath ? filepath : "";
+		if (config.bWatch)
+			_watchConfig(true);
+		InterlockedExchange(&config.loaded, 0);
+		ReleaseSRWLockExclusive(&config.lock);
+	}
+
+	// ---------------------------------------------------------
+	// Function: SetSpoutConfigReader
+	// Use an application function to read settings.
+	//
+	// The function is called once for each setting that is read.
+	void SetSpoutConfigReader(SpoutConfigReader reader)
+	{
+		spoutConfigState& config = _config();
+		AcquireSRWLockExclusive(&config.lock);
+		_watchConfig(false);
+		config.source = SPOUT_CONFIG_CUSTOM;
+		config.reader = reader;
+		InterlockedExchange(&config.loaded, 0);
+		ReleaseSRWLockExclusive(&config.lock);
+	}
+
+	// ---------------------------------------------------------
+	// Function: ReadSpoutConfigDword
+	// Read a DWORD setting.
+	//
+	// Decimal or hexadecimal "0x" values are accepted from text sources.
+	bool ReadSpoutConfigDword(const char* name, DWORD* pValue)
+	{
+		if (!pValue)
+			return false;
+
+		char value[64]={};
+		if (!ReadSpoutConfigString(name, value, 64))
+			return false;
+
+		char* end = nullptr;
+		const unsigned long ul = strtoul(value, &end, 0);
+		if (end == value)
+			return false;
+
+		*pValue = (DWORD)ul;
+		return true;
+	}
+
+	// ---------------------------------------------------------
+	// Function: ReadSpoutConfigString
+	// Read a string setting
+	bool ReadSpoutConfigString(const char* name, char* value, DWORD dwSize)
+	{
+		if (!name || !*name || !value || dwSize == 0)
+			return false;
+
+		_checkConfig();
+
+		std::string key = name;
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+		spoutConfigState& config = _config();
+		bool bFound = false;
+		SpoutConfigReader reader = nullptr;
+		AcquireSRWLockShared(&config.lock);
+		auto it = config.values.find(key);
+		if (it != config.values.end()) {
+			strcpy_s(value, dwSize, it->second.c_str());
+			bFound = true;
+		}
+		if (config.source == SPOUT_CONFIG_CUSTOM)
+			reader = config.reader;
+		ReleaseSRWLockShared(&config.lock);
+
+		// An application function is called for settings not read yet.
+		// It is called without the lock so that it can read other settings.
+		if (!bFound && reader) {
+			char custom[MAX_PATH]={};
+			if (reader(name, custom, MAX_PATH)) {
+				AcquireSRWLockExclusive(&config.lock);
+				config.values[key] = custom;
+				ReleaseSRWLockExclusive(&config.lock);
+				strcpy_s(value, dwSize, custom);
+				bFound = true;
+			}
+		}
+
+		return bFound;
+	}
+
+	// ---------------------------------------------------------
+	// Function: WriteSpoutConfigDword
+	// Write a DWORD setting to the source and the cache.
+	//
+	// Settings from an application function are only cached.
+	bool WriteSpoutConfigDword(const char* name, DWORD dwValue)
+	{
+		if (!name || !*name)
+			return false;
+
+		spoutConfigState& config = _config();
+		AcquireSRWLockShared(&config.lock);
+		const SpoutConfigSource source = config.source;
+		const std::string path = config.path;
+		ReleaseSRWLockShared(&config.lock);
+
+		bool bRet = true;
+		const std::string value = std::to_string(dwValue);
+		switch (source) {
+			case SPOUT_CONFIG_REGISTRY:
+				bRet = WriteDwordToRegistry(HKEY_CURRENT_USER, configSubkey, name, dwValue);
+				break;
+			case SPOUT_CONFIG_FILE:
+				bRet = (WritePrivateProfileStringA("Spout", name, value.c_str(), path.c_str()) != 0);
+				break;
+			case SPOUT_CONFIG_ENVIRONMENT:
+				bRet = (SetEnvironmentVariableA(("SPOUT_" + std::string(name)).c_str(), value.c_str()) != 0);
+				break;
+			default:
+				break;
+		}
+
+		if (bRet) {
+			std::string key = name;
+			std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+			AcquireSRWLockExclusive(&config.lock);
+			config.values[key] = value;
+			ReleaseSRWLockExclusive(&config.lock);
+		}
+
+		return bRet;
+	}
+
+	// ---------------------------------------------------------
+	// Function: ReloadSpoutConfig
+	// Load settings again on the next read
+	void ReloadSpoutConfig()
+	{
+		InterlockedExchange(&_config().loaded, 0);
+	}
+
+	// ---------------------------------------------------------
+	// Function: WatchSpoutConfig
+	// Load settings again when the registry key or file changes.
+	//
+	// Changes are detected on the next read.
+	void WatchSpoutConfig(bool bWatch)
+	{
+		spoutConfigState& config = _config();
+		AcquireSRWLockExclusive(&config.lock);
+		config.bWatch = bWatch;
+		_watchConfig(bWatch);
+		ReleaseSRWLockExclusive(&config.lock);
+	}
+
 	//
 	// Group: Timing
 	//
@@ -1664,67 +2227,636 @@ namespace spoututils {
 		}
 	}
 
+	// ---------------------------------------------------------
+	// Function: GetTimingCount
+	// Current performance counter
 	//
-	// Private functions
+	// Use with GetTimingElapsed for timing that is independent of
+	// StartTiming/EndTiming and safe for nested or concurrent use.
 	//
-	namespace
+	//    LONGLONG start = GetTimingCount();
+	//    ...
+	//    double msec = GetTimingElapsed(start);
+	//
+	LONGLONG GetTimingCount()
 	{
-		// Log to file with optional append 
-		void _logtofile(bool append)
-		{
-			bool bNewFile = true;
+		LARGE_INTEGER li;
+		QueryPerformanceCounter(&li);
+		return li.QuadPart;
+	}
 
-			// Set default log file if not specified
-			// C:\Users\username\AppData\Roaming\Spout\SpoutLog.log
-			if (logPath.empty()) {
-				logPath = _getLogPath();
-				logPath += "\\SpoutLog.log";
-			}
+	// ---------------------------------------------------------
+	// Function: GetTimingElapsed
+	// Milliseconds or microseconds elapsed since a count from GetTimingCount
+	double GetTimingElapsed(LONGLONG start, bool microseconds)
+	{
+		// The frequency is fixed at system boot
+		static LONGLONG frequency = 0;
+		if (frequency == 0) {
+			LARGE_INTEGER li;
+			QueryPerformanceFrequency(&li);
+			frequency = li.QuadPart;
+		}
+		const double elapsed = static_cast<double>(GetTimingCount() - start) / static_cast<double>(frequency);
+		return microseconds ? elapsed * 1000000.0 : elapsed * 1000.0;
+	}
 
-			// Check for existence before file open
-			if (_access(logPath.c_str(), 0) != -1) {
-				bNewFile = false; // File exists already
-			}
+	//
+	// Group: Timing histograms
+	//
+	// Named histograms record the time taken by sections of code
+	// from any thread without locks. Each thread adds samples to
+	// its own copy and the copies are combined when statistics
+	// are requested, so instrumented code is not held up by readers.
+	//
+	// Recording is disabled by default :
+	//
+	//    EnableTimingHistograms();
+	//
+	// Time a function or any other scope with a named histogram :
+	//
+	//    SPOUT_TIMER("spoutDX::ReceiveImage");
+	//
+	// Retrieve statistics for one histogram or a report of all :
+	//
+	//    SpoutTimingStats stats={};
+	//    GetTimingStats("spoutDX::ReceiveImage", &stats);
+	//    SpoutLog("%s", GetTimingReport().c_str());
+	//
+	// Requires std::chrono. Histograms are not recorded otherwise.
+	//
 
-			// File is created if it does not exist
-			if (append) {
-				logFile.open(logPath, logFile.app);
-			}
-			else {
-				logFile.open(logPath);
-			}
+	// ---------------------------------------------------------
+	// Function: EnableTimingHistograms
+	// Enable or disable recording of timing histograms
+	void EnableTimingHistograms(bool bEnable)
+	{
+#ifdef USE_CHRONO
+		bTimingEnabled = bEnable;
+#else
+		UNREFERENCED_PARAMETER(bEnable);
+#endif
+	}
 
-			if (logFile.is_open()) {
-				// Date and time to identify the log
-				char tmp[128]={};
-				time_t datime;
-				struct tm tmbuff;
-				time(&datime);
-				localtime_s(&tmbuff, &datime);
-				sprintf_s(tmp, 128, "%4d-%2.2d-%2.2d %2.2d:%2.2d:%2.2d",
-					tmbuff.tm_year+1900, tmbuff.tm_mon+1, tmbuff.tm_mday,
-					tmbuff.tm_hour, tmbuff.tm_min, tmbuff.tm_sec);
+	// ---------------------------------------------------------
+	// Function: TimingHistogramsEnabled
+	// Is recording of timing histograms enabled
+	bool TimingHistogramsEnabled()
+	{
+#ifdef USE_CHRONO
+		return bTimingEnabled;
+#else
+		return false;
+#endif
+	}
 
-				if (append && !bNewFile) {
-					logFile << "   " << tmp << std::endl;
-				}
-				else {
-					logFile << "========================" << std::endl;
-					logFile << "    Spout log file" << std::endl;
-					logFile << "========================" << std::endl;
-					logFile << " " << tmp << std::endl;
-				}
-				logFile.close();
-			}
-			else {
-				// disable file writes and use a console instead
-				logPath.clear();
-			}
+	// ---------------------------------------------------------
+	// Function: GetTimingHistogram
+	// Find or create a named histogram and return its index.
+	// Returns -1 if the maximum number of histograms has been reached.
+	int GetTimingHistogram(const char* name)
+	{
+#ifdef USE_CHRONO
+		if (!name || !*name)
+			return -1;
+
+		std::lock_guard<std::mutex> lock(timingNameMutex);
+		const int count = timingHistogramCount.load();
+		for (int i = 0; i < count; i++) {
+			if (strcmp(timingNames[i], name) == 0)
+				return i;
+		}
+		if (count >= maxTimingHistograms) {
+			SpoutLogWarning("GetTimingHistogram - maximum of %d histograms", maxTimingHistograms);
+			return -1;
 		}
+		strcpy_s(timingNames[count], 128, name);
+		timingHistogramCount = count + 1;
+		return count;
+#else
+		UNREFERENCED_PARAMETER(name);
+		return -1;
+#endif
+	}
 
-		// Get the default log file path
-		std::string _getLogPath()
-		{
+	// ---------------------------------------------------------
+	// Function: AddTimingSample
+	// Add a sample in microseconds to a histogram
+	void AddTimingSample(int histogram, double microseconds)
+	{
+#ifdef USE_CHRONO
+		if (!bTimingEnabled.load(std::memory_order_relaxed))
+			return;
+		if (histogram < 0 || histogram >= timingHistogramCount.load(std::memory_order_relaxed))
+			return;
+
+		if (!timingBlock)
+			timingBlock = _newTimingBlock();
+
+		// Only this thread writes to its block so the values
+		// do not need locked operations, only untorn reads
+		timingBins& bins = timingBlock->bins[histogram];
+		const unsigned long long ns = microseconds > 0.0 ? static_cast<unsigned long long>(microseconds * 1000.0) : 0ULL;
+		std::atomic<unsigned long long>& bucket = bins.bucket[_timingBucket(ns)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		bins.total.store(bins.total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+		if (ns < bins.min.load(std::memory_order_relaxed))
+			bins.min.store(ns, std::memory_order_relaxed);
+		if (ns > bins.max.load(std::memory_order_relaxed))
+			bins.max.store(ns, std::memory_order_relaxed);
+		// Count last so that a reader does not see a count without a sample
+		bins.count.store(bins.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+#else
+		UNREFERENCED_PARAMETER(histogram);
+		UNREFERENCED_PARAMETER(microseconds);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: GetTimingStats
+	// Statistics for a named histogram, merged from all threads.
+	// Times are microseconds. Percentiles are the upper
+	// limit of the histogram bucket containing them.
+	bool GetTimingStats(const char* name, SpoutTimingStats* stats)
+	{
+		if (!name || !stats)
+			return false;
+
+		*stats = {};
+
+#ifdef USE_CHRONO
+		int histogram = -1;
+		const int count = timingHistogramCount.load();
+		for (int i = 0; i < count; i++) {
+			if (strcmp(timingNames[i], name) == 0) {
+				histogram = i;
+				break;
+			}
+		}
+		if (histogram < 0)
+			return false;
+
+		// Merge the thread blocks
+		unsigned long long buckets[timingBuckets]={};
+		unsigned long long total = 0;
+		unsigned long long minimum = ~0ULL;
+		unsigned long long maximum = 0;
+		for (timingThreadBlock* block = timingThreads.load(); block; block = block->next) {
+			timingBins& bins = block->bins[histogram];
+			stats->count += bins.count.load(std::memory_order_acquire);
+			total += bins.total.load(std::memory_order_relaxed);
+			minimum = (std::min)(minimum, bins.min.load(std::memory_order_relaxed));
+			maximum = (std::max)(maximum, bins.max.load(std::memory_order_relaxed));
+			for (int i = 0; i < timingBuckets; i++)
+				buckets[i] += bins.bucket[i].load(std::memory_order_relaxed);
+		}
+		if (stats->count == 0)
+			return true;
+
+		stats->total = static_cast<double>(total) / 1000.0;
+		stats->mean  = stats->total / static_cast<double>(stats->count);
+		stats->min   = static_cast<double>(minimum) / 1000.0;
+		stats->max   = static_cast<double>(maximum) / 1000.0;
+
+		// Percentiles from the bucket counts
+		unsigned long long bucketcount = 0;
+		for (int i = 0; i < timingBuckets; i++)
+			bucketcount += buckets[i];
+		const double percent[3] = { 0.50, 0.95, 0.99 };
+		double* result[3] = { &stats->p50, &stats->p95, &stats->p99 };
+		for (int p = 0; p < 3; p++) {
+			const unsigned long long target = static_cast<unsigned long long>(ceil(percent[p] * static_cast<double>(bucketcount)));
+			unsigned long long sum = 0;
+			for (int i = 0; i < timingBuckets; i++) {
+				sum += buckets[i];
+				if (sum >= target) {
+					*result[p] = (std::min)(_timingBucketLimit(i) / 1000.0, stats->max);
+					break;
+				}
+			}
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: GetTimingReport
+	// Report of all histograms as a text table (microseconds)
+	std::string GetTimingReport()
+	{
+		std::string report;
+#ifdef USE_CHRONO
+		char line[256]={};
+		sprintf_s(line, 256, "%-40s %10s %10s %10s %10s %10s %10s %10s\n",
+			"Timing (usec)", "count", "mean", "min", "p50", "p95", "p99", "max");
+		report = line;
+		const int count = timingHistogramCount.load();
+		for (int i = 0; i < count; i++) {
+			SpoutTimingStats stats={};
+			if (GetTimingStats(timingNames[i], &stats) && stats.count > 0) {
+				sprintf_s(line, 256, "%-40s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+					timingNames[i], stats.count, stats.mean, stats.min,
+					stats.p50, stats.p95, stats.p99, stats.max);
+				report += line;
+			}
+		}
+#endif
+		return report;
+	}
+
+	// ---------------------------------------------------------
+	// Function: ResetTimingHistograms
+	// Clear all histogram samples.
+	// Samples being recorded at the same time may be lost.
+	void ResetTimingHistograms()
+	{
+#ifdef USE_CHRONO
+		for (timingThreadBlock* block = timingThreads.load(); block; block = block->next)
+			_clearTimingBlock(block);
+#endif
+	}
+
+	//
+	// Group: Tracing
+	//
+	// Trace events show where time is spent in each thread
+	// with a timeline in chrome://tracing or https://ui.perfetto.dev
+	//
+	// Recording is disabled by default and costs only a flag test
+	// until enabled. Define SPOUT_NO_TRACE to remove it altogether.
+	//
+	//    EnableSpoutTrace();
+	//    ...
+	//    WriteSpoutTrace("C:\\Temp\\spout_trace.json");
+	//
+	// The SDK records the main sender and receiver functions.
+	// Applications can add their own :
+	//
+	//    SPOUT_TRACE("Render"); // time to the end of the scope
+	//    SPOUT_TRACE_COUNTER("Queue", queuesize);
+	//
+	// Each thread retains its most recent 2048 events.
+	// Requires std::chrono. Events are not recorded otherwise.
+	//
+
+	// ---------------------------------------------------------
+	// Function: EnableSpoutTrace
+	// Enable or disable recording of trace events
+	void EnableSpoutTrace(bool bEnable)
+	{
+#ifdef USE_CHRONO
+		if (bEnable && !bTraceEnabled)
+			traceStart = GetTimingCount();
+		bTraceEnabled = bEnable;
+#else
+		UNREFERENCED_PARAMETER(bEnable);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutTraceEnabled
+	// Is recording of trace events enabled
+	bool SpoutTraceEnabled()
+	{
+#ifdef USE_CHRONO
+		return bTraceEnabled.load(std::memory_order_relaxed)
+			|| bFlightEnabled.load(std::memory_order_relaxed);
+#else
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutTraceBegin
+	// Begin a trace event on the current thread.
+	// The name must remain valid, such as a string literal.
+	void SpoutTraceBegin(const char* name)
+	{
+#ifdef USE_CHRONO
+		if (name && SpoutTraceEnabled())
+			_addTraceEvent('B', name, GetTimingCount(), 0, 0.0);
+#else
+		UNREFERENCED_PARAMETER(name);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutTraceEnd
+	// End a trace event on the current thread
+	void SpoutTraceEnd(const char* name)
+	{
+#ifdef USE_CHRONO
+		if (name && SpoutTraceEnabled())
+			_addTraceEvent('E', name, GetTimingCount(), 0, 0.0);
+#else
+		UNREFERENCED_PARAMETER(name);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutTraceCounter
+	// Record a counter value
+	void SpoutTraceCounter(const char* name, double value)
+	{
+#ifdef USE_CHRONO
+		if (name && SpoutTraceEnabled())
+			_addTraceEvent('C', name, GetTimingCount(), 0, value);
+#else
+		UNREFERENCED_PARAMETER(name);
+		UNREFERENCED_PARAMETER(value);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: WriteSpoutTrace
+	// Write recorded events to a Chrome trace JSON file.
+	//
+	// Events recorded while the file is written may be incomplete,
+	// so disable tracing first for an exact record.
+	bool WriteSpoutTrace(const char* filepath)
+	{
+#ifdef USE_CHRONO
+		if (!filepath || !*filepath)
+			return false;
+
+		std::ofstream tracefile(filepath);
+		if (!tracefile.is_open()) {
+			SpoutLogWarning("WriteSpoutTrace - could not open [%s]", filepath);
+			return false;
+		}
+
+		LARGE_INTEGER li;
+		QueryPerformanceFrequency(&li);
+		const double usecPerCount = 1000000.0 / static_cast<double>(li.QuadPart);
+		const DWORD pid = GetCurrentProcessId();
+
+		tracefile << "{\"traceEvents\":[\n";
+		bool bFirst = true;
+		char line[512]={};
+		for (traceThreadRing* ring = traceThreads.load(); ring; ring = ring->next) {
+			const size_t head = ring->head.load(std::memory_order_acquire);
+			const size_t count = (std::min)(head, traceRingSize);
+			for (size_t i = head - count; i < head; i++) {
+				const traceEvent ev = ring->events[i & (traceRingSize - 1)];
+				if (!ev.name)
+					continue;
+				// Names are code literals but escape quotes anyway
+				std::string name = ev.name;
+				std::replace(name.begin(), name.end(), '\"', '\'');
+				std::replace(name.begin(), name.end(), '\\', '/');
+				const double ts = static_cast<double>(ev.timestamp - traceStart) * usecPerCount;
+				if (ev.phase == 'X') {
+					sprintf_s(line, 512, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+						name.c_str(), ts, static_cast<double>(ev.duration) * usecPerCount, pid, ring->threadId);
+				}
+				else if (ev.phase == 'C') {
+					sprintf_s(line, 512, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu,\"args\":{\"value\":%g}}",
+						name.c_str(), ts, pid, ring->threadId, ev.value);
+				}
+				else {
+					sprintf_s(line, 512, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+						name.c_str(), ev.phase, ts, pid, ring->threadId);
+				}
+				if (!bFirst)
+					tracefile << ",\n";
+				tracefile << line;
+				bFirst = false;
+			}
+		}
+		tracefile << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		tracefile.close();
+		return true;
+#else
+		UNREFERENCED_PARAMETER(filepath);
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: ClearSpoutTrace
+	// Clear recorded events.
+	// Events being recorded at the same time may be lost.
+	void ClearSpoutTrace()
+	{
+#ifdef USE_CHRONO
+		for (traceThreadRing* ring = traceThreads.load(); ring; ring = ring->next)
+			ring->head.store(0, std::memory_order_release);
+		traceStart = GetTimingCount();
+#endif
+	}
+
+	//
+	// Group: Flight recorder
+	//
+	// The flight recorder retains the most recent 1024 logs and trace
+	// events in memory so that the context of a problem in the field
+	// is available without verbose logging to file.
+	//
+	//    EnableSpoutFlightRecorder(); // warnings, errors and crash dump
+	//    EnableSpoutFlightRecorder(true, SPOUT_LOG_VERBOSE); // all logs
+	//    ...
+	//    WriteSpoutFlightRecorder(); // on demand
+	//
+	// Logs are formatted into the ring but not shown unless enabled.
+	// Trace events are recorded as for EnableSpoutTrace.
+	// Requires std::chrono. Nothing is recorded otherwise.
+	//
+
+	// ---------------------------------------------------------
+	// Function: EnableSpoutFlightRecorder
+	// Enable or disable the flight recorder.
+	//
+	// Logs of the given level and above are retained. The default is
+	// warnings and errors. Retained logs are formatted when they are
+	// added, because arguments may not remain valid, so lower levels
+	// format every log of that level even if it is not shown.
+	// If bCrashDump is true, the recorder is written to the default
+	// file by an unhandled exception filter and an abort signal handler.
+	// Any existing exception filter is called afterwards.
+	void EnableSpoutFlightRecorder(bool bEnable, SpoutLogLevel level, bool bCrashDump)
+	{
+#ifdef USE_CHRONO
+		if (bEnable) {
+			if (!flightRing) {
+				// Allocated once and retained for a crash handler
+				flightRing = new flightRecord[flightRingSize];
+				for (size_t i = 0; i < flightRingSize; i++) {
+					flightRing[i].sequence.store(0);
+					flightRing[i].name = nullptr;
+					flightRing[i].text[0] = 0;
+				}
+			}
+			if (!bFlightEnabled)
+				flightStart = GetTimingCount();
+			flightLevel = level;
+			// Prepare the default file path before it is needed
+			if (!flightPath[0]) {
+				std::string path = _getLogPath();
+				path += "\\";
+				path += GetExeName();
+				path += "_flight.log";
+				strcpy_s(flightPath, MAX_PATH, path.c_str());
+			}
+			if (bCrashDump && !bFlightCrashDump) {
+				flightPrevFilter = SetUnhandledExceptionFilter(_flightExceptionFilter);
+				flightPrevAbort = signal(SIGABRT, _flightAbortHandler);
+				bFlightCrashDump = true;
+			}
+			bFlightEnabled = true;
+		}
+		else {
+			bFlightEnabled = false;
+		}
+
+		// Remove the crash handlers
+		if (bFlightCrashDump && (!bEnable || !bCrashDump)) {
+			SetUnhandledExceptionFilter(flightPrevFilter);
+			signal(SIGABRT, flightPrevAbort == SIG_ERR ? SIG_DFL : flightPrevAbort);
+			flightPrevFilter = nullptr;
+			flightPrevAbort = nullptr;
+			bFlightCrashDump = false;
+		}
+#else
+		UNREFERENCED_PARAMETER(bEnable);
+		UNREFERENCED_PARAMETER(level);
+		UNREFERENCED_PARAMETER(bCrashDump);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: SpoutFlightRecorderEnabled
+	// Is the flight recorder enabled
+	bool SpoutFlightRecorderEnabled()
+	{
+#ifdef USE_CHRONO
+		return bFlightEnabled.load(std::memory_order_relaxed);
+#else
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Function: WriteSpoutFlightRecorder
+	// Write the flight recorder to a text file.
+	//
+	// The default is "exename_flight.log" in the Spout log folder.
+	// Recording continues while the file is written.
+	bool WriteSpoutFlightRecorder(const char* filepath)
+	{
+#ifdef USE_CHRONO
+		if (!flightRing)
+			return false;
+		if (!filepath || !*filepath)
+			filepath = flightPath;
+		return _writeFlightRecorder(filepath, 0);
+#else
+		UNREFERENCED_PARAMETER(filepath);
+		return false;
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Class: spoutTraceScope
+	// Trace the enclosing scope as a single event.
+	//
+	// Nothing is recorded if tracing is disabled.
+	//
+	spoutTraceScope::spoutTraceScope(const char* name)
+	{
+		m_name = name;
+		m_start = (name && SpoutTraceEnabled()) ? GetTimingCount() : 0;
+	}
+
+	spoutTraceScope::~spoutTraceScope()
+	{
+#ifdef USE_CHRONO
+		if (m_start != 0)
+			_addTraceEvent('X', m_name, m_start, GetTimingCount() - m_start, 0.0);
+#endif
+	}
+
+	// ---------------------------------------------------------
+	// Class: spoutScopedTimer
+	// Time the enclosing scope into a histogram.
+	//
+	// The time is recorded when the object goes out of scope.
+	// Nothing is timed if histograms are disabled.
+	//
+	spoutScopedTimer::spoutScopedTimer(int histogram)
+	{
+		m_histogram = histogram;
+		m_start = (histogram >= 0 && TimingHistogramsEnabled()) ? GetTimingCount() : 0;
+	}
+
+	spoutScopedTimer::~spoutScopedTimer()
+	{
+		if (m_start != 0)
+			AddTimingSample(m_histogram, GetTimingElapsed(m_start, true));
+	}
+
+	//
+	// Private functions
+	//
+	namespace
+	{
+		// Log to file with optional append 
+		void _logtofile(bool append)
+		{
+			bool bNewFile = true;
+
+			// Set default log file if not specified
+			// C:\Users\username\AppData\Roaming\Spout\SpoutLog.log
+			if (logPath.empty()) {
+				logPath = _getLogPath();
+				logPath += "\\SpoutLog.log";
+			}
+
+			// Check for existence before file open
+			if (_access(logPath.c_str(), 0) != -1) {
+				bNewFile = false; // File exists already
+			}
+
+			// File is created if it does not exist
+			if (append) {
+				logFile.open(logPath, logFile.app);
+			}
+			else {
+				logFile.open(logPath);
+			}
+
+			if (logFile.is_open()) {
+				// Date and time to identify the log
+				char tmp[128]={};
+				time_t datime;
+				struct tm tmbuff;
+				time(&datime);
+				localtime_s(&tmbuff, &datime);
+				sprintf_s(tmp, 128, "%4d-%2.2d-%2.2d %2.2d:%2.2d:%2.2d",
+					tmbuff.tm_year+1900, tmbuff.tm_mon+1, tmbuff.tm_mday,
+					tmbuff.tm_hour, tmbuff.tm_min, tmbuff.tm_sec);
+
+				if (append && !bNewFile) {
+					logFile << "   " << tmp << std::endl;
+				}
+				else {
+					logFile << "========================" << std::endl;
+					logFile << "    Spout log file" << std::endl;
+					logFile << "========================" << std::endl;
+					logFile << " " << tmp << std::endl;
+				}
+				logFile.close();
+			}
+			else {
+				// disable file writes and use a console instead
+				logPath.clear();
+			}
+		}
+
+		// Get the default log file path
+		std::string _getLogPath()
+		{
 			char logpath[MAX_PATH]={};
 			logpath[0] = 0;
 
@@ -1872,6 +3004,696 @@ namespace spoututils {
 			return name;
 		}
 
+#ifdef USE_CHRONO
+		// Create a histogram block for the current thread.
+		// Blocks are retained after the thread exits
+		// so that the samples remain in the statistics.
+		timingThreadBlock* _newTimingBlock()
+		{
+			timingThreadBlock* block = new timingThreadBlock;
+			_clearTimingBlock(block);
+			block->next = timingThreads.load();
+			while (!timingThreads.compare_exchange_weak(block->next, block)) {}
+			return block;
+		}
+
+		// Clear histogram samples for a thread
+		void _clearTimingBlock(timingThreadBlock* block)
+		{
+			for (int i = 0; i < maxTimingHistograms; i++) {
+				timingBins& bins = block->bins[i];
+				bins.count.store(0, std::memory_order_relaxed);
+				bins.total.store(0, std::memory_order_relaxed);
+				bins.min.store(~0ULL, std::memory_order_relaxed);
+				bins.max.store(0, std::memory_order_relaxed);
+				for (int j = 0; j < timingBuckets; j++)
+					bins.bucket[j].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Histogram bucket for a time in nanoseconds.
+		// Bucket 0 is less than 256 nsec, then two buckets for each power of 2.
+		int _timingBucket(unsigned long long ns)
+		{
+			if (ns < 256)
+				return 0;
+			unsigned long msb = 0;
+			if (ns >> 32) {
+				BitScanReverse(&msb, static_cast<unsigned long>(ns >> 32));
+				msb += 32;
+			}
+			else {
+				BitScanReverse(&msb, static_cast<unsigned long>(ns));
+			}
+			const int bucket = static_cast<int>((msb - 8) * 2 + ((ns >> (msb - 1)) & 1) + 1);
+			return (std::min)(bucket, timingBuckets - 1);
+		}
+
+		// Upper limit of a histogram bucket in nanoseconds
+		double _timingBucketLimit(int bucket)
+		{
+			if (bucket <= 0)
+				return 256.0;
+			const int msb = (bucket - 1) / 2 + 8;
+			const double octave = ldexp(1.0, msb);
+			return ((bucket - 1) % 2 == 0) ? octave * 1.5 : octave * 2.0;
+		}
+#endif
+
+#ifdef USE_CHRONO
+		// Create a trace ring for the current thread.
+		// Rings are retained after the thread exits
+		// so that the events can still be written.
+		traceThreadRing* _newTraceRing()
+		{
+			traceThreadRing* ring = new traceThreadRing;
+			memset(ring->events, 0, sizeof(ring->events));
+			ring->head.store(0);
+			ring->threadId = GetCurrentThreadId();
+			ring->next = traceThreads.load();
+			while (!traceThreads.compare_exchange_weak(ring->next, ring)) {}
+			return ring;
+		}
+
+		// Add an event to the trace ring of the current thread
+		// and to the flight recorder
+		void _addTraceEvent(char phase, const char* name, LONGLONG timestamp, LONGLONG duration, double value)
+		{
+			if (bFlightEnabled.load(std::memory_order_relaxed))
+				_addFlightEvent(phase, name, timestamp, duration, value);
+
+			if (!bTraceEnabled.load(std::memory_order_relaxed))
+				return;
+
+			if (!traceRing)
+				traceRing = _newTraceRing();
+			// Only this thread writes to the ring
+			const size_t pos = traceRing->head.load(std::memory_order_relaxed);
+			traceEvent& ev = traceRing->events[pos & (traceRingSize - 1)];
+			ev.name = name;
+			ev.timestamp = timestamp;
+			ev.duration = duration;
+			ev.value = value;
+			ev.phase = phase;
+			traceRing->head.store(pos + 1, std::memory_order_release);
+		}
+
+		// Claim the next flight recorder record, overwriting the oldest.
+		// The record sequence is odd while it is written. If the ring has
+		// wrapped and a newer record has claimed it, this one is dropped.
+		// If an older record is still being written, wait for it briefly.
+		// Returns null if the record is not claimed.
+		flightRecord* _claimFlightRecord(size_t* pos)
+		{
+			*pos = flightHead.fetch_add(1, std::memory_order_relaxed);
+			flightRecord* record = &flightRing[*pos & (flightRingSize - 1)];
+			size_t sequence = record->sequence.load(std::memory_order_relaxed);
+			for (int i = 0; i < 1000; i++) {
+				// Position held by the record, newer or older
+				if (sequence != 0 && (sequence - 1)/2 > *pos)
+					return nullptr;
+				if (sequence & 1) {
+					YieldProcessor();
+					sequence = record->sequence.load(std::memory_order_relaxed);
+					continue;
+				}
+				if (record->sequence.compare_exchange_weak(sequence, 2*(*pos) + 1,
+					std::memory_order_acquire, std::memory_order_relaxed))
+					return record;
+			}
+			return nullptr;
+		}
+
+		// Format a log into the flight recorder
+		void _addFlightLog(SpoutLogLevel level, const char* format, va_list args)
+		{
+			size_t pos = 0;
+			flightRecord* record = _claimFlightRecord(&pos);
+			if (!record)
+				return;
+			record->timestamp = GetTimingCount();
+			record->duration = 0;
+			record->value = 0.0;
+			record->name = nullptr;
+			record->threadId = GetCurrentThreadId();
+			record->level = level;
+			record->type = 'L';
+			// Long logs are truncated
+			_vsnprintf_s(record->text, 256, _TRUNCATE, format, args);
+			record->sequence.store(2*pos + 2, std::memory_order_release);
+		}
+
+		// Add a trace event to the flight recorder without formatting
+		void _addFlightEvent(char phase, const char* name, LONGLONG timestamp, LONGLONG duration, double value)
+		{
+			size_t pos = 0;
+			flightRecord* record = _claimFlightRecord(&pos);
+			if (!record)
+				return;
+			record->timestamp = timestamp;
+			record->duration = duration;
+			record->value = value;
+			record->name = name;
+			record->threadId = GetCurrentThreadId();
+			record->level = SPOUT_LOG_NONE;
+			record->type = phase;
+			record->text[0] = 0;
+			record->sequence.store(2*pos + 2, std::memory_order_release);
+		}
+
+		// Write the flight recorder to a text file, oldest record first.
+		// Uses only Windows file functions and the stack
+		// so that it can be called from a crash handler.
+		bool _writeFlightRecorder(const char* filepath, DWORD exceptionCode)
+		{
+			if (!flightRing || !filepath || !*filepath)
+				return false;
+
+			// One writer at a time
+			if (InterlockedCompareExchange(&flightWriting, 1, 0) != 0)
+				return false;
+
+			HANDLE hFile = CreateFileA(filepath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+				CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (hFile == INVALID_HANDLE_VALUE) {
+				InterlockedExchange(&flightWriting, 0);
+				return false;
+			}
+
+			LARGE_INTEGER li;
+			QueryPerformanceFrequency(&li);
+			const double msecPerCount = 1000.0 / static_cast<double>(li.QuadPart);
+			const char* levels[] = { "silent", "verbose", "notice", "warning", "error", "fatal" };
+
+			char line[512]={};
+			DWORD dwWritten = 0;
+			const size_t head = flightHead.load(std::memory_order_acquire);
+			const size_t count = (std::min)(head, flightRingSize);
+			int len = sprintf_s(line, 512, "Spout flight recorder - %u records - process %lu\r\n",
+				(unsigned int)count, GetCurrentProcessId());
+			WriteFile(hFile, line, (DWORD)len, &dwWritten, NULL);
+			if (exceptionCode != 0) {
+				len = sprintf_s(line, 512, "Unhandled exception 0x%08lX\r\n", exceptionCode);
+				WriteFile(hFile, line, (DWORD)len, &dwWritten, NULL);
+			}
+
+			// Copy each record and skip any that change while copied
+			flightRecord record;
+			for (size_t pos = head - count; pos < head; pos++) {
+				flightRecord& src = flightRing[pos & (flightRingSize - 1)];
+				const size_t complete = 2*pos + 2;
+				if (src.sequence.load(std::memory_order_acquire) != complete)
+					continue;
+				record.timestamp = src.timestamp;
+				record.duration = src.duration;
+				record.value = src.value;
+				record.name = src.name;
+				record.threadId = src.threadId;
+				record.level = src.level;
+				record.type = src.type;
+				memcpy(record.text, src.text, 256);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (src.sequence.load(std::memory_order_relaxed) != complete)
+					continue;
+				record.text[255] = 0;
+
+				const double ms = static_cast<double>(record.timestamp - flightStart) * msecPerCount;
+				const char* name = record.name ? record.name : "";
+				switch (record.type) {
+					case 'L':
+						if (record.level > SPOUT_LOG_SILENT && record.level <= SPOUT_LOG_FATAL)
+							len = sprintf_s(line, 512, "%12.3f [%5lu] [%s] %s\r\n", ms, record.threadId, levels[record.level], record.text);
+						else
+							len = sprintf_s(line, 512, "%12.3f [%5lu] %s\r\n", ms, record.threadId, record.text);
+						break;
+					case 'X':
+						len = sprintf_s(line, 512, "%12.3f [%5lu] trace %s (%.3f msec)\r\n", ms, record.threadId,
+							name, static_cast<double>(record.duration) * msecPerCount);
+						break;
+					case 'B':
+						len = sprintf_s(line, 512, "%12.3f [%5lu] trace begin %s\r\n", ms, record.threadId, name);
+						break;
+					case 'E':
+						len = sprintf_s(line, 512, "%12.3f [%5lu] trace end %s\r\n", ms, record.threadId, name);
+						break;
+					case 'C':
+						len = sprintf_s(line, 512, "%12.3f [%5lu] counter %s = %g\r\n", ms, record.threadId, name, record.value);
+						break;
+					default:
+						len = 0;
+						break;
+				}
+				if (len > 0)
+					WriteFile(hFile, line, (DWORD)len, &dwWritten, NULL);
+			}
+
+			FlushFileBuffers(hFile);
+			CloseHandle(hFile);
+			InterlockedExchange(&flightWriting, 0);
+			return true;
+		}
+
+		// Write the flight recorder for an unhandled exception
+		// and pass on to any previous filter
+		LONG WINAPI _flightExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo)
+		{
+			DWORD code = 0;
+			if (pExceptionInfo && pExceptionInfo->ExceptionRecord)
+				code = pExceptionInfo->ExceptionRecord->ExceptionCode;
+			_writeFlightRecorder(flightPath, code);
+			if (flightPrevFilter)
+				return flightPrevFilter(pExceptionInfo);
+			return EXCEPTION_CONTINUE_SEARCH;
+		}
+
+		// Write the flight recorder for abort and then
+		// continue with the default behaviour
+		void __cdecl _flightAbortHandler(int sig)
+		{
+			_writeFlightRecorder(flightPath, 0);
+			signal(sig, SIG_DFL);
+			raise(sig);
+		}
+#endif
+
+		// Log with variable arguments
+		void _doLogArgs(SpoutLogLevel level, const char* format, ...)
+		{
+			va_list args;
+			va_start(args, format);
+			_doLog(level, format, args);
+			va_end(args);
+		}
+
+		// Show a log on the console
+		void _logtoconsole(SpoutLogLevel level, const char* text)
+		{
+			// Yellow text for warnings and errors
+			HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+			FILE* out = stdout; // Console output
+			if (level == SPOUT_LOG_WARNING || level == SPOUT_LOG_ERROR)
+				SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY);
+			if (level != SPOUT_LOG_NONE) {
+				// Show log level
+				fprintf(out, "[%s] ", _levelName(level).c_str());
+			}
+			// The log and newline
+			fprintf(out, "%s\n", text);
+			// Reset white text
+			SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+		}
+
+		// Would a log of this level be shown on console or file
+		bool _logShown(SpoutLogLevel level)
+		{
+			// Logging is paused
+			if (!bDoLogs)
+				return false;
+
+			if (level == SPOUT_LOG_SILENT
+				|| CurrentLogLevel == SPOUT_LOG_SILENT
+				|| level < CurrentLogLevel)
+				return false;
+
+			// There is nowhere to show the log
+			if (!(bConsole && bEnableLog) && !(bEnableLogFile && !logPath.empty()))
+				return false;
+
+			return true;
+		}
+
+		// Load the configuration if not loaded or the source has changed
+		void _checkConfig()
+		{
+			spoutConfigState& config = _config();
+			if (InterlockedCompareExchange(&config.loaded, 0, 0) != 0) {
+				AcquireSRWLockShared(&config.lock);
+				const bool bChanged = config.bWatch && config.hChange
+					&& WaitForSingleObject(config.hChange, 0) == WAIT_OBJECT_0;
+				ReleaseSRWLockShared(&config.lock);
+				if (!bChanged)
+					return;
+				AcquireSRWLockExclusive(&config.lock);
+				// Set up the next notification
+				if (config.bWatch)
+					_watchConfig(true);
+				InterlockedExchange(&config.loaded, 0);
+				ReleaseSRWLockExclusive(&config.lock);
+			}
+
+			AcquireSRWLockExclusive(&config.lock);
+			if (config.loaded == 0) {
+				_loadConfig();
+				InterlockedExchange(&config.loaded, 1);
+			}
+			ReleaseSRWLockExclusive(&config.lock);
+		}
+
+		// Load all settings from the source.
+		// Called with the configuration lock held.
+		void _loadConfig()
+		{
+			spoutConfigState& config = _config();
+			config.values.clear();
+			switch (config.source) {
+				case SPOUT_CONFIG_REGISTRY:
+					_loadConfigRegistry();
+					break;
+				case SPOUT_CONFIG_FILE:
+					_loadConfigFile();
+					break;
+				case SPOUT_CONFIG_ENVIRONMENT:
+					_loadConfigEnvironment();
+					break;
+				default:
+					// Application settings are read when requested
+					break;
+			}
+		}
+
+		// All values of the Spout registry key with one key open
+		void _loadConfigRegistry()
+		{
+			HKEY hKey = NULL;
+			if (RegOpenKeyExA(HKEY_CURRENT_USER, configSubkey, 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+				return;
+
+			std::map<std::string, std::string>& values = _config().values;
+			char name[256]={};
+			BYTE data[1024]={};
+			for (DWORD index = 0; ; index++) {
+				DWORD namesize = 256;
+				DWORD datasize = 1023;
+				DWORD type = 0;
+				const LONG res = RegEnumValueA(hKey, index, name, &namesize, NULL, &type, data, &datasize);
+				if (res == ERROR_NO_MORE_ITEMS)
+					break;
+				if (res != ERROR_SUCCESS)
+					continue;
+				std::string key = name;
+				std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+				if (type == REG_DWORD && datasize == sizeof(DWORD)) {
+					DWORD dwValue = 0;
+					memcpy(&dwValue, data, sizeof(DWORD));
+					values[key] = std::to_string(dwValue);
+				}
+				else if (type == REG_SZ || type == REG_EXPAND_SZ) {
+					data[datasize] = 0;
+					values[key] = reinterpret_cast<char*>(data);
+				}
+			}
+			RegCloseKey(hKey);
+		}
+
+		// Settings of an INI file
+		void _loadConfigFile()
+		{
+			spoutConfigState& config = _config();
+			if (config.path.empty())
+				return;
+
+			std::ifstream file(config.path);
+			if (!file.is_open()) {
+				SpoutLogWarning("SpoutConfig - could not open [%s]", config.path.c_str());
+				return;
+			}
+
+			_parseConfigFile(file, config.values);
+		}
+
+		// "name=value" lines of the [Spout] section of an INI file,
+		// or before any section. Lines starting with ';' or '#' are comments.
+		// Uses only the standard library.
+		void _parseConfigFile(std::istream& file, std::map<std::string, std::string>& values)
+		{
+			const char* space = " \t\r\n";
+			bool bSection = true;
+			std::string line;
+			while (std::getline(file, line)) {
+				const size_t first = line.find_first_not_of(space);
+				if (first == std::string::npos || line[first] == ';' || line[first] == '#')
+					continue;
+				line = line.substr(first, line.find_last_not_of(space) - first + 1);
+				if (line[0] == '[') {
+					std::string section = line.substr(1, line.find(']') - 1);
+					std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+					bSection = (section == "spout");
+					continue;
+				}
+				const size_t pos = line.find('=');
+				if (!bSection || pos == std::string::npos || pos == 0)
+					continue;
+				std::string key = line.substr(0, line.find_last_not_of(space, pos - 1) + 1);
+				std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+				const size_t start = line.find_first_not_of(space, pos + 1);
+				values[key] = (start == std::string::npos) ? "" : line.substr(start);
+			}
+		}
+
+		// Environment variables with a "SPOUT_" prefix
+		void _loadConfigEnvironment()
+		{
+			char* env = GetEnvironmentStringsA();
+			if (!env)
+				return;
+			std::map<std::string, std::string>& values = _config().values;
+			for (const char* var = env; *var; var += strlen(var) + 1) {
+				if (_strnicmp(var, "SPOUT_", 6) != 0)
+					continue;
+				const char* equals = strchr(var + 6, '=');
+				if (!equals || equals == var + 6)
+					continue;
+				std::string key(var + 6, equals);
+				std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+				values[key] = equals + 1;
+			}
+			FreeEnvironmentStringsA(env);
+		}
+
+		// Change notification action for the configuration source.
+		// Makes no system calls, so that the watch logic can be
+		// checked without the registry or file system.
+		//   bWatch   - the source should be watched
+		//   bActive  - a change notification is open
+		//   bChanged - the notification has been signalled
+		configWatchAction _configWatchAction(SpoutConfigSource source, const std::string& path,
+			bool bWatch, bool bActive, bool bChanged)
+		{
+			// Only the registry and files can be watched
+			const bool bWatchable = (source == SPOUT_CONFIG_REGISTRY)
+				|| (source == SPOUT_CONFIG_FILE && !path.empty());
+			if (!bWatch || !bWatchable)
+				return bActive ? CONFIG_WATCH_STOP : CONFIG_WATCH_NONE;
+			if (!bActive)
+				return CONFIG_WATCH_START;
+			// A notification is renewed only after it has been used
+			return bChanged ? CONFIG_WATCH_RENEW : CONFIG_WATCH_NONE;
+		}
+
+		// Start, renew or stop change notification for the source.
+		// Called with the configuration lock held.
+		//
+		// Registry notification is thread agnostic, so that it can be
+		// renewed by any thread that reads settings. Otherwise it would
+		// end when the thread that requested it exits.
+		void _watchConfig(bool bWatch)
+		{
+			spoutConfigState& config = _config();
+			const bool bActive = (config.hChange != NULL);
+			const bool bChanged = bActive && WaitForSingleObject(config.hChange, 0) == WAIT_OBJECT_0;
+			const bool bRegistry = (config.source == SPOUT_CONFIG_REGISTRY);
+
+			switch (_configWatchAction(config.source, config.path, bWatch, bActive, bChanged)) {
+				case CONFIG_WATCH_START:
+					if (bRegistry) {
+						if (RegOpenKeyExA(HKEY_CURRENT_USER, configSubkey, 0, KEY_NOTIFY, &config.hKey) != ERROR_SUCCESS) {
+							config.hKey = NULL;
+							break;
+						}
+						config.hChange = CreateEventA(NULL, TRUE, FALSE, NULL);
+						if (config.hChange && RegNotifyChangeKeyValue(config.hKey, FALSE,
+							REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, config.hChange, TRUE) != ERROR_SUCCESS) {
+							SpoutLogWarning("SpoutConfig - registry change notification not available");
+							CloseHandle(config.hChange);
+							config.hChange = NULL;
+						}
+						if (!config.hChange) {
+							RegCloseKey(config.hKey);
+							config.hKey = NULL;
+						}
+					}
+					else {
+						// Any change to a file in the folder
+						std::string folder = GetPath(config.path);
+						if (folder.empty())
+							folder = ".";
+						config.hChange = FindFirstChangeNotificationA(folder.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE);
+						if (config.hChange == INVALID_HANDLE_VALUE)
+							config.hChange = NULL;
+					}
+					break;
+				case CONFIG_WATCH_RENEW:
+					if (bRegistry) {
+						ResetEvent(config.hChange);
+						RegNotifyChangeKeyValue(config.hKey, FALSE,
+							REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, config.hChange, TRUE);
+					}
+					else {
+						FindNextChangeNotification(config.hChange);
+					}
+					break;
+				case CONFIG_WATCH_STOP:
+					// The handle type is that of the current source
+					if (config.hKey) {
+						RegCloseKey(config.hKey);
+						config.hKey = NULL;
+						CloseHandle(config.hChange);
+					}
+					else {
+						FindCloseChangeNotification(config.hChange);
+					}
+					config.hChange = NULL;
+					break;
+				default:
+					break;
+			}
+		}
+
+#ifdef USE_CHRONO
+		// Format a log into the next free record of the ring.
+		// Returns false if the ring is full.
+		bool _pushAsyncLog(SpoutLogLevel level, const char* format, va_list args)
+		{
+			asyncLogRecord* record = nullptr;
+			size_t pos = asyncLogTail.load(std::memory_order_relaxed);
+			for (;;) {
+				record = &asyncLogRing[pos & (asyncLogSize - 1)];
+				const size_t seq = record->sequence.load(std::memory_order_acquire);
+				const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+				if (dif == 0) {
+					// The record is free - claim it
+					if (asyncLogTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0) {
+					// The log thread has not caught up
+					return false;
+				}
+				else {
+					// Another producer claimed the record
+					pos = asyncLogTail.load(std::memory_order_relaxed);
+				}
+			}
+
+			record->level = level;
+			vsprintf_s(record->text, 1024, format, args);
+
+			// Publish the record to the log thread
+			record->sequence.store(pos + 1, std::memory_order_release);
+
+			// Wake the log thread if it is waiting
+			if (bAsyncWaiting.exchange(false))
+				SetEvent(hAsyncLogEvent);
+
+			return true;
+		}
+
+		// Background thread to write queued logs
+		void _asyncLogThread(std::shared_ptr<asyncLogFileState> state)
+		{
+			char lastLog[1024]={}; // Prevent multiple logs
+			std::string fileLogs; // Logs for the file are written together
+
+			for (;;) {
+
+				// Read the running flag before emptying the ring
+				// so that logs queued before stopping are written
+				const bool bRunning = bAsyncLog;
+
+				size_t pos = asyncLogHead.load(std::memory_order_relaxed);
+				for (;;) {
+					asyncLogRecord* record = &asyncLogRing[pos & (asyncLogSize - 1)];
+					if (record->sequence.load(std::memory_order_acquire) != pos + 1)
+						break; // Empty or still being formatted
+
+					const SpoutLogLevel level = record->level;
+					if (strcmp(record->text, lastLog) != 0) {
+						strcpy_s(lastLog, 1024, record->text);
+						if (bConsole && bEnableLog)
+							_logtoconsole(level, record->text);
+						// No verbose logs for log to file
+						if (bEnableLogFile && level != SPOUT_LOG_VERBOSE) {
+							if (level != SPOUT_LOG_NONE) {
+								fileLogs += "[";
+								fileLogs += _levelName(level);
+								fileLogs += "] ";
+							}
+							fileLogs += record->text;
+							fileLogs += "\n";
+						}
+					}
+
+					// Release the record to producers
+					record->sequence.store(pos + asyncLogSize, std::memory_order_release);
+					pos++;
+					asyncLogHead.store(pos, std::memory_order_release);
+				}
+
+				const unsigned int dropped = asyncLogDropped.exchange(0);
+				if (dropped > 0) {
+					char tmp[128]={};
+					sprintf_s(tmp, 128, "SpoutLog - %u logs dropped", dropped);
+					if (bConsole && bEnableLog)
+						_logtoconsole(SPOUT_LOG_WARNING, tmp);
+					if (bEnableLogFile) {
+						fileLogs += "[warning] ";
+						fileLogs += tmp;
+						fileLogs += "\n";
+					}
+				}
+
+				if (!fileLogs.empty()) {
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (bEnableLogFile && !state->logPath.empty()) {
+						// The log file remains open unless the path changes
+						if (!state->file.is_open() || state->openPath != state->logPath) {
+							if (state->file.is_open())
+								state->file.close();
+							state->file.open(state->logPath, state->file.app);
+							state->openPath = state->logPath;
+						}
+						if (state->file.is_open()) {
+							state->file << fileLogs;
+							state->file.flush();
+						}
+					}
+					fileLogs.clear();
+				}
+				asyncLogDone.store(pos);
+
+				if (!bRunning)
+					break;
+
+				// Wait for producers, checking again after
+				// setting the flag so that a wake is not missed
+				bAsyncWaiting = true;
+				if (asyncLogRing[pos & (asyncLogSize - 1)].sequence.load(std::memory_order_acquire) != pos + 1)
+					WaitForSingleObject(hAsyncLogEvent, 100);
+				bAsyncWaiting = false;
+			}
+
+			// Close the file so that it can be used by synchronous logs
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (state->file.is_open())
+					state->file.close();
+			}
+
+			// Nothing is used after this
+			SetEvent(hAsyncLogStopped);
+		}
+#endif
+
 
 		//
 		// MessageBox replacement
@@ -55,6 +55,7 @@
 #include <direct.h> // for _getcwd
 #include <vector>
 #include <string>
+#include <map> // for configuration cache
 #include <Shellapi.h> // for shellexecute
 #include <Commctrl.h> // For TaskDialogIndirect
 #include <math.h> // for round
@@ -78,6 +79,10 @@
 #ifdef USE_CHRONO
 #include <chrono> // c++11 timer
 #include <thread>
+#include <atomic> // for asynchronous logging
+#include <mutex>
+#include <memory> // for the log thread file state
+#include <signal.h> // for flight recorder abort handler
 #endif
 
 #pragma comment(lib, "Shell32.lib") // for shellexecute
@@ -210,6 +215,21 @@ namespace spoututils {
 	
 	// Set the current log level
 	void SPOUT_DLLEXP SetSpoutLogLevel(SpoutLogLevel level);
+
+	// Enable or disable asynchronous logging.
+	// Logs are queued without locks and written to console
+	// and file by a background thread. Requires std::chrono.
+	void SPOUT_DLLEXP EnableSpoutLogAsync(bool bAsync = true);
+
+	// Is asynchronous logging enabled
+	bool SPOUT_DLLEXP LogAsyncEnabled();
+
+	// Wait for queued asynchronous logs to be written
+	void SPOUT_DLLEXP FlushSpoutLog();
+
+	// Write queued asynchronous logs and stop the log thread.
+	// Call before the application closes or the dll is unloaded.
+	void SPOUT_DLLEXP CloseSpoutLog();
 	
 	// General purpose log
 	void SPOUT_DLLEXP SpoutLog(const char* format, ...);
@@ -232,6 +252,23 @@ namespace spoututils {
 	// Logging function.
 	void SPOUT_DLLEXP _doLog(SpoutLogLevel level, const char* format, va_list args);
 
+	// Would a log of this level be shown.
+	// Checked by the SPOUTLOG macros before arguments are evaluated.
+	bool SPOUT_DLLEXP SpoutLogLevelEnabled(SpoutLogLevel level);
+
+	// Rate limit for a log call site.
+	// Static for each call site of the SPOUTLOG_LIMIT macros.
+	struct SpoutLogLimit {
+		LONG maxcount; // Logs allowed per second
+		volatile LONG start; // Start of the current second (GetTickCount)
+		volatile LONG count; // Logs in the current second
+		volatile LONG suppressed; // Logs suppressed in the current second
+	};
+
+	// Log limited to a number per second.
+	// The next log shown after a suppressed period reports the number suppressed.
+	void SPOUT_DLLEXP SpoutLogLimited(SpoutLogLimit* limit, SpoutLogLevel level, const char* format, ...);
+
 	// Print to console (printf replacement)
 	int SPOUT_DLLEXP _conprint(const char* format, ...);
 
@@ -329,6 +366,48 @@ namespace spoututils {
 	// Find subkey
 	bool SPOUT_DLLEXP FindSubKey(HKEY hKey, const char *subkey);
 
+	//
+	// Configuration
+	//
+
+	// Source of Spout settings such as "MaxSenders" and "Framecount"
+	enum SpoutConfigSource {
+		// "Software\Leading Edge\Spout" for the current user - default
+		SPOUT_CONFIG_REGISTRY,
+		// INI file with settings in a [Spout] section
+		SPOUT_CONFIG_FILE,
+		// Environment variables "SPOUT_name"
+		SPOUT_CONFIG_ENVIRONMENT,
+		// Application function (see SetSpoutConfigReader)
+		SPOUT_CONFIG_CUSTOM,
+	};
+
+	// Application function to read a setting
+	typedef bool (*SpoutConfigReader)(const char* name, char* value, DWORD dwSize);
+
+	// Select the source of settings.
+	// The file path is required for SPOUT_CONFIG_FILE.
+	void SPOUT_DLLEXP SetSpoutConfigSource(SpoutConfigSource source, const char* filepath = nullptr);
+
+	// Use an application function to read settings
+	void SPOUT_DLLEXP SetSpoutConfigReader(SpoutConfigReader reader);
+
+	// Read a DWORD setting.
+	// Settings are loaded once and then read from memory.
+	bool SPOUT_DLLEXP ReadSpoutConfigDword(const char* name, DWORD* pValue);
+
+	// Read a string setting
+	bool SPOUT_DLLEXP ReadSpoutConfigString(const char* name, char* value, DWORD dwSize = MAX_PATH);
+
+	// Write a DWORD setting to the source and the cache
+	bool SPOUT_DLLEXP WriteSpoutConfigDword(const char* name, DWORD dwValue);
+
+	// Load settings again on the next read
+	void SPOUT_DLLEXP ReloadSpoutConfig();
+
+	// Load settings again when the registry key or file changes
+	void SPOUT_DLLEXP WatchSpoutConfig(bool bWatch = true);
+
 	//
 	// Timing functions
 	//
@@ -353,6 +432,120 @@ namespace spoututils {
 	void SPOUT_DLLEXP StartCounter();
 	double SPOUT_DLLEXP GetCounter();
 
+	// Current performance counter.
+	// Independent of StartTiming and safe for nested or concurrent timing.
+	LONGLONG SPOUT_DLLEXP GetTimingCount();
+
+	// Milliseconds or microseconds elapsed since a count from GetTimingCount
+	double SPOUT_DLLEXP GetTimingElapsed(LONGLONG start, bool microseconds = false);
+
+	//
+	// Timing histograms
+	//
+
+	// Timing statistics for a named histogram (microseconds)
+	struct SpoutTimingStats {
+		unsigned long long count;
+		double total;
+		double mean;
+		double min;
+		double max;
+		double p50;
+		double p95;
+		double p99;
+	};
+
+	// Enable or disable recording of timing histograms
+	void SPOUT_DLLEXP EnableTimingHistograms(bool bEnable = true);
+
+	// Is recording of timing histograms enabled
+	bool SPOUT_DLLEXP TimingHistogramsEnabled();
+
+	// Find or create a named histogram and return its index.
+	// Returns -1 if the maximum number of histograms has been reached.
+	int SPOUT_DLLEXP GetTimingHistogram(const char* name);
+
+	// Add a sample in microseconds to a histogram
+	void SPOUT_DLLEXP AddTimingSample(int histogram, double microseconds);
+
+	// Statistics for a named histogram, merged from all threads
+	bool SPOUT_DLLEXP GetTimingStats(const char* name, SpoutTimingStats* stats);
+
+	// Report of all histograms as a text table
+	std::string SPOUT_DLLEXP GetTimingReport();
+
+	// Clear all histogram samples
+	void SPOUT_DLLEXP ResetTimingHistograms();
+
+	// Time the enclosing scope into a histogram.
+	// Use the SPOUT_TIMER macro for a named histogram.
+	class SPOUT_DLLEXP spoutScopedTimer {
+	public:
+		spoutScopedTimer(int histogram);
+		~spoutScopedTimer();
+	private:
+		int m_histogram;
+		LONGLONG m_start;
+	};
+
+	//
+	// Tracing
+	//
+
+	// Enable or disable recording of trace events
+	void SPOUT_DLLEXP EnableSpoutTrace(bool bEnable = true);
+
+	// Is recording of trace events enabled
+	// (by EnableSpoutTrace or the flight recorder)
+	bool SPOUT_DLLEXP SpoutTraceEnabled();
+
+	// Begin and end a trace event on the current thread.
+	// The name must be a string that remains valid, such as a literal.
+	void SPOUT_DLLEXP SpoutTraceBegin(const char* name);
+	void SPOUT_DLLEXP SpoutTraceEnd(const char* name);
+
+	// Record a counter value
+	void SPOUT_DLLEXP SpoutTraceCounter(const char* name, double value);
+
+	// Write recorded events to a Chrome trace JSON file.
+	// Open with chrome://tracing or https://ui.perfetto.dev
+	bool SPOUT_DLLEXP WriteSpoutTrace(const char* filepath);
+
+	// Clear recorded events
+	void SPOUT_DLLEXP ClearSpoutTrace();
+
+	// Trace the enclosing scope as a single event.
+	// Use the SPOUT_TRACE macro.
+	class SPOUT_DLLEXP spoutTraceScope {
+	public:
+		spoutTraceScope(const char* name);
+		~spoutTraceScope();
+	private:
+		const char* m_name;
+		LONGLONG m_start;
+	};
+
+	//
+	// Flight recorder
+	//
+
+	// Enable or disable the flight recorder.
+	// The most recent logs of the given level and above, and trace events,
+	// are retained in memory whether or not logs are shown.
+	// Retained logs are formatted when they are added, so lower
+	// levels add the cost of formatting to every log of that level.
+	// If bCrashDump is true, the recorder is written to the default file
+	// for an unhandled exception or abort. Requires std::chrono.
+	void SPOUT_DLLEXP EnableSpoutFlightRecorder(bool bEnable = true,
+		SpoutLogLevel level = SPOUT_LOG_WARNING, bool bCrashDump = true);
+
+	// Is the flight recorder enabled
+	bool SPOUT_DLLEXP SpoutFlightRecorderEnabled();
+
+	// Write the flight recorder to a text file.
+	// The default is "exename_flight.log" in the Spout log folder.
+	bool SPOUT_DLLEXP WriteSpoutFlightRecorder(const char* filepath = nullptr);
+
 	//
 	// Private functions
 	//
@@ -363,6 +556,31 @@ namespace spoututils {
 		std::string _getLogPath();
 		std::string _getLogFilePath(const char *filename);
 		std::string _levelName(SpoutLogLevel level);
+		void _doLogArgs(SpoutLogLevel level, const char* format, ...);
+		void _logtoconsole(SpoutLogLevel level, const char* text);
+		bool _logShown(SpoutLogLevel level);
+		// Configuration cache
+		void _checkConfig();
+		void _loadConfig();
+		void _loadConfigRegistry();
+		void _loadConfigFile();
+		void _parseConfigFile(std::istream& file, std::map<std::string, std::string>& values);
+		void _loadConfigEnvironment();
+		void _watchConfig(bool bWatch);
+		enum configWatchAction {
+			CONFIG_WATCH_NONE,  // Nothing to do
+			CONFIG_WATCH_START, // Open the key or folder and request notification
+			CONFIG_WATCH_RENEW, // Request the next notification
+			CONFIG_WATCH_STOP   // Close the notification
+		};
+		configWatchAction _configWatchAction(SpoutConfigSource source, const std::string& path,
+			bool bWatch, bool bActive, bool bChanged);
+#ifdef USE_CHRONO
+		// Asynchronous logging
+		bool _pushAsyncLog(SpoutLogLevel level, const char* format, va_list args);
+		// Tracing
+		void _addTraceEvent(char phase, const char* name, LONGLONG timestamp, LONGLONG duration, double value);
+#endif
 		// Taskdialog for SpoutMessageBox
 		int MessageTaskDialog(HWND hWnd, const char* content, const char* caption, DWORD dwButtons, DWORD dwMilliseconds);
 		// TaskDialogIndirect callback to handle timer, topmost and hyperlinks
@@ -416,4 +634,104 @@ namespace spoututils {
 
 }
 
+//
+// Log macros for time-critical code
+//
+// Arguments are not evaluated unless the log would be shown,
+// and logs below SPOUT_LOG_COMPILE_LEVEL are removed altogether.
+// Release builds keep warnings and above.
+//
+//    SPOUTLOG_WARNING("spoutFrameCount::WaitFrameSync - WAIT_TIMEOUT");
+//
+// The _LIMIT versions show no more than "n" logs per second from
+// the same call site. For example, for a failure on every frame :
+//
+//    SPOUTLOG_WARNING_LIMIT(1, "SpoutFrameCount::GetNewFrame - WAIT_FAILED");
+//
+// Compile level values are those of SpoutLogLevel
+// 1 - verbose, 2 - notice, 3 - warning, 4 - error, 5 - fatal
+//
+#ifndef SPOUT_LOG_COMPILE_LEVEL
+#ifdef _DEBUG
+#define SPOUT_LOG_COMPILE_LEVEL 1
+#else
+#define SPOUT_LOG_COMPILE_LEVEL 3
+#endif
+#endif
+
+#define SPOUTLOG_IF(level, logfunction, ...) \
+	do { if (spoututils::SpoutLogLevelEnabled(level)) logfunction(__VA_ARGS__); } while (0)
+
+#define SPOUTLOG_LIMIT(level, n, ...) \
+	do { if (spoututils::SpoutLogLevelEnabled(level)) { \
+		static spoututils::SpoutLogLimit _spoutloglimit = { (LONG)(n), 0, 0, 0 }; \
+		spoututils::SpoutLogLimited(&_spoutloglimit, level, __VA_ARGS__); } } while (0)
+
+#if SPOUT_LOG_COMPILE_LEVEL <= 1
+#define SPOUTLOG_VERBOSE(...) SPOUTLOG_IF(spoututils::SPOUT_LOG_VERBOSE, spoututils::SpoutLogVerbose, __VA_ARGS__)
+#define SPOUTLOG_VERBOSE_LIMIT(n, ...) SPOUTLOG_LIMIT(spoututils::SPOUT_LOG_VERBOSE, n, __VA_ARGS__)
+#else
+#define SPOUTLOG_VERBOSE(...) ((void)0)
+#define SPOUTLOG_VERBOSE_LIMIT(n, ...) ((void)0)
+#endif
+
+#if SPOUT_LOG_COMPILE_LEVEL <= 2
+#define SPOUTLOG_NOTICE(...) SPOUTLOG_IF(spoututils::SPOUT_LOG_NOTICE, spoututils::SpoutLogNotice, __VA_ARGS__)
+#define SPOUTLOG_NOTICE_LIMIT(n, ...) SPOUTLOG_LIMIT(spoututils::SPOUT_LOG_NOTICE, n, __VA_ARGS__)
+#else
+#define SPOUTLOG_NOTICE(...) ((void)0)
+#define SPOUTLOG_NOTICE_LIMIT(n, ...) ((void)0)
+#endif
+
+#if SPOUT_LOG_COMPILE_LEVEL <= 3
+#define SPOUTLOG_WARNING(...) SPOUTLOG_IF(spoututils::SPOUT_LOG_WARNING, spoututils::SpoutLogWarning, __VA_ARGS__)
+#define SPOUTLOG_WARNING_LIMIT(n, ...) SPOUTLOG_LIMIT(spoututils::SPOUT_LOG_WARNING, n, __VA_ARGS__)
+#else
+#define SPOUTLOG_WARNING(...) ((void)0)
+#define SPOUTLOG_WARNING_LIMIT(n, ...) ((void)0)
+#endif
+
+#if SPOUT_LOG_COMPILE_LEVEL <= 4
+#define SPOUTLOG_ERROR(...) SPOUTLOG_IF(spoututils::SPOUT_LOG_ERROR, spoututils::SpoutLogError, __VA_ARGS__)
+#define SPOUTLOG_ERROR_LIMIT(n, ...) SPOUTLOG_LIMIT(spoututils::SPOUT_LOG_ERROR, n, __VA_ARGS__)
+#else
+#define SPOUTLOG_ERROR(...) ((void)0)
+#define SPOUTLOG_ERROR_LIMIT(n, ...) ((void)0)
+#endif
+
+// Fatal logs are always compiled
+#define SPOUTLOG_FATAL(...) SPOUTLOG_IF(spoututils::SPOUT_LOG_FATAL, spoututils::SpoutLogFatal, __VA_ARGS__)
+
+//
+// Scoped timer for a named histogram
+//
+// The histogram is found once for each call site and the time
+// to the end of the enclosing scope is recorded when enabled.
+//
+//    SPOUT_TIMER("spoutDX::ReceiveImage");
+//
+#define SPOUT_TIMER(name) \
+	static const int _spouttimerindex = spoututils::GetTimingHistogram(name); \
+	spoututils::spoutScopedTimer _spouttimer(_spouttimerindex)
+
+//
+// Trace events
+//
+// Events are recorded only after EnableSpoutTrace and are
+// removed altogether if SPOUT_NO_TRACE is defined.
+//
+//    SPOUT_TRACE("spoutDX::ReceiveImage"); // time to the end of the scope
+//    SPOUT_TRACE_COUNTER("spoutDX::SenderFrame", frame);
+//
+#define SPOUT_TRACE_JOIN2(a, b) a##b
+#define SPOUT_TRACE_JOIN(a, b) SPOUT_TRACE_JOIN2(a, b)
+#ifndef SPOUT_NO_TRACE
+#define SPOUT_TRACE(name) spoututils::spoutTraceScope SPOUT_TRACE_JOIN(_spouttrace, __LINE__)(name)
+#define SPOUT_TRACE_COUNTER(name, value) \
+	do { if (spoututils::SpoutTraceEnabled()) spoututils::SpoutTraceCounter(name, (double)(value)); } while (0)
+#else
+#define SPOUT_TRACE(name) ((void)0)
+#define SPOUT_TRACE_COUNTER(name, value) ((void)0)
+#endif
+
 #endif